@@ -0,0 +1,97 @@
+#ifndef __AI_TOY_ALERT_CACHE_H__
+#define __AI_TOY_ALERT_CACHE_H__
+
+#include "tuya_cloud_types.h"
+
+// 默认关闭，开启时需由板级配置提供 AI_TOY_ALERT_PCM_DECODER
+#ifndef AI_TOY_ALERT_PCM_CACHE_ENABLE
+#define AI_TOY_ALERT_PCM_CACHE_ENABLE   0
+#endif
+
+#ifndef AI_TOY_ALERT_PCM_CACHE_BUDGET
+#define AI_TOY_ALERT_PCM_CACHE_BUDGET   (256 * 1024)    // PSRAM bytes
+#endif
+
+#define AI_TOY_ALERT_PCM_CACHE_ENTRIES  4
+#define AI_TOY_ALERT_PCM_FRAME_SIZE     640             // 20ms @ 16kHz/16bit/mono
+
+/**
+ * @brief decode a whole MP3 blob into PCM
+ *
+ * The decoder allocates *pcm with tkl_system_psram_malloc, ownership moves to
+ * the cache which releases it with tkl_system_psram_free on eviction.
+ */
+typedef OPERATE_RET (*AI_TOY_PCM_DECODE_CB)(CONST CHAR_T *mp3, UINT32_T mp3_len, UCHAR_T **pcm, UINT32_T *pcm_len);
+
+/**
+ * @brief audio output hand-over around a cached playback, called on the cache worker
+ *
+ * The cached PCM goes straight to the AO, so the speaker service must not be
+ * writing at the same time. begin() runs before the first frame: it stops
+ * tones, pauses music and reports the alert as started. end() runs after the
+ * last frame, also when aborted, and reports the alert as stopped.
+ */
+typedef struct {
+    VOID (*begin)(VOID);
+    VOID (*end)(BOOL_T aborted);
+} AI_TOY_ALERT_CACHE_OUT_T;
+
+typedef struct {
+    UINT32_T    hits;
+    UINT32_T    misses;
+    UINT32_T    fills;
+    UINT32_T    fill_fail;
+    UINT32_T    evictions;
+    UINT32_T    bytes;
+    UINT32_T    budget;
+} AI_TOY_ALERT_CACHE_STAT_T;
+
+/**
+ * @brief create the cache worker
+ *
+ * @param budget PSRAM byte budget for decoded PCM
+ * @param decode MP3 to PCM decoder
+ * @param out audio output hand-over, kept by reference
+ * @return OPERATE_RET
+ */
+OPERATE_RET ai_toy_alert_cache_init(UINT32_T budget, AI_TOY_PCM_DECODE_CB decode, CONST AI_TOY_ALERT_CACHE_OUT_T *out);
+
+/**
+ * @brief abort playback, stop the cache worker and free the cached PCM
+ *
+ * Queued plays are aborted, queued fills still run first. Waits for the
+ * worker, do not call it from the out callbacks.
+ */
+VOID ai_toy_alert_cache_deinit(VOID);
+
+/**
+ * @brief play an alert from the PCM cache
+ *
+ * On a miss a background fill is queued and OPRT_NOT_FOUND is returned, the
+ * caller should play the MP3 the usual way.
+ *
+ * @param mp3 MP3 asset, its address is the cache key
+ * @param mp3_len MP3 asset size
+ * @return OPERATE_RET OPRT_OK when playback was started from the cache
+ */
+OPERATE_RET ai_toy_alert_cache_play(CONST CHAR_T *mp3, UINT32_T mp3_len);
+
+/**
+ * @brief queue a background decode of an asset without playing it
+ */
+OPERATE_RET ai_toy_alert_cache_prefetch(CONST CHAR_T *mp3, UINT32_T mp3_len);
+
+/**
+ * @brief abort the cached playbacks posted so far, running or still queued
+ *
+ * A later ai_toy_alert_cache_play() is not affected.
+ */
+VOID ai_toy_alert_cache_stop(VOID);
+
+BOOL_T ai_toy_alert_cache_is_playing(VOID);
+
+VOID ai_toy_alert_cache_stat_get(AI_TOY_ALERT_CACHE_STAT_T *stat);
+
+VOID ai_toy_alert_cache_dump(VOID);
+
+#endif /* __AI_TOY_ALERT_CACHE_H__ */
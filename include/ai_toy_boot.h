@@ -0,0 +1,60 @@
+#ifndef __AI_TOY_BOOT_H__
+#define __AI_TOY_BOOT_H__
+
+#include "tuya_cloud_types.h"
+
+#define AI_TOY_BOOT_STAGE_MAX           16
+#define AI_TOY_BOOT_WORKERS             2       // helper threads next to the calling thread
+
+#define AI_TOY_BOOT_DEP(stage)          (1UL << (stage))
+
+typedef OPERATE_RET (*AI_TOY_BOOT_FN)(VOID *arg);
+
+/**
+ * @brief one bring-up step and the steps it must follow
+ */
+typedef struct {
+    CONST CHAR_T       *name;
+    AI_TOY_BOOT_FN      fn;
+    UINT32_T            deps;       ///< OR of AI_TOY_BOOT_DEP(index) of earlier stages
+    BOOL_T              required;   ///< a failure fails the whole boot
+} AI_TOY_BOOT_STAGE_T;
+
+typedef enum {
+    AI_TOY_BOOT_PENDING,
+    AI_TOY_BOOT_RUNNING,
+    AI_TOY_BOOT_DONE,
+    AI_TOY_BOOT_FAILED,
+    AI_TOY_BOOT_SKIPPED,            ///< a dependency failed
+} AI_TOY_BOOT_STATUS_E;
+
+typedef struct {
+    UINT32_T            start_ms;   ///< relative to ai_toy_boot_run entry
+    UINT32_T            end_ms;
+    OPERATE_RET         rt;
+    UINT8_T             status;     ///< AI_TOY_BOOT_STATUS_E
+    UINT8_T             runner;     ///< 0 is the calling thread
+} AI_TOY_BOOT_TIMING_T;
+
+/**
+ * @brief run every stage once its dependencies are done, independent stages
+ *        in parallel on AI_TOY_BOOT_WORKERS helper threads
+ *
+ * Blocks until every stage has finished or been skipped. Timing is kept for
+ * ai_toy_boot_dump.
+ *
+ * @return OPERATE_RET the first failure of a required stage, OPRT_OK otherwise
+ */
+OPERATE_RET ai_toy_boot_run(CONST AI_TOY_BOOT_STAGE_T *stages, UINT8_T cnt, VOID *arg);
+
+/**
+ * @brief timing of the last run, NULL before the first one
+ */
+CONST AI_TOY_BOOT_TIMING_T *ai_toy_boot_timing_get(UINT8_T *cnt);
+
+/**
+ * @brief print the per-stage timeline of the last run
+ */
+VOID ai_toy_boot_dump(VOID);
+
+#endif /* __AI_TOY_BOOT_H__ */
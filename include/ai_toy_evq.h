@@ -0,0 +1,75 @@
+#ifndef __AI_TOY_EVQ_H__
+#define __AI_TOY_EVQ_H__
+
+#include "tuya_cloud_types.h"
+
+#define AI_TOY_EVQ_DEPTH                64      // power of two
+#define AI_TOY_EVQ_RESERVED             8       // cells only ai_toy_evq_post_critical() may fill
+
+/**
+ * @brief compact event record posted by callbacks to the toy worker
+ */
+typedef struct {
+    UINT8_T     src;        ///< event source, owned by the toy
+    UINT8_T     code;       ///< source specific event code
+    INT8_T      mode;       ///< recorder mode when relevant
+    UINT8_T     flags;
+    UINT32_T    arg;
+    UINT32_T    arg2;
+    UINT32_T    stamp_us;   ///< recorder and key events: low 32 bits of AI_TOY_TRACE_NOW_US() in the callback, 0 = none
+} AI_TOY_EVT_T;
+
+typedef VOID (*AI_TOY_EVT_HANDLER)(CONST AI_TOY_EVT_T *evt, VOID *arg);
+
+typedef VOID (*AI_TOY_EVT_TAP)(CONST AI_TOY_EVT_T *evt);
+
+typedef struct {
+    UINT32_T    posted;
+    UINT32_T    handled;
+    UINT32_T    full;       ///< records dropped, queue full
+    UINT32_T    full_critical;  ///< critical records dropped, reserve exhausted too
+    UINT32_T    reserved;   ///< critical records that went into the reserve
+    UINT32_T    max_depth;
+} AI_TOY_EVQ_STAT_T;
+
+/**
+ * @brief create the queue and the worker thread that owns the toy context
+ *
+ * @param handler called on the worker thread for each record, in post order
+ * @param arg handler argument
+ * @return OPERATE_RET
+ */
+OPERATE_RET ai_toy_evq_init(AI_TOY_EVT_HANDLER handler, VOID *arg);
+
+/**
+ * @brief let the worker handle what is queued, then stop it and wait for it
+ *
+ * Later posts fail with OPRT_RESOURCE_NOT_READY. Do not call it from the worker.
+ */
+VOID ai_toy_evq_deinit(VOID);
+
+/**
+ * @brief post a record, lock-free and never blocks, safe from any thread
+ *
+ * The last AI_TOY_EVQ_RESERVED cells are kept for critical records. Drops are
+ * counted in the stats and the first one of each burst is logged.
+ *
+ * @return OPERATE_RET OPRT_EXCEED_UPPER_LIMIT when the queue is full
+ */
+OPERATE_RET ai_toy_evq_post(CONST AI_TOY_EVT_T *evt);
+
+/**
+ * @brief post a record the state machine cannot lose, e.g. the end of an
+ *        utterance; it may also fill the reserved cells
+ */
+OPERATE_RET ai_toy_evq_post_critical(CONST AI_TOY_EVT_T *evt);
+
+VOID ai_toy_evq_stat_get(AI_TOY_EVQ_STAT_T *stat);
+
+/**
+ * @brief observe every accepted record on the posting thread, before the worker
+ *        can see it; NULL removes the tap
+ */
+VOID ai_toy_evq_tap_set(AI_TOY_EVT_TAP tap);
+
+#endif /* __AI_TOY_EVQ_H__ */
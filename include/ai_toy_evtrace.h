@@ -0,0 +1,108 @@
+#ifndef __AI_TOY_EVTRACE_H__
+#define __AI_TOY_EVTRACE_H__
+
+#include "tuya_cloud_types.h"
+#include "ai_toy_evq.h"
+
+#ifndef AI_TOY_EVTRACE_ENABLE
+#define AI_TOY_EVTRACE_ENABLE           1
+#endif
+
+#ifndef AI_TOY_EVTRACE_RECORDS
+#define AI_TOY_EVTRACE_RECORDS          4096    // power of two, 20 bytes each in PSRAM
+#endif
+
+#define AI_TOY_EVTRACE_MAGIC            0x32455441  // "ATE2" little endian
+#define AI_TOY_EVTRACE_DUMP_BYTES       32          // binary bytes per hex log line
+
+/**
+ * binary trace layout, little endian, as written by ai_toy_evtrace_export()
+ * and accepted by ai_toy_evtrace_load(): one header, then count records
+ * oldest first
+ */
+typedef struct {
+    UINT32_T        magic;
+    UINT16_T        rec_size;               ///< sizeof(AI_TOY_EVTRACE_REC_T)
+    UINT16_T        reserved;
+    UINT32_T        count;
+    UINT32_T        lost;                   ///< older records overwritten by the ring
+} AI_TOY_EVTRACE_HDR_T;
+
+typedef struct {
+    UINT32_T        ts_us;                  ///< since ai_toy_evtrace_start, wraps after ~71 min
+    AI_TOY_EVT_T    evt;                    ///< arg2 carries the payload length of recorder audio
+} AI_TOY_EVTRACE_REC_T;
+
+/**
+ * @brief called on the replay thread for each record at its recorded offset
+ */
+typedef VOID (*AI_TOY_EVTRACE_FEED)(CONST AI_TOY_EVT_T *evt, VOID *arg);
+
+typedef struct {
+    AI_TOY_EVTRACE_FEED     feed;
+    VOID                  (*done)(VOID *arg);     ///< optional, after the last record
+    VOID                   *arg;
+    UINT32_T                speed_pct;      ///< 100 = recorded timing, 0 = back to back
+} AI_TOY_EVTRACE_REPLAY_CFG_T;
+
+typedef struct {
+    UINT32_T    recorded;
+    UINT32_T    lost;
+    UINT32_T    replayed;
+    UINT32_T    replay_ms;                  ///< wall time of the last replay
+    UINT32_T    replay_late;                ///< records fed more than 10ms behind schedule
+    UINT32_T    replay_max_lag_us;
+} AI_TOY_EVTRACE_STAT_T;
+
+#if AI_TOY_EVTRACE_ENABLE
+/**
+ * @brief allocate the PSRAM ring and start recording, any previous trace is discarded
+ *
+ * @return OPERATE_RET OPRT_RESOURCE_NOT_READY while a replay is running
+ */
+OPERATE_RET ai_toy_evtrace_start(VOID);
+
+/**
+ * @brief stop recording, the trace is kept for export and replay
+ */
+VOID ai_toy_evtrace_stop(VOID);
+
+/**
+ * @brief record one event, lock-free, safe from any thread; a single load and
+ *        branch while not recording
+ *
+ * Matches AI_TOY_EVT_TAP so it can be installed with ai_toy_evq_tap_set().
+ */
+VOID ai_toy_evtrace_record(CONST AI_TOY_EVT_T *evt);
+
+/**
+ * @brief copy the stopped trace out in the binary layout above
+ *
+ * @return INT_T bytes written, or the size needed when buf is NULL
+ */
+INT_T ai_toy_evtrace_export(UINT8_T *buf, UINT_T size);
+
+/**
+ * @brief replace the trace with an exported one, e.g. pulled from another device
+ */
+OPERATE_RET ai_toy_evtrace_load(CONST UINT8_T *buf, UINT_T len);
+
+/**
+ * @brief log the stopped trace as "EVTRACE <hex>" lines of the binary layout
+ */
+VOID ai_toy_evtrace_dump(VOID);
+
+/**
+ * @brief feed the trace back on its own thread, recording is stopped first
+ */
+OPERATE_RET ai_toy_evtrace_replay(CONST AI_TOY_EVTRACE_REPLAY_CFG_T *cfg);
+
+BOOL_T ai_toy_evtrace_replaying(VOID);
+
+VOID ai_toy_evtrace_stat_get(AI_TOY_EVTRACE_STAT_T *stat);
+#else
+#define ai_toy_evtrace_record(evt)      do { } while (0)
+#define ai_toy_evtrace_replaying()      FALSE
+#endif
+
+#endif /* __AI_TOY_EVTRACE_H__ */
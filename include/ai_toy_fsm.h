@@ -0,0 +1,75 @@
+#ifndef __AI_TOY_FSM_H__
+#define __AI_TOY_FSM_H__
+
+#include "tuya_cloud_types.h"
+
+/**
+ * toy state transition table
+ *
+ * s_ai_toy_fsm[event][state] gives the next ai_toy_state_t for each recorder
+ * mode class and the TOY_ACT_* actions to run. The table only decides, the
+ * toy worker runs the actions, see __ai_toy_fsm_dispatch() in tuya_ai_toy.c.
+ */
+typedef enum {
+    TOY_EV_MODE_UPDATE,             ///< AUDIO_RECODER_MODE_UPDATE
+    TOY_EV_WAKEUP,                  ///< AUDIO_RECODER_WAKEUP / AUDIO_RECODER_START
+    TOY_EV_REC_STOP,                ///< AUDIO_RECODER_STOP
+    TOY_EV_VAD_START,
+    TOY_EV_VAD_SPEAK,
+    TOY_EV_VAD_END,
+    TOY_EV_UPLOAD_DONE,             ///< AI_PROC_UPLOAD_DONE
+    TOY_EV_ASR_OK,
+    TOY_EV_ASR_FAIL,                ///< ASR_EMPTY/ASR_TIMEOUT/UPLOAD_FAIL/TTS_ABORT/TTS_TIMEOUT
+    TOY_EV_TTS_START,
+    TOY_EV_PLAYER_START,            ///< player STARTED
+    TOY_EV_PLAYER_END,              ///< player FINISHED/STOPPED, not an alert tone
+    TOY_EV_MAX
+} AI_TOY_FSM_EV_E;
+
+typedef enum {
+    TOY_MODE_KEY_HOLD,
+    TOY_MODE_WAKEUP,
+    TOY_MODE_FREE,
+    TOY_MODE_OTHER,
+    TOY_MODE_MAX
+} AI_TOY_FSM_MODE_E;
+
+#define TOY_ACT_TRACE                   (1 << 0)    // barge-in latency trace
+#define TOY_ACT_VAD_ACTIVE              (1 << 1)    // vad_active, stop idle timer
+#define TOY_ACT_LED_ON                  (1 << 2)
+#define TOY_ACT_LED_OFF                 (1 << 3)
+#define TOY_ACT_LED_FLASH               (1 << 4)
+#define TOY_ACT_STRIP_BREATH            (1 << 5)    // LED strip, only when provisioned
+#define TOY_ACT_STRIP_DIALOG            (1 << 6)
+#define TOY_ACT_STRIP_IDLE              (1 << 7)    // LED strip, only when provisioned
+#define TOY_ACT_PLAYER_STOP             (1 << 8)
+#define TOY_ACT_DISPLAY_MODE            (1 << 9)
+#define TOY_ACT_INTERRUPT               (1 << 11)
+#define TOY_ACT_ALERT_MODE              (1 << 12)
+#define TOY_ACT_ALERT_WAKEUP            (1 << 13)
+#define TOY_ACT_PLAYER_READY            (1 << 14)
+#define TOY_ACT_PLAYER_STARTED          (1 << 15)
+#define TOY_ACT_PLAYER_STOPPED          (1 << 16)
+#define TOY_ACT_UPLOAD                  (1 << 17)   // audio data
+#define TOY_ACT_UPLOAD_FINISH           (1 << 18)   // audio data and finish
+#define TOY_ACT_STOP_FIRST              (1 << 19)   // player stop and interrupt before the LEDs
+
+#define TOY_ST_KEEP                     0xFE        // accepted, no state update
+#define TOY_ST_NONE                     0xFF        // rejected by the guard
+
+/**
+ * @brief look up one event and count it as accepted or rejected
+ *
+ * @param state current ai_toy_state_t
+ * @param actions out, TOY_ACT_* of an accepted event, 0 otherwise
+ * @return UINT8_T next state, TOY_ST_KEEP, or TOY_ST_NONE when the guard
+ *         rejects the event or ev/state is out of range
+ */
+UINT8_T ai_toy_fsm_step(AI_TOY_FSM_EV_E ev, UINT8_T state, AI_TOY_FSM_MODE_E mode, UINT32_T *actions);
+
+/**
+ * @brief log the accepted/rejected counters of every (event, state) seen
+ */
+VOID ai_toy_fsm_dump(VOID);
+
+#endif /* __AI_TOY_FSM_H__ */
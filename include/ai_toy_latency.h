@@ -0,0 +1,79 @@
+#ifndef __AI_TOY_LATENCY_H__
+#define __AI_TOY_LATENCY_H__
+
+#include "tuya_cloud_types.h"
+
+#define AI_TOY_LATENCY_TURNS            16      // recent turns kept in the ring
+
+typedef enum {
+    AI_TOY_LAT_MARK_VAD_END,            ///< user stopped speaking, upload starts
+    AI_TOY_LAT_MARK_UPLOAD_DONE,
+    AI_TOY_LAT_MARK_ASR_OK,
+    AI_TOY_LAT_MARK_TTS_START,
+    AI_TOY_LAT_MARK_PLAYER_START,       ///< first player STARTED event of the answer
+    AI_TOY_LAT_MARK_MAX
+} AI_TOY_LAT_MARK_E;
+
+typedef enum {
+    AI_TOY_LAT_UPLOAD,                  ///< VAD_END -> UPLOAD_DONE
+    AI_TOY_LAT_ASR,                     ///< UPLOAD_DONE -> ASR_OK
+    AI_TOY_LAT_LLM,                     ///< ASR_OK -> TTS_START
+    AI_TOY_LAT_PLAY,                    ///< TTS_START -> player STARTED
+    AI_TOY_LAT_E2E,                     ///< VAD_END -> player STARTED
+    AI_TOY_LAT_MAX
+} AI_TOY_LAT_METRIC_E;
+
+#define AI_TOY_LAT_INVALID              0xFFFFFFFF
+
+// worst case of ai_toy_latency_summary_json() with 10 digit values, terminator included
+#define AI_TOY_LATENCY_JSON_MAX         (40 + AI_TOY_LAT_MAX * 55 + 2)
+
+typedef struct {
+    UINT32_T    count;                  ///< turns holding this metric
+    UINT32_T    p50_ms;
+    UINT32_T    p90_ms;
+    UINT32_T    p99_ms;
+    UINT32_T    max_ms;
+} AI_TOY_LAT_STAT_T;
+
+typedef struct {
+    UINT32_T            turns;          ///< completed turns since boot
+    UINT32_T            aborted;        ///< turns that never reached the player
+    AI_TOY_LAT_STAT_T   metric[AI_TOY_LAT_MAX];
+} AI_TOY_LAT_SUMMARY_T;
+
+/**
+ * @brief record a milestone of the current conversation turn
+ *
+ * VAD_END opens a new turn, PLAYER_START closes it into the ring.
+ */
+VOID ai_toy_latency_mark(AI_TOY_LAT_MARK_E mark);
+
+/**
+ * @brief drop the current turn, e.g. on timeout or interruption
+ */
+VOID ai_toy_latency_abort(VOID);
+
+/**
+ * @brief percentiles over the recent turns in the ring
+ */
+VOID ai_toy_latency_summary_get(AI_TOY_LAT_SUMMARY_T *summary);
+
+/**
+ * @brief number of completed turns since boot
+ */
+UINT32_T ai_toy_latency_turns_get(VOID);
+
+/**
+ * @brief format the summary as compact JSON for DP reporting
+ *
+ * Each metric is [p50,p90,p99,max] in ms. A buffer of AI_TOY_LATENCY_JSON_MAX
+ * bytes always holds the whole object.
+ *
+ * @return INT_T length written, excluding the terminator
+ */
+INT_T ai_toy_latency_summary_json(CHAR_T *buf, UINT_T size);
+
+VOID ai_toy_latency_dump(VOID);
+
+#endif /* __AI_TOY_LATENCY_H__ */
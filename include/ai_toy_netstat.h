@@ -0,0 +1,79 @@
+#ifndef __AI_TOY_NETSTAT_H__
+#define __AI_TOY_NETSTAT_H__
+
+#include "tuya_cloud_types.h"
+#include "tuya_iot_wifi_api.h"
+
+#define AI_TOY_RSSI_SAMPLE_INTERVAL     (10 * 1000)     // ms, while connected and the level is moving
+#define AI_TOY_RSSI_STABLE_INTERVAL     (60 * 1000)     // ms, once the level has settled
+#define AI_TOY_RSSI_METER_INTERVAL      (1 * 1000)      // ms, while the signal meter is shown
+#define AI_TOY_RSSI_STABLE_SAMPLES      6               // unchanged samples before backing off
+#define AI_TOY_RSSI_INVALID             (-128)
+
+#define AI_TOY_RSSI_EWMA_SHIFT          2               // filter weight 1/4 for each new sample
+#define AI_TOY_RSSI_HYST_DB             2               // dB past a level boundary before switching
+#define AI_TOY_RSSI_LEVEL_MAX           12              // one level per LED
+
+#ifndef AI_TOY_SIGNAL_METER_TIMEOUT
+#define AI_TOY_SIGNAL_METER_TIMEOUT     (5 * 60 * 1000) // ms, the meter turns itself off after this
+#endif
+
+/**
+ * @brief seed the cache from the Wi-Fi stack and start the RSSI sampler
+ */
+OPERATE_RET ai_toy_netstat_init(VOID);
+
+/**
+ * @brief update the cached network status, called from the Wi-Fi status callback
+ */
+VOID ai_toy_netstat_set(GW_WIFI_NW_STAT_E nw_stat);
+
+/**
+ * @brief cached network status, lock-free, never calls into the Wi-Fi stack
+ */
+GW_WIFI_NW_STAT_E ai_toy_netstat_get(VOID);
+
+/**
+ * @brief TRUE unless the device is waiting for network configuration
+ */
+BOOL_T ai_toy_netstat_is_provisioned(VOID);
+
+/**
+ * @brief take one RSSI sample now and feed it to the filter
+ *
+ * Does not touch the radio in low-power mode, the cached sample is returned
+ * instead.
+ *
+ * @return SCHAR_T the new sample, AI_TOY_RSSI_INVALID on failure
+ */
+SCHAR_T ai_toy_netstat_rssi_sample(VOID);
+
+/**
+ * @brief last raw RSSI sample in dBm, AI_TOY_RSSI_INVALID before the first sample
+ */
+SCHAR_T ai_toy_netstat_rssi_get(VOID);
+
+/**
+ * @brief EWMA-filtered RSSI in dBm, AI_TOY_RSSI_INVALID before the first sample
+ */
+SCHAR_T ai_toy_netstat_rssi_filtered_get(VOID);
+
+/**
+ * @brief signal level 1..AI_TOY_RSSI_LEVEL_MAX with hysteresis, 0 when unknown
+ */
+UINT8_T ai_toy_netstat_rssi_level_get(VOID);
+
+/**
+ * @brief pause or resume background sampling around the low-power keep-alive mode
+ */
+VOID ai_toy_netstat_lowpower_set(BOOL_T enable);
+
+/**
+ * @brief show the live signal level on the LED ring and sample faster
+ *
+ * The meter is for placing the device, it turns itself off after
+ * AI_TOY_SIGNAL_METER_TIMEOUT.
+ */
+VOID ai_toy_netstat_meter_set(BOOL_T enable);
+
+#endif /* __AI_TOY_NETSTAT_H__ */
@@ -0,0 +1,91 @@
+#ifndef __AI_TOY_POWER_H__
+#define __AI_TOY_POWER_H__
+
+#include "tuya_cloud_types.h"
+
+#define AI_TOY_POWER_GAP_BUCKETS        16      // log2 seconds, the last one catches everything longer
+#define AI_TOY_POWER_LISTEN_BUCKETS     32      // 1s each
+#define AI_TOY_POWER_HIST_WINDOW        64      // samples before the counts are halved
+#define AI_TOY_POWER_MIN_SAMPLES        8       // below this the defaults are used
+
+#ifndef AI_TOY_POWER_LISTEN_MIN
+#define AI_TOY_POWER_LISTEN_MIN         (8 * 1000)      // ms, shortest listen window
+#endif
+#define AI_TOY_POWER_LISTEN_MARGIN      (2 * 1000)      // ms, added to the listen percentile
+#define AI_TOY_POWER_LISTEN_PCT         95
+
+#ifndef AI_TOY_POWER_LOWPOWER_MIN
+#define AI_TOY_POWER_LOWPOWER_MIN       (30 * 1000)     // ms, shortest idle time before low-power
+#endif
+#ifndef AI_TOY_POWER_LP_DRAW_PCT
+#define AI_TOY_POWER_LP_DRAW_PCT        10      // low-power draw in percent of awake idle draw
+#endif
+#ifndef AI_TOY_POWER_WAKE_PENALTY
+#define AI_TOY_POWER_WAKE_PENALTY       (20 * 1000)     // ms of awake idle one slow wake is worth
+#endif
+
+typedef enum {
+    AI_TOY_PWR_ACTIVE,          ///< a dialog or playback is running
+    AI_TOY_PWR_IDLE,            ///< awake, nothing to do
+    AI_TOY_PWR_LOWPOWER,        ///< keep-alive or on the way into deep sleep
+    AI_TOY_PWR_MAX
+} AI_TOY_PWR_STATE_E;
+
+typedef struct {
+    UINT64_T    residency_ms[AI_TOY_PWR_MAX];   ///< time spent in each state, current one included
+    UINT32_T    listen_timeout;     ///< current decision, ms
+    UINT32_T    lowpower_timeout;   ///< current decision, ms
+    UINT32_T    decisions;          ///< times either timeout changed
+    UINT32_T    gaps;               ///< idle gaps learned
+    UINT32_T    listen_hits;        ///< listens that heard speech
+    UINT32_T    listen_misses;      ///< listens that timed out
+    UINT32_T    wakes;              ///< low-power exits
+    UINT32_T    quick_wakes;        ///< exits within AI_TOY_POWER_WAKE_PENALTY of the entry
+} AI_TOY_POWER_STAT_T;
+
+/**
+ * @brief set up the governor
+ *
+ * @param listen_ms listen timeout used until enough has been learned, also the upper bound
+ * @param lowpower_ms low-power timeout used until enough has been learned, also the upper bound
+ */
+OPERATE_RET ai_toy_power_init(UINT32_T listen_ms, UINT32_T lowpower_ms);
+
+/**
+ * @brief report a power state change
+ *
+ * Leaving idle or low-power for active closes an idle gap, which is added to
+ * the gap histogram and may move the low-power timeout.
+ */
+VOID ai_toy_power_state_set(AI_TOY_PWR_STATE_E state);
+
+/**
+ * @brief a listen window opened, the recorder waits for speech
+ */
+VOID ai_toy_power_listen_start(VOID);
+
+/**
+ * @brief speech was heard in the open listen window
+ */
+VOID ai_toy_power_listen_heard(VOID);
+
+/**
+ * @brief the open listen window timed out without speech
+ */
+VOID ai_toy_power_listen_expired(VOID);
+
+/**
+ * @brief how long to listen for speech before going back to idle, ms
+ */
+UINT32_T ai_toy_power_listen_timeout(VOID);
+
+/**
+ * @brief how long to stay idle before entering low-power, ms
+ */
+UINT32_T ai_toy_power_lowpower_timeout(VOID);
+
+VOID ai_toy_power_stat_get(AI_TOY_POWER_STAT_T *stat);
+
+VOID ai_toy_power_dump(VOID);
+
+#endif /* __AI_TOY_POWER_H__ */
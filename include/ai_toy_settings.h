@@ -0,0 +1,70 @@
+#ifndef __AI_TOY_SETTINGS_H__
+#define __AI_TOY_SETTINGS_H__
+
+#include "tuya_cloud_types.h"
+
+#define AI_TOY_SETTINGS_KEY             "ai_toy_para"
+
+#ifndef AI_TOY_SETTINGS_WINDOW_MS
+#define AI_TOY_SETTINGS_WINDOW_MS       1500    // changes inside one window cost one flash write
+#endif
+
+#define AI_TOY_SETTINGS_RETRY_MAX       6       // failed writes retried before the value is left unsaved
+#define AI_TOY_SETTINGS_RETRY_CAP_MS    30000   // retry delay doubles from the window up to this
+
+/**
+ * @brief called once per window with the value that was just persisted, after
+ *        the retries when the flash write fails
+ *
+ * @param volume current volume
+ * @param report_mask OR of every mask passed to ai_toy_settings_volume_set in the window
+ */
+typedef VOID (*AI_TOY_SETTINGS_FLUSH_CB)(UINT8_T volume, UINT32_T report_mask);
+
+typedef struct {
+    UINT32_T    changes;        ///< volume_set calls that changed the value
+    UINT32_T    flash_writes;   ///< KV writes issued
+    UINT32_T    flash_fails;
+    UINT32_T    gave_up;        ///< windows closed unsaved after AI_TOY_SETTINGS_RETRY_MAX retries
+    UINT32_T    flushes;        ///< windows closed, one flush callback each
+} AI_TOY_SETTINGS_STAT_T;
+
+/**
+ * @brief load the persisted settings
+ *
+ * @param volume [in] default, [out] persisted volume, left untouched when
+ *        nothing valid is stored; the store starts from it either way
+ */
+OPERATE_RET ai_toy_settings_load(UINT8_T *volume);
+
+/**
+ * @brief set up the write-behind store, must follow ai_toy_wheel_init
+ */
+OPERATE_RET ai_toy_settings_init(AI_TOY_SETTINGS_FLUSH_CB cb);
+
+/**
+ * @brief record a new volume, the flash write and the flush callback follow
+ *        at most AI_TOY_SETTINGS_WINDOW_MS later
+ *
+ * The caller applies the volume to the codec itself, right away.
+ */
+VOID ai_toy_settings_volume_set(UINT8_T volume, UINT32_T report_mask);
+
+/**
+ * @brief write anything pending now, before low-power entry or a reboot
+ *
+ * A failed write keeps the value pending and re-arms the flush timer with
+ * backoff, the flush callback waits for the write to succeed or give up.
+ */
+VOID ai_toy_settings_flush(VOID);
+
+/**
+ * @brief drop anything pending and erase the stored settings, for factory reset
+ */
+OPERATE_RET ai_toy_settings_erase(VOID);
+
+VOID ai_toy_settings_window_set(UINT32_T window_ms);
+
+VOID ai_toy_settings_stat_get(AI_TOY_SETTINGS_STAT_T *stat);
+
+#endif /* __AI_TOY_SETTINGS_H__ */
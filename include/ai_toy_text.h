@@ -0,0 +1,52 @@
+#ifndef __AI_TOY_TEXT_H__
+#define __AI_TOY_TEXT_H__
+
+#include "tuya_cloud_types.h"
+
+#define AI_TOY_TEXT_LINE_SIZE           128     // line buffer, terminator included
+
+/**
+ * @brief line sink of a text stream
+ *
+ * @param line NUL terminated, never splits a UTF-8 codepoint unless the
+ *             stream is stopped on one
+ * @param len bytes before the terminator
+ */
+typedef VOID (*AI_TOY_TEXT_LINE_CB)(CONST CHAR_T *line, UINT_T len, VOID *arg);
+
+typedef struct {
+    CHAR_T                       buf[AI_TOY_TEXT_LINE_SIZE];
+    UINT_T                       len;
+    AI_TOY_TEXT_LINE_CB          line_cb;
+    VOID                        *arg;
+} AI_TOY_TEXT_STREAM_T;
+
+/**
+ * @brief length of the longest prefix of buf that ends on a UTF-8 codepoint boundary
+ *
+ * A buffer without any lead byte in its last 4 bytes is not UTF-8 and is
+ * returned whole.
+ */
+UINT_T ai_toy_utf8_complete_len(CONST CHAR_T *buf, UINT_T len);
+
+VOID ai_toy_text_stream_init(AI_TOY_TEXT_STREAM_T *st, AI_TOY_TEXT_LINE_CB line_cb, VOID *arg);
+
+/**
+ * @brief drop any partial line of the previous stream
+ */
+VOID ai_toy_text_stream_start(AI_TOY_TEXT_STREAM_T *st);
+
+/**
+ * @brief append streamed text, full lines go to the sink
+ *
+ * An incomplete codepoint at the end of a full line (at most 3 bytes) is
+ * carried over to the next line.
+ */
+VOID ai_toy_text_stream_put(AI_TOY_TEXT_STREAM_T *st, CONST UCHAR_T *data, UINT_T len);
+
+/**
+ * @brief flush whatever is left, complete or not
+ */
+VOID ai_toy_text_stream_stop(AI_TOY_TEXT_STREAM_T *st);
+
+#endif /* __AI_TOY_TEXT_H__ */
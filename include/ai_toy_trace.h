@@ -0,0 +1,111 @@
+#ifndef __AI_TOY_TRACE_H__
+#define __AI_TOY_TRACE_H__
+
+#include "tuya_cloud_types.h"
+#include "tal_system.h"
+
+#ifndef AI_TOY_TRACE_ENABLE
+#define AI_TOY_TRACE_ENABLE             1
+#endif
+
+/**
+ * monotonic microsecond clock behind every latency figure (trace points, wake,
+ * LED stats and bench, event trace). Cortex-M parts with a DWT count CPU
+ * cycles, see ai_toy_trace_now_us(); other targets fall back to the
+ * millisecond tick. Boards with a free running us timer can override it.
+ */
+#ifndef AI_TOY_TRACE_CYCCNT
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+#define AI_TOY_TRACE_CYCCNT             1
+#else
+#define AI_TOY_TRACE_CYCCNT             0
+#endif
+#endif
+
+// CPU clock of the cycle counter, 0 = measure it against the millisecond tick
+#ifndef AI_TOY_TRACE_CPU_MHZ
+#define AI_TOY_TRACE_CPU_MHZ            0
+#endif
+
+#ifndef AI_TOY_TRACE_NOW_US
+#if AI_TOY_TRACE_CYCCNT
+#define AI_TOY_TRACE_NOW_US()           ai_toy_trace_now_us()
+#else
+#define AI_TOY_TRACE_NOW_US()           ((UINT64_T)tal_system_get_millisecond() * 1000)
+#endif
+#endif
+
+#define AI_TOY_TRACE_HIST_BUCKETS       32      // log2(us) buckets
+
+typedef enum {
+    AI_TOY_TP_QUEUE,                ///< recorder callback to worker dispatch
+    AI_TOY_TP_LED,                  ///< LED strip / status LED update
+    AI_TOY_TP_PLAYER_STOP,          ///< ai_toy_player_stop
+    AI_TOY_TP_LLM_INTERRUPT,        ///< AI_PROC_INTERRUPT_EVENT sent
+    AI_TOY_TP_ALERT,                ///< wakeup alert tone started
+    AI_TOY_TP_STATE_UPDATE,         ///< ai_toy_state_update
+    AI_TOY_TP_TOTAL,                ///< barge-in trigger to last trace point
+    AI_TOY_TP_MAX
+} AI_TOY_TRACE_POINT_E;
+
+typedef struct {
+    UINT32_T    count;
+    UINT32_T    min_us;
+    UINT32_T    max_us;
+    UINT64_T    sum_us;
+    UINT32_T    bucket[AI_TOY_TRACE_HIST_BUCKETS];
+} AI_TOY_TRACE_HIST_T;
+
+#if AI_TOY_TRACE_CYCCNT
+/**
+ * @brief microseconds since the first call, from the DWT cycle counter
+ */
+UINT64_T ai_toy_trace_now_us(VOID);
+#endif
+
+#if AI_TOY_TRACE_ENABLE
+extern volatile BOOL_T g_ai_toy_trace_on;
+
+/**
+ * @brief start a barge-in trace, the following points measure the step since the previous one
+ *
+ * @param stamp_us low 32 bits of AI_TOY_TRACE_NOW_US() when the trigger was
+ *                 seen, the wait until now is the queue step; 0 starts now
+ */
+VOID ai_toy_trace_begin(UINT32_T stamp_us);
+
+VOID ai_toy_trace_point(AI_TOY_TRACE_POINT_E tp);
+
+/**
+ * @brief close the trace and record the total latency
+ */
+VOID ai_toy_trace_end(VOID);
+
+// disabled at runtime the trace points cost a single load and branch
+#define AI_TOY_TRACE_BEGIN(stamp_us)    do { if (g_ai_toy_trace_on) { ai_toy_trace_begin(stamp_us); } } while (0)
+#define AI_TOY_TRACE_POINT(tp)          do { if (g_ai_toy_trace_on) { ai_toy_trace_point(tp); } } while (0)
+#define AI_TOY_TRACE_END()              do { if (g_ai_toy_trace_on) { ai_toy_trace_end(); } } while (0)
+#else
+#define AI_TOY_TRACE_BEGIN(stamp_us)    do { } while (0)
+#define AI_TOY_TRACE_POINT(tp)          do { } while (0)
+#define AI_TOY_TRACE_END()              do { } while (0)
+#endif
+
+/**
+ * @brief enable or disable trace collection at runtime
+ */
+VOID ai_toy_trace_enable(BOOL_T enable);
+
+/**
+ * @brief copy the histogram of one trace point
+ */
+OPERATE_RET ai_toy_trace_hist_get(AI_TOY_TRACE_POINT_E tp, AI_TOY_TRACE_HIST_T *hist);
+
+/**
+ * @brief log min/avg/p99/max of every trace point
+ */
+VOID ai_toy_trace_dump(VOID);
+
+VOID ai_toy_trace_reset(VOID);
+
+#endif /* __AI_TOY_TRACE_H__ */
@@ -0,0 +1,66 @@
+#ifndef __AI_TOY_WAKE_H__
+#define __AI_TOY_WAKE_H__
+
+#include "tuya_cloud_types.h"
+
+#define AI_TOY_WAKE_AUDIO_MAX           (10 * 1000 * 1000)  // us, a later first frame is not part of the wake
+
+/**
+ * wake path from keep-alive, in the order the stages complete
+ *
+ * The key callback stamps every press, the worker decides whether it was a
+ * wake. The critical stages run on the worker while it handles the key, the
+ * background ones in a follow-up worker event once the recorder is going.
+ */
+typedef enum {
+    AI_TOY_WAKE_ST_DISPATCH,            ///< key callback -> worker picks the key up
+    AI_TOY_WAKE_ST_CPU,                 ///< tal_cpu_lp_disable
+    AI_TOY_WAKE_ST_ACK,                 ///< PA on and LED ring restored
+    AI_TOY_WAKE_ST_RECORDER,            ///< audio_recorder_start returned
+    AI_TOY_WAKE_ST_WIFI,                ///< background: tal_wifi_lp_disable
+    AI_TOY_WAKE_ST_PERIPH,              ///< background: LCD, battery, RSSI sampling
+    AI_TOY_WAKE_ST_AUDIO,               ///< first audio frame from the recorder
+    AI_TOY_WAKE_ST_MAX
+} AI_TOY_WAKE_STAGE_E;
+
+typedef struct {
+    UINT32_T    count;
+    UINT32_T    last_us;                ///< since the key press
+    UINT32_T    max_us;
+    UINT64_T    sum_us;
+} AI_TOY_WAKE_STAGE_STAT_T;
+
+typedef struct {
+    UINT32_T                    wakes;
+    AI_TOY_WAKE_STAGE_STAT_T    stage[AI_TOY_WAKE_ST_MAX];
+} AI_TOY_WAKE_STAT_T;
+
+OPERATE_RET ai_toy_wake_init(VOID);
+
+/**
+ * @brief open a wake for a key press that found the device in keep-alive,
+ *        from the worker
+ *
+ * @param stamp_us low 32 bits of AI_TOY_TRACE_NOW_US() in the key callback,
+ *        0 = now
+ */
+VOID ai_toy_wake_press(UINT32_T stamp_us);
+
+/**
+ * @brief a stage of the current wake completed, no-op when no wake is open
+ *
+ * Marking AI_TOY_WAKE_ST_RECORDER arms the first audio frame measurement.
+ */
+VOID ai_toy_wake_mark(AI_TOY_WAKE_STAGE_E stage);
+
+/**
+ * @brief recorder delivered audio, from the recorder callback; only the first
+ *        frame after the recorder was started by a wake is recorded
+ */
+VOID ai_toy_wake_audio(VOID);
+
+VOID ai_toy_wake_stat_get(AI_TOY_WAKE_STAT_T *stat);
+
+VOID ai_toy_wake_dump(VOID);
+
+#endif /* __AI_TOY_WAKE_H__ */
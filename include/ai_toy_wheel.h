@@ -0,0 +1,123 @@
+#ifndef __AI_TOY_WHEEL_H__
+#define __AI_TOY_WHEEL_H__
+
+#include "tuya_cloud_types.h"
+
+#define AI_TOY_WHEEL_TICK_MS            5       // wheel resolution
+#define AI_TOY_WHEEL_POOL               16      // pending deferred calls
+
+typedef VOID (*AI_TOY_WHEEL_CB)(VOID *arg);
+
+/**
+ * @brief persistent wheel timer, storage is owned by the caller
+ *
+ * Arm and cancel are O(1). A timer may fire up to slack after its deadline
+ * so that it can share a wake-up with its neighbours, keep it zero for
+ * animation steps and generous for timeouts.
+ *
+ * Cancel does not wait for a callback that is already running. Every arm and
+ * cancel bumps gen; a callback that hands its work to another thread passes
+ * ai_toy_wheel_fired_gen() along, and the work is stale once
+ * ai_toy_wheel_gen_current() says so.
+ */
+typedef struct ai_toy_wheel_timer {
+    struct ai_toy_wheel_timer  *next;
+    struct ai_toy_wheel_timer **pprev;      ///< NULL while not armed
+    UINT32_T                    expire;     ///< absolute tick
+    UINT32_T                    slack;      ///< ticks
+    AI_TOY_WHEEL_CB             cb;
+    VOID                       *arg;
+    BOOL_T                      pooled;     ///< one-shot node from the defer pool
+    UINT8_T                     clk;        ///< real or manual clock, see ai_toy_wheel_timer_manual
+    BOOL_T                      due;        ///< collected, waiting for its callback
+    UINT32_T                    gen;        ///< bumped by every arm and cancel
+    UINT32_T                    fired_gen;  ///< gen of the arm whose callback runs
+} AI_TOY_WHEEL_TIMER_T;
+
+typedef struct {
+    UINT32_T    deferred;
+    UINT32_T    fired;
+    UINT32_T    full;       ///< defer calls refused, pool exhausted
+    UINT32_T    max_pending;
+    UINT32_T    wakeups;    ///< driving timer expirations
+    UINT32_T    coalesced;  ///< timers that rode along on another timer's wake-up
+} AI_TOY_WHEEL_STAT_T;
+
+/**
+ * @brief create the wheel and its driving timer
+ *
+ * The driving timer is one-shot and aimed at the next wake-up, nothing
+ * ticks while the wheel is idle. Safe to call more than once.
+ */
+OPERATE_RET ai_toy_wheel_init(VOID);
+
+/**
+ * @brief prepare a persistent timer, it stays disarmed until ai_toy_wheel_arm
+ */
+VOID ai_toy_wheel_timer_init(AI_TOY_WHEEL_TIMER_T *timer, AI_TOY_WHEEL_CB cb, VOID *arg, UINT32_T slack_ms);
+
+/**
+ * @brief arm the timer delay_ms from now, re-arming it if already pending
+ */
+OPERATE_RET ai_toy_wheel_arm(AI_TOY_WHEEL_TIMER_T *timer, UINT32_T delay_ms);
+
+/**
+ * @brief disarm the timer, a no-op if it is not pending
+ */
+VOID ai_toy_wheel_cancel(AI_TOY_WHEEL_TIMER_T *timer);
+
+/**
+ * @brief cancel, then wait for a callback of the timer that is still running
+ *
+ * For teardown before the timer or its argument is freed. The callback must
+ * not re-arm itself, and it must not be called from the callback.
+ */
+VOID ai_toy_wheel_cancel_sync(AI_TOY_WHEEL_TIMER_T *timer);
+
+BOOL_T ai_toy_wheel_is_armed(AI_TOY_WHEEL_TIMER_T *timer);
+
+/**
+ * @brief arm generation the running callback fired for, call it from the callback
+ */
+UINT32_T ai_toy_wheel_fired_gen(CONST AI_TOY_WHEEL_TIMER_T *timer);
+
+/**
+ * @brief TRUE while the timer was neither armed nor cancelled since the arm of gen
+ */
+BOOL_T ai_toy_wheel_gen_current(AI_TOY_WHEEL_TIMER_T *timer, UINT32_T gen);
+
+/**
+ * @brief run cb once, about delay_ms from now, instead of sleeping
+ *
+ * Callbacks run on the software timer thread, outside the wheel lock, and
+ * may defer or arm again. Accuracy is one AI_TOY_WHEEL_TICK_MS.
+ *
+ * @return OPERATE_RET OPRT_EXCEED_UPPER_LIMIT when AI_TOY_WHEEL_POOL calls are pending
+ */
+OPERATE_RET ai_toy_wheel_defer(UINT32_T delay_ms, AI_TOY_WHEEL_CB cb, VOID *arg);
+
+VOID ai_toy_wheel_stat_get(AI_TOY_WHEEL_STAT_T *stat);
+
+/**
+ * @brief move a persistent timer onto the manual clock or back, for benchmarks
+ *        and simulation; the timer is cancelled first
+ *
+ * Time on the manual clock only moves in ai_toy_wheel_advance, which runs the
+ * callbacks on the calling thread. Every other timer keeps real time on the
+ * software timer thread, so a benchmark can run while the rest is up.
+ */
+VOID ai_toy_wheel_timer_manual(AI_TOY_WHEEL_TIMER_T *timer, BOOL_T manual);
+
+/**
+ * @brief move the manual clock ms forward, firing every wake-up on the way
+ *        at its own virtual time
+ */
+VOID ai_toy_wheel_advance(UINT32_T ms);
+
+/**
+ * @brief current manual clock in ms; a callback run by ai_toy_wheel_advance
+ *        sees its own wake-up time
+ */
+UINT32_T ai_toy_wheel_manual_ms(VOID);
+
+#endif /* __AI_TOY_WHEEL_H__ */
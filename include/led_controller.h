@@ -5,12 +5,20 @@
 #include "tal_sw_timer.h"
 #include "tal_gpio.h"
 #include "ws2812_spi.h"
+#include "led_effect.h"
 
 // ========================== 时间参数配置 ==========================
-// 自检时间参数
+// 自检时间参数（可由板级配置覆盖以缩短自检）
+#ifndef INIT_RED_TIME
 #define INIT_RED_TIME     1000    // 红色显示时间 (ms)
+#endif
+#ifndef INIT_GREEN_TIME
 #define INIT_GREEN_TIME   1000    // 绿色显示时间 (ms)
+#endif
+#ifndef INIT_BLUE_TIME
 #define INIT_BLUE_TIME    1000    // 蓝色显示时间 (ms)
+#endif
+#define LED_SELFTEST_TOTAL_TIME (INIT_RED_TIME + INIT_GREEN_TIME + INIT_BLUE_TIME)
 
 // 状态超时参数
 #define CONFIG_SUCCESS_TIMEOUT  2000  // 配网成功显示时间 (ms)
@@ -35,9 +43,44 @@ typedef enum {
     LED_NET_ERROR,    ///< 网络异常（红灯常亮）
     LED_DIALOG,       ///< 对话中（蓝灯闪烁）
     LED_VOLUME,       ///< 调节音量（黄灯等级显示）
-    LED_BREATHING     ///< 呼吸灯效果（蓝灯呼吸）
+    LED_BREATHING,    ///< 呼吸灯效果（蓝灯呼吸）
+    LED_SIGNAL_METER, ///< 信号强度表（实时等级显示，红/黄/绿按强度变色，不超时）
+    LED_EFFECT,       ///< 逐像素效果（彩虹/彗星/跑马灯/闪烁，LED_EFFECT_INTERVAL 帧周期，不超时）
+    LED_STATE_MAX
 } LedState;
 
+// 上电自检计时（单位 ms，均相对自检开始）
+typedef struct {
+    uint32_t run_ms;          ///< 自检实际持续时间
+    uint32_t saved_ms;        ///< 被提前结束而省下的自检时间
+    uint32_t first_state_ms;  ///< 首个非空闲状态请求的时刻，0=尚无
+    LedState first_state;     ///< 首个非空闲状态
+    LedState preempted_by;    ///< 结束自检的状态，LED_INIT=正常结束或快速启动结束
+    uint8_t steps_done;       ///< 结束时已完成的颜色步数(0-3)
+} LedSelftestStats;
+
+// 低功耗唤醒恢复计时（从调用 resume 到最后一帧发送完成，单位 ms）
+typedef struct {
+    uint32_t last_ms;         ///< 最近一次恢复耗时
+    uint32_t max_ms;          ///< 最大恢复耗时
+    uint32_t count;           ///< 恢复次数
+} LedResumeStats;
+
+// LED 控制器统计（可常开，供日志命令或调试 DP 读取）
+typedef struct {
+    uint32_t transitions[LED_STATE_MAX]; ///< 进入各状态的次数（含超时回到空闲）
+    uint32_t timer_cbs;       ///< 主定时器回调次数
+    uint32_t stale_cbs;       ///< 派发后定时器已重启或停止而丢弃的回调次数
+    uint32_t jitter_count;    ///< 呼吸步进间隔采样数
+    int32_t jitter_min_us;    ///< 实际间隔减 BREATH_TIMER_INTERVAL 的最小值
+    int32_t jitter_max_us;    ///< 同上，最大值
+    int64_t jitter_sum_us;
+    Ws2812Stats drv;          ///< WS2812 驱动统计
+} LedStats;
+
+// led_controller_stats_json() 所有计数取满位数时的长度（含结束符）
+#define LED_STATS_JSON_MAX  (187 + LED_STATE_MAX * 11)
+
 /**
  * @brief 初始化LED控制器
  * 
@@ -56,12 +99,94 @@ void led_controller_init(void);
  * @param value 状态附加参数：
  *   - LED_CONFIG_SUCCESS: WIFI信号强度(0-8)
  *   - LED_VOLUME: 音量等级(0-8)
+ *   - LED_SIGNAL_METER: 滤波后的信号等级(0-12)，重复设置只刷新等级
+ *   - LED_EFFECT: 效果编号(LedEffectId)，无效编号忽略本次请求
  *   - 其他状态: 忽略此参数
  * 
  * 状态转换说明：
- * 1. 如果当前处于自检状态，新状态将被缓存，自检完成后自动执行
+ * 1. 自检是低优先级叠加层：自检中收到空闲请求时自检继续，
+ *    收到其他状态时立即结束自检并执行该状态，不缓存、不丢弃
  * 2. 其他状态下立即执行新状态，并清理前一个状态的资源
  */
 void set_led_state(LedState new_state, uint8_t value);
 
+/**
+ * @brief 立即结束上电自检（快速启动）
+ * 
+ * 自检未在进行时无操作；否则停止自检、熄灭灯带并进入空闲。
+ * 自检期间收到的非空闲状态已直接结束自检，不会留到此时执行。
+ */
+void led_controller_selftest_finish(void);
+
+/**
+ * @brief 获取上电自检计时，用于衡量自检对启动到首个状态显示的影响
+ */
+void led_controller_selftest_stats_get(LedSelftestStats *stats);
+
+/**
+ * @brief 低功耗挂起LED
+ * 
+ * 停止动画定时器，熄灭灯带并关闭 SPI，释放编码缓冲区。
+ * 挂起期间的状态请求只更新影子帧，不刷新、不启动定时器。
+ * 与状态请求、定时器回调持同一把锁；挂起后才执行的回调直接返回。
+ */
+void led_controller_suspend(void);
+
+/**
+ * @brief 从低功耗唤醒LED
+ * 
+ * 重新打开 SPI，一次刷新恢复最后一帧，并按当前状态继续动画；
+ * 恢复耗时记入 LedResumeStats。
+ */
+void led_controller_resume(void);
+
+/**
+ * @brief 获取唤醒恢复耗时
+ */
+void led_controller_resume_stats_get(LedResumeStats *stats);
+
+/**
+ * @brief 获取LED控制器及驱动统计
+ */
+void led_controller_stats_get(LedStats *stats);
+
+/**
+ * @brief 清零LED控制器及驱动统计
+ */
+void led_controller_stats_reset(void);
+
+/**
+ * @brief 日志输出统计
+ */
+void led_controller_stats_dump(void);
+
+/**
+ * @brief 统计格式化为紧凑 JSON，用于调试 DP 上报
+ * 
+ * 缓冲区不小于 LED_STATS_JSON_MAX 时不会截断。
+ * 
+ * @return int 写入长度（不含结束符），截断时为 -1
+ */
+int led_controller_stats_json(char *buf, uint32_t size);
+
+/**
+ * @brief 将状态定时器切到时间轮手动时钟或切回，供基准和仿真用 ai_toy_wheel_advance 推进
+ * 
+ * 切换时取消当前定时器；只影响 LED 控制器，其他时间轮定时器照常按真实时间触发。
+ */
+void led_controller_clock_manual(BOOL_T manual);
+
+#if WS2812_BENCH
+/**
+ * @brief 运行 LED 性能基准，结果按行输出 "LEDBENCH {json}"
+ * 
+ * 覆盖单像素/整帧设置、12~1024 灯珠整帧编码、等级显示、12~1024 灯珠
+ * 逐像素效果（渲染加编码）的每帧耗时，以及每个状态
+ * 模拟运行一分钟的定时器回调次数、发送帧数和字节数。发送经钩子计数，
+ * 不占用 SPI；耗时项各至少运行 WS2812_BENCH_MIN_US；状态模拟只把 LED
+ * 状态定时器切到手动时钟，可在其他模块运行时执行。
+ */
+void led_controller_bench_run(void);
+#endif
+
 #endif /* __LED_CONTROLLER_H__ */
\ No newline at end of file
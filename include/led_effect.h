@@ -0,0 +1,74 @@
+#ifndef __LED_EFFECT_H__
+#define __LED_EFFECT_H__
+
+#include "tuya_cloud_types.h"
+
+// ========================== 效果参数配置 ==========================
+#define LED_EFFECT_INTERVAL         15    // 效果帧周期 (ms)，约 66 fps，取时间轮刻度的整数倍
+
+#define LED_EFFECT_RAINBOW_CYCLE_MS 2048  // 彩虹转一圈的时间 (ms)
+#define LED_EFFECT_COMET_CYCLE_MS   1200  // 彗星绕灯带一圈的时间 (ms)
+#define LED_EFFECT_COMET_TAIL_DIV   3     // 彗尾长度为灯珠数的 1/3
+#define LED_EFFECT_CHASE_STEP_MS    120   // 跑马灯步进间隔 (ms)
+#define LED_EFFECT_CHASE_SPACING    3     // 跑马灯每隔几颗亮一颗
+#define LED_EFFECT_SPARKLE_FADE     200   // 闪烁每帧衰减系数 (/256)
+#define LED_EFFECT_SPARKLE_DIV      16    // 每帧新增闪点数为灯珠数的 1/16（至少 1 个）
+
+// ========================== 效果定义 ==========================
+typedef enum {
+    LED_EFFECT_RAINBOW,   ///< 彩虹流动（逐像素色相偏移）
+    LED_EFFECT_COMET,     ///< 彗星（亮头加渐暗拖尾绕圈）
+    LED_EFFECT_CHASE,     ///< 跑马灯（等间隔亮点步进）
+    LED_EFFECT_SPARKLE,   ///< 闪烁（随机闪点逐帧衰减）
+    LED_EFFECT_MAX
+} LedEffectId;
+
+/**
+ * 帧缓冲：R/G/B 分通道连续数组（结构数组转数组结构），效果按整条通道
+ * 数组处理，循环无分支，便于编译器自动向量化，灯珠数不限于 WS2812_LED_COUNT
+ */
+typedef struct {
+    uint8_t *r;
+    uint8_t *g;
+    uint8_t *b;
+    uint16_t count;
+} LedFrame;
+
+// 效果运行参数
+typedef struct {
+    uint8_t r, g, b;      ///< 主色（彩虹忽略）
+    uint8_t level;        ///< 整体亮度 (0-255)
+    uint32_t rng;         ///< 随机数状态（闪烁），非 0
+} LedEffectCtx;
+
+/**
+ * @brief 效果函数：按时间渲染整帧
+ *
+ * @param fb 帧缓冲，内容保留上一帧（闪烁在此基础上衰减）
+ * @param t_ms 效果开始后的时间
+ * @param ctx 运行参数
+ */
+typedef void (*LedEffectFn)(const LedFrame *fb, uint32_t t_ms, LedEffectCtx *ctx);
+
+typedef struct {
+    const char *name;
+    LedEffectFn render;
+    uint8_t r, g, b;      ///< 默认主色
+} LedEffect;
+
+/**
+ * @brief 获取效果描述，id 无效时返回 NULL
+ */
+const LedEffect *led_effect_get(LedEffectId id);
+
+/**
+ * @brief 按效果默认主色初始化运行参数
+ */
+void led_effect_ctx_init(LedEffectCtx *ctx, LedEffectId id, uint8_t level);
+
+void led_effect_rainbow(const LedFrame *fb, uint32_t t_ms, LedEffectCtx *ctx);
+void led_effect_comet(const LedFrame *fb, uint32_t t_ms, LedEffectCtx *ctx);
+void led_effect_chase(const LedFrame *fb, uint32_t t_ms, LedEffectCtx *ctx);
+void led_effect_sparkle(const LedFrame *fb, uint32_t t_ms, LedEffectCtx *ctx);
+
+#endif /* __LED_EFFECT_H__ */
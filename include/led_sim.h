@@ -0,0 +1,44 @@
+#ifndef __LED_SIM_H__
+#define __LED_SIM_H__
+
+#include "tuya_cloud_types.h"
+#include "led_controller.h"
+
+// LED 仿真（开发用）：置 1 时 LED 控制器初始化先按内置脚本跑一遍仿真
+#ifndef WS2812_SIM
+#define WS2812_SIM 0
+#endif
+
+#if WS2812_SIM
+
+// 仿真脚本的一步：在 at_ms（虚拟时间，相对仿真开始）设置状态
+typedef struct {
+    uint32_t at_ms;
+    LedState state;
+    uint8_t value;
+} LedSimStep;
+
+/**
+ * @brief 按脚本驱动 set_led_state 并输出逐帧时间线
+ * 
+ * 使用时间轮手动时钟推进虚拟时间，发送数据经钩子截获并解码回 RGB，
+ * 不经过 SPI，也不等待真实时间。日志输出（均以 "LEDSIM " 开头）：
+ *   - CSV 表头与逐帧数据：t_ms,frame,led1..ledN（RRGGBB）
+ *   - 每段脚本一条 JSON 小结：帧数、定时器步数、同一时刻连发的帧数、
+ *     最小/最大帧间隔（只在不同时刻的帧之间统计）、解码错误字节数
+ * 
+ * @param script 按 at_ms 升序的脚本
+ * @param steps 脚本步数
+ * @param duration_ms 仿真总时长，不短于最后一步
+ * @return OPERATE_RET 返回操作结果
+ */
+OPERATE_RET led_sim_run(const LedSimStep *script, uint32_t steps, uint32_t duration_ms);
+
+/**
+ * @brief 运行内置脚本：自检、配网呼吸、信号显示、对话闪烁、呼吸、音量、空闲
+ */
+OPERATE_RET led_sim_run_default(void);
+
+#endif
+
+#endif /* __LED_SIM_H__ */
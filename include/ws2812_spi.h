@@ -15,6 +15,42 @@
 #define WS2812_SPI_FREQ        4500000//5//6    // 8 MHz
 #define WS2812_RESET_DELAY_MS  1          // > 50 μs
 
+// 性能基准（开发用）：置 1 时 LED 控制器初始化先跑一遍基准，结果以
+// "LEDBENCH {json}" 每行一条输出到日志，便于跨版本比较
+#ifndef WS2812_BENCH
+#define WS2812_BENCH 0
+#endif
+#define WS2812_BENCH_PRINT(fmt, ...)  TAL_PR_NOTICE("LEDBENCH " fmt, ##__VA_ARGS__)
+#ifndef WS2812_BENCH_MIN_US
+#define WS2812_BENCH_MIN_US    (1000 * 1000)  // 每项按批重复到至少 1s，毫秒时钟下误差也在 0.1% 以内
+#endif
+
+/**
+ * @brief 发送钩子：设置后刷新数据交给钩子而不经过 SPI，用于基准和仿真
+ */
+typedef OPERATE_RET (*WS2812_SPI_TX_HOOK)(const UCHAR_T *buf, UINT32_T len);
+
+// 耗时统计（单位 us，时钟为 AI_TOY_TRACE_NOW_US）：Cortex-M 用 DWT 周期计数；
+// 其他目标退回毫秒节拍，单帧耗时不足 1ms 时读数为 0，板级可替换为 us 定时器
+typedef struct {
+    UINT32_T count;
+    UINT32_T min_us;
+    UINT32_T max_us;
+    UINT64_T sum_us;
+} Ws2812TimeStat;
+
+// 驱动统计：每帧只有几次加法和两次取时钟，可常开
+typedef struct {
+    UINT32_T pixels_encoded;   ///< 颜色有变化、重新编码的像素
+    UINT32_T pixels_unchanged; ///< 颜色未变、跳过编码的像素
+    UINT32_T frames_encoded;   ///< 刷新的帧
+    UINT32_T frames_sent;      ///< 成功发送的帧
+    UINT32_T frames_skipped;   ///< 挂起中而未发送的帧
+    UINT32_T send_errors;      ///< tkl_spi_send 失败次数
+    Ws2812TimeStat encode;     ///< 每帧编码耗时
+    Ws2812TimeStat send;       ///< 每帧 SPI 发送耗时
+} Ws2812Stats;
+
 /**
  * @brief 初始化 WS2812 SPI 驱动并分配缓冲区
  * 
@@ -58,6 +94,61 @@ OPERATE_RET ws2812_spi_deinit(VOID_T);
  */
 OPERATE_RET ws2812_spi_set_all(UCHAR_T red, UCHAR_T green, UCHAR_T blue);
 
+/**
+ * @brief 整帧设置，颜色按 R/G/B 分通道数组给出（各 WS2812_LED_COUNT 个）
+ * 
+ * 与影子帧整帧比较，只重新编码有变化的像素；用于逐像素效果和等级显示。
+ * 
+ * @return OPERATE_RET 返回操作结果
+ */
+OPERATE_RET ws2812_spi_set_frame(const UCHAR_T *red, const UCHAR_T *green, const UCHAR_T *blue);
+
+/**
+ * @brief 将分通道帧编码为 SPI 数据（每灯 24 字节），不涉及驱动状态，可用于任意灯珠数
+ */
+VOID_T ws2812_spi_encode_frame(UCHAR_T *dst, const UCHAR_T *red, const UCHAR_T *green, const UCHAR_T *blue,
+                               UINT16_T count);
+
+/**
+ * @brief 低功耗挂起：熄灭灯带，关闭 SPI 并释放编码缓冲区
+ * 
+ * 挂起期间 set_pixel/set_all 只更新 RGB 影子帧，refresh 不发送。
+ * 
+ * @return OPERATE_RET 返回操作结果
+ */
+OPERATE_RET ws2812_spi_suspend(VOID_T);
+
+/**
+ * @brief 唤醒：重新初始化 SPI，并用一次刷新恢复挂起前（或挂起期间更新）的帧
+ * 
+ * @return OPERATE_RET 返回操作结果
+ */
+OPERATE_RET ws2812_spi_resume(VOID_T);
+
+BOOL_T ws2812_spi_is_suspended(VOID_T);
+
+/**
+ * @brief 获取驱动统计
+ */
+VOID_T ws2812_spi_stats_get(Ws2812Stats *stats);
+
+/**
+ * @brief 清零驱动统计
+ */
+VOID_T ws2812_spi_stats_reset(VOID_T);
+
+/**
+ * @brief 设置发送钩子，NULL 恢复 SPI 发送
+ */
+VOID_T ws2812_spi_tx_hook_set(WS2812_SPI_TX_HOOK hook);
+
+#if WS2812_BENCH
+/**
+ * @brief 整帧编码基准（12~1024 灯珠）
+ */
+VOID_T ws2812_spi_bench_encode(VOID_T);
+#endif
+
 VOID_T ws2812_app_init(VOID_T);
 VOID_T ws2812_Breathing(VOID_T) ;
 #endif // __WS2812_SPI_H__
@@ -0,0 +1,336 @@
+#include "ai_toy_alert_cache.h"
+#include "tal_log.h"
+#include "tal_mutex.h"
+#include "tal_queue.h"
+#include "tal_semaphore.h"
+#include "tal_thread.h"
+#include "tkl_audio.h"
+#include "tal_memory.h"
+#include <string.h>
+
+typedef enum {
+    ALERT_CACHE_CMD_FILL,
+    ALERT_CACHE_CMD_PLAY,
+    ALERT_CACHE_CMD_EXIT,
+} alert_cache_cmd_t;
+
+typedef struct {
+    alert_cache_cmd_t            cmd;
+    CONST CHAR_T                *key;
+    UINT32_T                     key_len;
+    UINT32_T                     seq;           // PLAY only
+} alert_cache_msg_t;
+
+typedef struct {
+    CONST CHAR_T                *key;           // MP3 asset address
+    UCHAR_T                     *pcm;
+    UINT32_T                     pcm_len;
+    UINT32_T                     last_use;      // LRU clock
+} alert_cache_entry_t;
+
+typedef struct {
+    alert_cache_entry_t          entry[AI_TOY_ALERT_PCM_CACHE_ENTRIES];
+    UINT32_T                     clock;
+    AI_TOY_PCM_DECODE_CB         decode;
+    CONST AI_TOY_ALERT_CACHE_OUT_T *out;
+    MUTEX_HANDLE                 mutex;
+    QUEUE_HANDLE                 queue;
+    SEM_HANDLE                   done;          // posted by the worker on its way out
+    THREAD_HANDLE                thread;
+    UINT32_T                     playing;       // PLAY messages queued or running, under mutex
+    UINT32_T                     play_seq;      // last PLAY posted, under mutex
+    volatile UINT32_T            stop_seq;      // PLAYs up to this one are aborted
+    AI_TOY_ALERT_CACHE_STAT_T    stat;
+} alert_cache_t;
+
+STATIC alert_cache_t s_alert_cache;
+
+// caller holds mutex
+STATIC alert_cache_entry_t *__cache_find(CONST CHAR_T *key)
+{
+    for (INT_T i = 0; i < AI_TOY_ALERT_PCM_CACHE_ENTRIES; i++) {
+        if (s_alert_cache.entry[i].key == key && s_alert_cache.entry[i].pcm) {
+            return &s_alert_cache.entry[i];
+        }
+    }
+    return NULL;
+}
+
+// caller holds mutex, returns a free slot first when want_free is set
+STATIC alert_cache_entry_t *__cache_lru(BOOL_T want_free)
+{
+    alert_cache_entry_t *lru = NULL;
+
+    for (INT_T i = 0; i < AI_TOY_ALERT_PCM_CACHE_ENTRIES; i++) {
+        alert_cache_entry_t *e = &s_alert_cache.entry[i];
+        if (NULL == e->pcm) {
+            if (want_free) {
+                return e;
+            }
+            continue;
+        }
+        if (NULL == lru || e->last_use < lru->last_use) {
+            lru = e;
+        }
+    }
+    return lru;
+}
+
+// caller holds mutex
+STATIC VOID __cache_evict(alert_cache_entry_t *e)
+{
+    if (e->pcm) {
+        tkl_system_psram_free(e->pcm);
+        s_alert_cache.stat.bytes -= e->pcm_len;
+        s_alert_cache.stat.evictions++;
+    }
+    memset(e, 0, sizeof(alert_cache_entry_t));
+}
+
+STATIC VOID __cache_fill(CONST CHAR_T *key, UINT32_T key_len)
+{
+    alert_cache_t *c = &s_alert_cache;
+    UCHAR_T *pcm = NULL;
+    UINT32_T pcm_len = 0;
+
+    tal_mutex_lock(c->mutex);
+    BOOL_T cached = (NULL != __cache_find(key));
+    tal_mutex_unlock(c->mutex);
+    if (cached) {
+        return;
+    }
+
+    // decode outside the lock, it takes a while
+    if (OPRT_OK != c->decode(key, key_len, &pcm, &pcm_len) || NULL == pcm) {
+        c->stat.fill_fail++;
+        return;
+    }
+    if (pcm_len > c->stat.budget) {
+        tkl_system_psram_free(pcm);
+        c->stat.fill_fail++;
+        return;
+    }
+
+    tal_mutex_lock(c->mutex);
+    // evict least recently used entries until the new one fits the budget
+    while (c->stat.bytes + pcm_len > c->stat.budget) {
+        __cache_evict(__cache_lru(FALSE));
+    }
+    alert_cache_entry_t *slot = __cache_lru(TRUE);
+    if (slot->pcm) {
+        __cache_evict(slot);
+    }
+    slot->key      = key;
+    slot->pcm      = pcm;
+    slot->pcm_len  = pcm_len;
+    slot->last_use = ++c->clock;
+    c->stat.bytes += pcm_len;
+    c->stat.fills++;
+    tal_mutex_unlock(c->mutex);
+
+    TAL_PR_DEBUG("alert cache fill %p, %d -> %d bytes", key, key_len, pcm_len);
+}
+
+// stop() latched an abort for this playback, or for a later one
+STATIC BOOL_T __cache_play_aborted(UINT32_T seq)
+{
+    return (INT32_T)(s_alert_cache.stop_seq - seq) >= 0;
+}
+
+STATIC VOID __cache_play(CONST CHAR_T *key, UINT32_T seq)
+{
+    alert_cache_t *c = &s_alert_cache;
+
+    // the worker is the only one evicting, the entry stays valid while playing
+    tal_mutex_lock(c->mutex);
+    alert_cache_entry_t *e = __cache_find(key);
+    tal_mutex_unlock(c->mutex);
+
+    if (e && !__cache_play_aborted(seq)) {
+        UINT32_T off = 0;
+        // the speaker service leaves the AO to us until end()
+        c->out->begin();
+        while (off < e->pcm_len && !__cache_play_aborted(seq)) {
+            UINT32_T n = MIN(AI_TOY_ALERT_PCM_FRAME_SIZE, e->pcm_len - off);
+            TKL_AUDIO_FRAME_INFO_T frame = {0};
+            frame.pbuf      = (CHAR_T *)e->pcm + off;
+            frame.buf_size  = n;
+            frame.used_size = n;
+            tkl_ao_put_frame(TKL_AUDIO_TYPE_BOARD, TKL_AO_0, NULL, &frame);
+            off += n;
+        }
+        c->out->end(off < e->pcm_len);
+    }
+
+    tal_mutex_lock(c->mutex);
+    c->playing--;
+    tal_mutex_unlock(c->mutex);
+}
+
+STATIC VOID __cache_task(VOID_T *arg)
+{
+    alert_cache_t *c = (alert_cache_t *)arg;
+    alert_cache_msg_t msg;
+
+    for (;;) {
+        if (OPRT_OK != tal_queue_fetch(c->queue, &msg, QUEUE_WAIT_FROEVER)) {
+            continue;
+        }
+        if (ALERT_CACHE_CMD_EXIT == msg.cmd) {
+            break;
+        }
+        if (ALERT_CACHE_CMD_PLAY == msg.cmd) {
+            __cache_play(msg.key, msg.seq);
+        } else {
+            __cache_fill(msg.key, msg.key_len);
+        }
+    }
+    tal_semaphore_post(c->done);
+}
+
+OPERATE_RET ai_toy_alert_cache_init(UINT32_T budget, AI_TOY_PCM_DECODE_CB decode, CONST AI_TOY_ALERT_CACHE_OUT_T *out)
+{
+    OPERATE_RET rt = OPRT_OK;
+    alert_cache_t *c = &s_alert_cache;
+
+    if (NULL == decode || NULL == out || NULL == out->begin || NULL == out->end) {
+        return OPRT_INVALID_PARM;
+    }
+    if (c->thread) {
+        return OPRT_OK;
+    }
+
+    memset(c, 0, sizeof(alert_cache_t));
+    c->decode      = decode;
+    c->out         = out;
+    c->stat.budget = budget;
+
+    TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&c->mutex));
+    TUYA_CALL_ERR_GOTO(tal_queue_create_init(&c->queue, sizeof(alert_cache_msg_t), AI_TOY_ALERT_PCM_CACHE_ENTRIES * 2), __error);
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&c->done, 0, 1), __error);
+
+    THREAD_CFG_T thrd_param = {
+        .stackDepth = 8192,     // MP3 decode runs on this stack
+        .priority   = THREAD_PRIO_3,
+        .thrdname   = "alert_cache",
+    };
+    TUYA_CALL_ERR_GOTO(tal_thread_create_and_start(&c->thread, NULL, NULL, __cache_task, c, &thrd_param), __error);
+
+    TAL_PR_NOTICE("alert pcm cache init, budget %d", budget);
+    return OPRT_OK;
+
+__error:
+    if (c->done) {
+        tal_semaphore_release(c->done);
+        c->done = NULL;
+    }
+    if (c->queue) {
+        tal_queue_free(c->queue);
+        c->queue = NULL;
+    }
+    tal_mutex_release(c->mutex);
+    c->mutex  = NULL;
+    c->thread = NULL;
+    TAL_PR_ERR("alert pcm cache init failed %d", rt);
+    return rt;
+}
+
+VOID ai_toy_alert_cache_deinit(VOID)
+{
+    alert_cache_t *c = &s_alert_cache;
+    alert_cache_msg_t msg = {ALERT_CACHE_CMD_EXIT, NULL, 0, 0};
+
+    if (NULL == c->thread) {
+        return;
+    }
+    // abort the running and queued playbacks, the exit goes behind them
+    ai_toy_alert_cache_stop();
+    tal_queue_post(c->queue, &msg, QUEUE_WAIT_FROEVER);
+    tal_semaphore_wait(c->done, SEM_WAIT_FOREVER);
+
+    for (INT_T i = 0; i < AI_TOY_ALERT_PCM_CACHE_ENTRIES; i++) {
+        __cache_evict(&c->entry[i]);
+    }
+    tal_semaphore_release(c->done);
+    tal_queue_free(c->queue);
+    tal_mutex_release(c->mutex);
+    memset(c, 0, sizeof(alert_cache_t));
+    TAL_PR_NOTICE("alert pcm cache deinit");
+}
+
+OPERATE_RET ai_toy_alert_cache_play(CONST CHAR_T *mp3, UINT32_T mp3_len)
+{
+    alert_cache_t *c = &s_alert_cache;
+    alert_cache_msg_t msg = {ALERT_CACHE_CMD_FILL, mp3, mp3_len, 0};
+
+    if (NULL == c->thread) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    tal_mutex_lock(c->mutex);
+    alert_cache_entry_t *e = __cache_find(mp3);
+    if (NULL == e) {
+        c->stat.misses++;
+        tal_mutex_unlock(c->mutex);
+        // fill in background, the caller plays the MP3 this time
+        tal_queue_post(c->queue, &msg, 0);
+        return OPRT_NOT_FOUND;
+    }
+    e->last_use = ++c->clock;
+    c->stat.hits++;
+    // a new playback gets its own sequence, an abort latched for an earlier one stays
+    msg.cmd = ALERT_CACHE_CMD_PLAY;
+    msg.seq = ++c->play_seq;
+    c->playing++;
+    if (OPRT_OK != tal_queue_post(c->queue, &msg, 0)) {
+        c->playing--;
+        tal_mutex_unlock(c->mutex);
+        return OPRT_COM_ERROR;
+    }
+    tal_mutex_unlock(c->mutex);
+
+    return OPRT_OK;
+}
+
+OPERATE_RET ai_toy_alert_cache_prefetch(CONST CHAR_T *mp3, UINT32_T mp3_len)
+{
+    alert_cache_msg_t msg = {ALERT_CACHE_CMD_FILL, mp3, mp3_len, 0};
+
+    if (NULL == s_alert_cache.thread) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    return tal_queue_post(s_alert_cache.queue, &msg, 0);
+}
+
+VOID ai_toy_alert_cache_stop(VOID)
+{
+    alert_cache_t *c = &s_alert_cache;
+
+    if (NULL == c->thread) {
+        return;
+    }
+    // abort every playback posted so far, later ones play normally
+    tal_mutex_lock(c->mutex);
+    c->stop_seq = c->play_seq;
+    tal_mutex_unlock(c->mutex);
+}
+
+BOOL_T ai_toy_alert_cache_is_playing(VOID)
+{
+    return 0 != s_alert_cache.playing;
+}
+
+VOID ai_toy_alert_cache_stat_get(AI_TOY_ALERT_CACHE_STAT_T *stat)
+{
+    if (stat) {
+        memcpy(stat, &s_alert_cache.stat, sizeof(AI_TOY_ALERT_CACHE_STAT_T));
+    }
+}
+
+VOID ai_toy_alert_cache_dump(VOID)
+{
+    AI_TOY_ALERT_CACHE_STAT_T *st = &s_alert_cache.stat;
+
+    TAL_PR_NOTICE("alert cache: hit %d, miss %d, fill %d, fill_fail %d, evict %d, bytes %d/%d",
+                  st->hits, st->misses, st->fills, st->fill_fail, st->evictions, st->bytes, st->budget);
+}
@@ -0,0 +1,225 @@
+#include "ai_toy_boot.h"
+#include "tal_log.h"
+#include "tal_mutex.h"
+#include "tal_semaphore.h"
+#include "tal_system.h"
+#include "tal_thread.h"
+#include <string.h>
+
+/**
+ * Every runner, the calling thread and the helpers alike, loops on the same
+ * shared table: take the first pending stage whose dependencies are done,
+ * run it without the lock, record the result and wake the others. A stage
+ * whose dependency failed is skipped instead of run. Runners leave when no
+ * stage is pending.
+ */
+typedef struct {
+    MUTEX_HANDLE                mutex;
+    SEM_HANDLE                  wake;       // posted on every stage completion
+    SEM_HANDLE                  exit;       // posted by each helper on its way out
+    CONST AI_TOY_BOOT_STAGE_T  *stages;
+    UINT8_T                     cnt;
+    VOID                       *arg;
+    UINT32_T                    done;       // AI_TOY_BOOT_DEP mask
+    UINT32_T                    failed;     // failed or skipped
+    UINT8_T                     waiting;    // runners blocked on wake
+    OPERATE_RET                 rt;
+    SYS_TIME_T                  t0;
+    AI_TOY_BOOT_TIMING_T        timing[AI_TOY_BOOT_STAGE_MAX];
+    THREAD_HANDLE               helper[AI_TOY_BOOT_WORKERS];
+} ai_toy_boot_t;
+
+typedef struct {
+    ai_toy_boot_t              *boot;
+    UINT8_T                     id;
+} ai_toy_boot_runner_t;
+
+STATIC ai_toy_boot_t s_boot;
+STATIC ai_toy_boot_runner_t s_runner[AI_TOY_BOOT_WORKERS + 1];
+
+STATIC UINT32_T __boot_now(ai_toy_boot_t *b)
+{
+    return (UINT32_T)(tal_system_get_millisecond() - b->t0);
+}
+
+/**
+ * @brief pick the next stage to run, called with the lock held
+ *
+ * @return INT_T stage index, -1 if none is ready yet, -2 if none is pending
+ */
+STATIC INT_T __boot_pick(ai_toy_boot_t *b)
+{
+    BOOL_T pending = FALSE;
+
+    for (UINT8_T i = 0; i < b->cnt; i++) {
+        AI_TOY_BOOT_TIMING_T *t = &b->timing[i];
+        if (AI_TOY_BOOT_PENDING != t->status) {
+            continue;
+        }
+        if (b->stages[i].deps & b->failed) {
+            t->status = AI_TOY_BOOT_SKIPPED;
+            b->failed |= AI_TOY_BOOT_DEP(i);
+            // dependents sit later in the table and see the bit in this same pass
+            TAL_PR_ERR("boot stage %s skipped", b->stages[i].name);
+            continue;
+        }
+        if ((b->stages[i].deps & b->done) == b->stages[i].deps) {
+            return i;
+        }
+        pending = TRUE;
+    }
+    return pending ? -1 : -2;
+}
+
+STATIC VOID __boot_runner(ai_toy_boot_runner_t *r)
+{
+    ai_toy_boot_t *b = r->boot;
+
+    tal_mutex_lock(b->mutex);
+    for (;;) {
+        INT_T idx = __boot_pick(b);
+        if (-2 == idx) {
+            break;
+        }
+        if (-1 == idx) {
+            b->waiting++;
+            tal_mutex_unlock(b->mutex);
+            tal_semaphore_wait(b->wake, SEM_WAIT_FOREVER);
+            tal_mutex_lock(b->mutex);
+            continue;
+        }
+
+        CONST AI_TOY_BOOT_STAGE_T *s = &b->stages[idx];
+        AI_TOY_BOOT_TIMING_T *t = &b->timing[idx];
+        t->status = AI_TOY_BOOT_RUNNING;
+        t->runner = r->id;
+        t->start_ms = __boot_now(b);
+        tal_mutex_unlock(b->mutex);
+
+        OPERATE_RET rt = s->fn(b->arg);
+
+        tal_mutex_lock(b->mutex);
+        t->end_ms = __boot_now(b);
+        t->rt = rt;
+        if (OPRT_OK == rt) {
+            t->status = AI_TOY_BOOT_DONE;
+            b->done |= AI_TOY_BOOT_DEP(idx);
+        } else {
+            t->status = AI_TOY_BOOT_FAILED;
+            b->failed |= AI_TOY_BOOT_DEP(idx);
+            if (s->required && OPRT_OK == b->rt) {
+                b->rt = rt;
+            }
+            TAL_PR_ERR("boot stage %s failed %d", s->name, rt);
+        }
+        // wake every blocked runner, each re-checks the table
+        while (b->waiting) {
+            b->waiting--;
+            tal_semaphore_post(b->wake);
+        }
+    }
+    // the last runner out releases the ones still waiting
+    while (b->waiting) {
+        b->waiting--;
+        tal_semaphore_post(b->wake);
+    }
+    tal_mutex_unlock(b->mutex);
+}
+
+STATIC VOID __boot_helper_task(VOID *arg)
+{
+    ai_toy_boot_runner_t *r = (ai_toy_boot_runner_t *)arg;
+
+    __boot_runner(r);
+    tal_semaphore_post(r->boot->exit);
+}
+
+OPERATE_RET ai_toy_boot_run(CONST AI_TOY_BOOT_STAGE_T *stages, UINT8_T cnt, VOID *arg)
+{
+    OPERATE_RET rt = OPRT_OK;
+    ai_toy_boot_t *b = &s_boot;
+    UINT8_T helpers = 0;
+
+    if (NULL == stages || 0 == cnt || cnt > AI_TOY_BOOT_STAGE_MAX) {
+        return OPRT_INVALID_PARM;
+    }
+    for (UINT8_T i = 0; i < cnt; i++) {
+        // dependencies must point backwards, which also rules out cycles
+        if (stages[i].deps >> i) {
+            TAL_PR_ERR("boot stage %s depends on a later stage", stages[i].name);
+            return OPRT_INVALID_PARM;
+        }
+    }
+
+    memset(b, 0, sizeof(ai_toy_boot_t));
+    b->stages = stages;
+    b->cnt = cnt;
+    b->arg = arg;
+    b->t0 = tal_system_get_millisecond();
+    TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&b->mutex));
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&b->wake, 0, AI_TOY_BOOT_WORKERS + 1), __exit);
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&b->exit, 0, AI_TOY_BOOT_WORKERS), __exit);
+
+    for (UINT8_T i = 0; i <= AI_TOY_BOOT_WORKERS; i++) {
+        s_runner[i].boot = b;
+        s_runner[i].id = i;
+    }
+    for (UINT8_T i = 0; i < AI_TOY_BOOT_WORKERS; i++) {
+        THREAD_CFG_T thrd_param = {
+            .stackDepth = 4096,
+            .priority   = THREAD_PRIO_2,
+            .thrdname   = "ai_toy_boot",
+        };
+        if (OPRT_OK != tal_thread_create_and_start(&b->helper[i], NULL, NULL, __boot_helper_task, &s_runner[i + 1], &thrd_param)) {
+            // fewer helpers only means less parallelism
+            TAL_PR_ERR("boot helper %d not started", i);
+            break;
+        }
+        helpers++;
+    }
+
+    __boot_runner(&s_runner[0]);
+    while (helpers--) {
+        tal_semaphore_wait(b->exit, SEM_WAIT_FOREVER);
+    }
+    rt = b->rt;
+
+__exit:
+    if (b->exit) {
+        tal_semaphore_release(b->exit);
+        b->exit = NULL;
+    }
+    if (b->wake) {
+        tal_semaphore_release(b->wake);
+        b->wake = NULL;
+    }
+    tal_mutex_release(b->mutex);
+    b->mutex = NULL;
+    return rt;
+}
+
+CONST AI_TOY_BOOT_TIMING_T *ai_toy_boot_timing_get(UINT8_T *cnt)
+{
+    if (cnt) {
+        *cnt = s_boot.cnt;
+    }
+    return s_boot.cnt ? s_boot.timing : NULL;
+}
+
+VOID ai_toy_boot_dump(VOID)
+{
+    STATIC CONST CHAR_T *status_str[] = {"pending", "running", "done", "failed", "skipped"};
+    UINT32_T serial = 0, total = 0;
+
+    for (UINT8_T i = 0; i < s_boot.cnt; i++) {
+        CONST AI_TOY_BOOT_TIMING_T *t = &s_boot.timing[i];
+        UINT32_T cost = t->end_ms - t->start_ms;
+        TAL_PR_NOTICE("boot %-12s %-7s runner %d start %4dms cost %4dms",
+                      s_boot.stages[i].name, status_str[t->status], t->runner, t->start_ms, cost);
+        serial += cost;
+        if (t->end_ms > total) {
+            total = t->end_ms;
+        }
+    }
+    TAL_PR_NOTICE("boot total %dms, %dms if run serially", total, serial);
+}
@@ -0,0 +1,218 @@
+#include "ai_toy_evq.h"
+#include "tal_log.h"
+#include "tal_semaphore.h"
+#include "tal_thread.h"
+#include <string.h>
+
+/**
+ * Bounded multi-producer single-consumer queue (Vyukov style). Each cell
+ * carries a sequence number: producers claim a position with one CAS and
+ * publish the record by releasing the cell sequence, the worker is the only
+ * consumer. The semaphore only wakes the worker, it never blocks a producer.
+ */
+typedef struct {
+    volatile UINT32_T            seq;
+    AI_TOY_EVT_T                 evt;
+} evq_cell_t;
+
+typedef struct {
+    evq_cell_t                   cell[AI_TOY_EVQ_DEPTH];
+    volatile UINT32_T            enq_pos;
+    UINT32_T                     deq_pos;
+    SEM_HANDLE                   sem;
+    SEM_HANDLE                   done;          // posted by the worker on its way out
+    THREAD_HANDLE                thread;
+    volatile BOOL_T              stopping;
+    AI_TOY_EVT_HANDLER           handler;
+    VOID                        *arg;
+    AI_TOY_EVT_TAP               tap;
+    volatile BOOL_T              dropping;      // a drop was logged, cleared by the next post
+    AI_TOY_EVQ_STAT_T            stat;
+} ai_toy_evq_t;
+
+#define EVQ_MASK                        (AI_TOY_EVQ_DEPTH - 1)
+
+_Static_assert((AI_TOY_EVQ_DEPTH & EVQ_MASK) == 0, "AI_TOY_EVQ_DEPTH must be a power of two");
+_Static_assert(AI_TOY_EVQ_RESERVED < AI_TOY_EVQ_DEPTH, "AI_TOY_EVQ_RESERVED must leave room for normal records");
+
+STATIC ai_toy_evq_t s_evq;
+
+STATIC BOOL_T __evq_pop(ai_toy_evq_t *q, AI_TOY_EVT_T *evt)
+{
+    UINT32_T pos = q->deq_pos;
+    evq_cell_t *c = &q->cell[pos & EVQ_MASK];
+    UINT32_T seq = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+
+    if ((INT32_T)(seq - (pos + 1)) < 0) {
+        return FALSE;
+    }
+    *evt = c->evt;
+    __atomic_store_n(&c->seq, pos + AI_TOY_EVQ_DEPTH, __ATOMIC_RELEASE);
+    __atomic_store_n(&q->deq_pos, pos + 1, __ATOMIC_RELAXED);
+    return TRUE;
+}
+
+STATIC VOID __evq_task(VOID_T *arg)
+{
+    ai_toy_evq_t *q = (ai_toy_evq_t *)arg;
+    AI_TOY_EVT_T evt;
+
+    do {
+        tal_semaphore_wait(q->sem, SEM_WAIT_FOREVER);
+        while (__evq_pop(q, &evt)) {
+            q->handler(&evt, q->arg);
+            q->stat.handled++;
+        }
+    } while (!__atomic_load_n(&q->stopping, __ATOMIC_ACQUIRE));
+
+    tal_semaphore_post(q->done);
+}
+
+OPERATE_RET ai_toy_evq_init(AI_TOY_EVT_HANDLER handler, VOID *arg)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == handler) {
+        return OPRT_INVALID_PARM;
+    }
+    if (s_evq.thread) {
+        return OPRT_OK;
+    }
+
+    memset(&s_evq, 0, sizeof(s_evq));
+    for (UINT32_T i = 0; i < AI_TOY_EVQ_DEPTH; i++) {
+        s_evq.cell[i].seq = i;
+    }
+    s_evq.handler = handler;
+    s_evq.arg     = arg;
+
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&s_evq.done, 0, 1), __error);
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&s_evq.sem, 0, AI_TOY_EVQ_DEPTH), __error);
+
+    THREAD_CFG_T thrd_param = {
+        .stackDepth = 4096,
+        .priority   = THREAD_PRIO_1,
+        .thrdname   = "ai_toy_evt",
+    };
+    TUYA_CALL_ERR_GOTO(tal_thread_create_and_start(&s_evq.thread, NULL, NULL, __evq_task, &s_evq, &thrd_param), __error);
+
+    return OPRT_OK;
+
+__error:
+    if (s_evq.sem) {
+        tal_semaphore_release(s_evq.sem);
+        s_evq.sem = NULL;
+    }
+    if (s_evq.done) {
+        tal_semaphore_release(s_evq.done);
+        s_evq.done = NULL;
+    }
+    s_evq.thread = NULL;
+    return rt;
+}
+
+VOID ai_toy_evq_deinit(VOID)
+{
+    ai_toy_evq_t *q = &s_evq;
+
+    if (NULL == q->thread) {
+        return;
+    }
+    // refuse new posts, the caller has already stopped the callbacks that feed us
+    __atomic_store_n(&q->stopping, TRUE, __ATOMIC_RELEASE);
+    tal_semaphore_post(q->sem);
+    tal_semaphore_wait(q->done, SEM_WAIT_FOREVER);
+
+    TAL_PR_NOTICE("evq stopped, posted %d, handled %d, dropped %d", q->stat.posted, q->stat.handled, q->stat.full);
+    tal_semaphore_release(q->sem);
+    tal_semaphore_release(q->done);
+    q->sem    = NULL;
+    q->done   = NULL;
+    q->thread = NULL;
+}
+
+STATIC VOID __evq_drop(ai_toy_evq_t *q, CONST AI_TOY_EVT_T *evt, BOOL_T critical)
+{
+    UINT32_T full = __atomic_add_fetch(&q->stat.full, 1, __ATOMIC_RELAXED);
+
+    if (critical) {
+        __atomic_fetch_add(&q->stat.full_critical, 1, __ATOMIC_RELAXED);
+    }
+    if (critical || !__atomic_exchange_n(&q->dropping, TRUE, __ATOMIC_RELAXED)) {
+        TAL_PR_ERR("evq full, drop src %d code %d%s, %d dropped", evt->src, evt->code, critical ? " (critical)" : "", full);
+    }
+}
+
+STATIC OPERATE_RET __evq_post(CONST AI_TOY_EVT_T *evt, BOOL_T critical)
+{
+    ai_toy_evq_t *q = &s_evq;
+    UINT32_T limit = critical ? AI_TOY_EVQ_DEPTH : AI_TOY_EVQ_DEPTH - AI_TOY_EVQ_RESERVED;
+    UINT32_T pos = __atomic_load_n(&q->enq_pos, __ATOMIC_RELAXED);
+    evq_cell_t *c;
+
+    if (NULL == q->sem || __atomic_load_n(&q->stopping, __ATOMIC_ACQUIRE)) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    for (;;) {
+        c = &q->cell[pos & EVQ_MASK];
+        UINT32_T seq = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+        INT32_T diff = (INT32_T)(seq - pos);
+        if (0 == diff && pos - __atomic_load_n(&q->deq_pos, __ATOMIC_RELAXED) >= limit) {
+            diff = -1;
+        }
+        if (0 == diff) {
+            if (__atomic_compare_exchange_n(&q->enq_pos, &pos, pos + 1, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __evq_drop(q, evt, critical);
+            return OPRT_EXCEED_UPPER_LIMIT;
+        } else {
+            pos = __atomic_load_n(&q->enq_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    c->evt = *evt;
+    AI_TOY_EVT_TAP tap = __atomic_load_n(&q->tap, __ATOMIC_ACQUIRE);
+    if (tap) {
+        tap(evt);
+    }
+    __atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+    tal_semaphore_post(q->sem);
+
+    UINT32_T depth = pos + 1 - __atomic_load_n(&q->deq_pos, __ATOMIC_RELAXED);
+    if (depth > q->stat.max_depth) {
+        q->stat.max_depth = depth;
+    }
+    if (depth > AI_TOY_EVQ_DEPTH - AI_TOY_EVQ_RESERVED) {
+        __atomic_fetch_add(&q->stat.reserved, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&q->stat.posted, 1, __ATOMIC_RELAXED);
+    if (q->dropping) {
+        q->dropping = FALSE;
+    }
+    return OPRT_OK;
+}
+
+OPERATE_RET ai_toy_evq_post(CONST AI_TOY_EVT_T *evt)
+{
+    return __evq_post(evt, FALSE);
+}
+
+OPERATE_RET ai_toy_evq_post_critical(CONST AI_TOY_EVT_T *evt)
+{
+    return __evq_post(evt, TRUE);
+}
+
+VOID ai_toy_evq_stat_get(AI_TOY_EVQ_STAT_T *stat)
+{
+    if (stat) {
+        memcpy(stat, &s_evq.stat, sizeof(AI_TOY_EVQ_STAT_T));
+    }
+}
+
+VOID ai_toy_evq_tap_set(AI_TOY_EVT_TAP tap)
+{
+    __atomic_store_n(&s_evq.tap, tap, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,297 @@
+#include "ai_toy_evtrace.h"
+#include "ai_toy_trace.h"
+#include "tal_log.h"
+#include "tal_system.h"
+#include "tal_thread.h"
+#include "tal_memory.h"
+#include <string.h>
+
+#if AI_TOY_EVTRACE_ENABLE
+
+/**
+ * Records live in a PSRAM ring that is allocated on the first start and kept
+ * afterwards. Producers are the recorder, proc, player, key and Wi-Fi
+ * callbacks: each claims a slot with one fetch-add on the write position and
+ * fills it in place, the oldest records are overwritten once the ring is
+ * full. Readers (export, dump, replay) only run on a stopped trace, a record
+ * claimed right before the stop may still be landing, which is fine for a
+ * debug trace.
+ */
+typedef struct {
+    AI_TOY_EVTRACE_REC_T        *ring;
+    volatile BOOL_T              on;
+    volatile BOOL_T              replaying;
+    UINT32_T                     wr;             ///< records claimed, only grows
+    UINT64_T                     t0_us;
+    THREAD_HANDLE                thread;
+    AI_TOY_EVTRACE_REPLAY_CFG_T  replay;
+    AI_TOY_EVTRACE_STAT_T        stat;
+} ai_toy_evtrace_t;
+
+#define EVTRACE_MASK                    (AI_TOY_EVTRACE_RECORDS - 1)
+#define EVTRACE_LATE_US                 (10 * 1000)
+
+_Static_assert((AI_TOY_EVTRACE_RECORDS & EVTRACE_MASK) == 0, "AI_TOY_EVTRACE_RECORDS must be a power of two");
+_Static_assert(sizeof(AI_TOY_EVTRACE_REC_T) == 20, "trace record layout changed, bump AI_TOY_EVTRACE_MAGIC");
+
+STATIC ai_toy_evtrace_t s_evtrace;
+
+STATIC UINT32_T __evtrace_count(VOID)
+{
+    return (s_evtrace.wr > AI_TOY_EVTRACE_RECORDS) ? AI_TOY_EVTRACE_RECORDS : s_evtrace.wr;
+}
+
+STATIC UINT32_T __evtrace_first(VOID)
+{
+    return s_evtrace.wr - __evtrace_count();
+}
+
+STATIC VOID __evtrace_hdr(AI_TOY_EVTRACE_HDR_T *hdr)
+{
+    hdr->magic    = AI_TOY_EVTRACE_MAGIC;
+    hdr->rec_size = sizeof(AI_TOY_EVTRACE_REC_T);
+    hdr->reserved = 0;
+    hdr->count    = __evtrace_count();
+    hdr->lost     = s_evtrace.stat.lost;
+}
+
+STATIC OPERATE_RET __evtrace_alloc(VOID)
+{
+    if (NULL == s_evtrace.ring) {
+        s_evtrace.ring = tkl_system_psram_malloc(AI_TOY_EVTRACE_RECORDS * sizeof(AI_TOY_EVTRACE_REC_T));
+        if (NULL == s_evtrace.ring) {
+            TAL_PR_ERR("evtrace malloc failed");
+            return OPRT_MALLOC_FAILED;
+        }
+    }
+    return OPRT_OK;
+}
+
+OPERATE_RET ai_toy_evtrace_start(VOID)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (s_evtrace.replaying) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    TUYA_CALL_ERR_RETURN(__evtrace_alloc());
+    s_evtrace.on = FALSE;
+    s_evtrace.wr = 0;
+    s_evtrace.stat.recorded = 0;
+    s_evtrace.stat.lost = 0;
+    s_evtrace.t0_us = AI_TOY_TRACE_NOW_US();
+    __atomic_store_n(&s_evtrace.on, TRUE, __ATOMIC_RELEASE);
+    TAL_PR_NOTICE("evtrace recording, %d records", AI_TOY_EVTRACE_RECORDS);
+    return OPRT_OK;
+}
+
+VOID ai_toy_evtrace_stop(VOID)
+{
+    if (!s_evtrace.on) {
+        return;
+    }
+    __atomic_store_n(&s_evtrace.on, FALSE, __ATOMIC_RELEASE);
+    s_evtrace.stat.recorded = s_evtrace.wr;
+    s_evtrace.stat.lost = s_evtrace.wr - __evtrace_count();
+    TAL_PR_NOTICE("evtrace stopped, %d recorded, %d lost", s_evtrace.stat.recorded, s_evtrace.stat.lost);
+}
+
+VOID ai_toy_evtrace_record(CONST AI_TOY_EVT_T *evt)
+{
+    if (!__atomic_load_n(&s_evtrace.on, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    UINT32_T pos = __atomic_fetch_add(&s_evtrace.wr, 1, __ATOMIC_RELAXED);
+    AI_TOY_EVTRACE_REC_T *rec = &s_evtrace.ring[pos & EVTRACE_MASK];
+
+    rec->ts_us = (UINT32_T)(AI_TOY_TRACE_NOW_US() - s_evtrace.t0_us);
+    rec->evt = *evt;
+}
+
+INT_T ai_toy_evtrace_export(UINT8_T *buf, UINT_T size)
+{
+    AI_TOY_EVTRACE_HDR_T hdr;
+    UINT32_T first;
+    UINT_T need;
+
+    if (s_evtrace.on || NULL == s_evtrace.ring) {
+        return 0;
+    }
+    __evtrace_hdr(&hdr);
+    first = __evtrace_first();
+    need = sizeof(hdr) + hdr.count * sizeof(AI_TOY_EVTRACE_REC_T);
+    if (NULL == buf) {
+        return (INT_T)need;
+    }
+    if (size < need) {
+        return 0;
+    }
+
+    memcpy(buf, &hdr, sizeof(hdr));
+    buf += sizeof(hdr);
+    for (UINT32_T i = 0; i < hdr.count; i++) {
+        memcpy(buf, &s_evtrace.ring[(first + i) & EVTRACE_MASK], sizeof(AI_TOY_EVTRACE_REC_T));
+        buf += sizeof(AI_TOY_EVTRACE_REC_T);
+    }
+    return (INT_T)need;
+}
+
+OPERATE_RET ai_toy_evtrace_load(CONST UINT8_T *buf, UINT_T len)
+{
+    OPERATE_RET rt = OPRT_OK;
+    AI_TOY_EVTRACE_HDR_T hdr;
+
+    if (NULL == buf || len < sizeof(hdr)) {
+        return OPRT_INVALID_PARM;
+    }
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (AI_TOY_EVTRACE_MAGIC != hdr.magic || sizeof(AI_TOY_EVTRACE_REC_T) != hdr.rec_size ||
+        hdr.count > AI_TOY_EVTRACE_RECORDS || len < sizeof(hdr) + hdr.count * sizeof(AI_TOY_EVTRACE_REC_T)) {
+        TAL_PR_ERR("evtrace load: bad trace");
+        return OPRT_INVALID_PARM;
+    }
+    if (s_evtrace.on || s_evtrace.replaying) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    TUYA_CALL_ERR_RETURN(__evtrace_alloc());
+    memcpy(s_evtrace.ring, buf + sizeof(hdr), hdr.count * sizeof(AI_TOY_EVTRACE_REC_T));
+    s_evtrace.wr = hdr.count;
+    s_evtrace.stat.recorded = hdr.count;
+    s_evtrace.stat.lost = hdr.lost;
+    TAL_PR_NOTICE("evtrace loaded, %d records", hdr.count);
+    return OPRT_OK;
+}
+
+STATIC VOID __evtrace_dump_line(CONST UINT8_T *data, UINT_T len)
+{
+    STATIC CONST CHAR_T hex[] = "0123456789abcdef";
+    CHAR_T line[AI_TOY_EVTRACE_DUMP_BYTES * 2 + 1];
+
+    for (UINT_T i = 0; i < len; i++) {
+        line[i * 2]     = hex[data[i] >> 4];
+        line[i * 2 + 1] = hex[data[i] & 0x0f];
+    }
+    line[len * 2] = '\0';
+    TAL_PR_NOTICE("EVTRACE %s", line);
+}
+
+VOID ai_toy_evtrace_dump(VOID)
+{
+    AI_TOY_EVTRACE_HDR_T hdr;
+    UINT8_T chunk[AI_TOY_EVTRACE_DUMP_BYTES];
+    UINT32_T first;
+
+    if (s_evtrace.on || NULL == s_evtrace.ring) {
+        TAL_PR_NOTICE("evtrace: nothing to dump");
+        return;
+    }
+    __evtrace_hdr(&hdr);
+    first = __evtrace_first();
+
+    __evtrace_dump_line((CONST UINT8_T *)&hdr, sizeof(hdr));
+    // two records per line; the hex of all lines, in order, is the export layout
+    for (UINT32_T i = 0; i < hdr.count; i += 2) {
+        UINT_T len = 0;
+        for (UINT32_T j = i; j < hdr.count && j < i + 2; j++) {
+            memcpy(chunk + len, &s_evtrace.ring[(first + j) & EVTRACE_MASK], sizeof(AI_TOY_EVTRACE_REC_T));
+            len += sizeof(AI_TOY_EVTRACE_REC_T);
+        }
+        __evtrace_dump_line(chunk, len);
+    }
+}
+
+STATIC VOID __evtrace_replay_task(VOID *arg)
+{
+    ai_toy_evtrace_t *t = (ai_toy_evtrace_t *)arg;
+    UINT32_T count = __evtrace_count();
+    UINT32_T first = __evtrace_first();
+    UINT32_T speed = t->replay.speed_pct;
+    UINT32_T ts0 = count ? t->ring[first & EVTRACE_MASK].ts_us : 0;
+    UINT64_T start = AI_TOY_TRACE_NOW_US();
+
+    for (UINT32_T i = 0; i < count; i++) {
+        AI_TOY_EVTRACE_REC_T rec = t->ring[(first + i) & EVTRACE_MASK];
+
+        if (speed) {
+            UINT64_T due = (UINT64_T)(rec.ts_us - ts0) * 100 / speed;
+            UINT64_T elapsed = AI_TOY_TRACE_NOW_US() - start;
+            if (due > elapsed) {
+                tal_system_sleep((UINT32_T)((due - elapsed + 999) / 1000));
+                elapsed = AI_TOY_TRACE_NOW_US() - start;
+            }
+            if (elapsed > due) {
+                UINT32_T lag = (UINT32_T)(elapsed - due);
+                if (lag > EVTRACE_LATE_US) {
+                    t->stat.replay_late++;
+                }
+                if (lag > t->stat.replay_max_lag_us) {
+                    t->stat.replay_max_lag_us = lag;
+                }
+            }
+        }
+        t->replay.feed(&rec.evt, t->replay.arg);
+        t->stat.replayed++;
+    }
+
+    t->stat.replay_ms = (UINT32_T)((AI_TOY_TRACE_NOW_US() - start) / 1000);
+    TAL_PR_NOTICE("evtrace replay done: %d records in %d ms, %d late, max lag %d us", t->stat.replayed,
+                  t->stat.replay_ms, t->stat.replay_late, t->stat.replay_max_lag_us);
+    if (t->replay.done) {
+        t->replay.done(t->replay.arg);
+    }
+    t->thread = NULL;
+    __atomic_store_n(&t->replaying, FALSE, __ATOMIC_RELEASE);
+}
+
+OPERATE_RET ai_toy_evtrace_replay(CONST AI_TOY_EVTRACE_REPLAY_CFG_T *cfg)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == cfg || NULL == cfg->feed) {
+        return OPRT_INVALID_PARM;
+    }
+    if (s_evtrace.replaying) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    // replayed events go through the same posts, they must not land in the trace being replayed
+    ai_toy_evtrace_stop();
+    if (NULL == s_evtrace.ring || 0 == s_evtrace.wr) {
+        TAL_PR_NOTICE("evtrace: nothing to replay");
+        return OPRT_NOT_FOUND;
+    }
+
+    s_evtrace.replay = *cfg;
+    s_evtrace.stat.replayed = 0;
+    s_evtrace.stat.replay_ms = 0;
+    s_evtrace.stat.replay_late = 0;
+    s_evtrace.stat.replay_max_lag_us = 0;
+    s_evtrace.replaying = TRUE;
+
+    THREAD_CFG_T thrd_param = {
+        .stackDepth = 4096,
+        .priority   = THREAD_PRIO_2,
+        .thrdname   = "ai_toy_replay",
+    };
+    rt = tal_thread_create_and_start(&s_evtrace.thread, NULL, NULL, __evtrace_replay_task, &s_evtrace, &thrd_param);
+    if (OPRT_OK != rt) {
+        s_evtrace.replaying = FALSE;
+        return rt;
+    }
+    TAL_PR_NOTICE("evtrace replay of %d records at %d%%", __evtrace_count(), cfg->speed_pct);
+    return OPRT_OK;
+}
+
+BOOL_T ai_toy_evtrace_replaying(VOID)
+{
+    return __atomic_load_n(&s_evtrace.replaying, __ATOMIC_ACQUIRE);
+}
+
+VOID ai_toy_evtrace_stat_get(AI_TOY_EVTRACE_STAT_T *stat)
+{
+    if (stat) {
+        memcpy(stat, &s_evtrace.stat, sizeof(AI_TOY_EVTRACE_STAT_T));
+    }
+}
+
+#endif
@@ -0,0 +1,81 @@
+#include "ai_toy_fsm.h"
+#include "tuya_ai_toy.h"
+#include "tal_log.h"
+
+typedef struct {
+    UINT8_T                      next[TOY_MODE_MAX];
+    UINT32_T                     actions;
+} ai_toy_trans_t;
+
+#define NX_ALL(s)                       { s, s, s, s }
+#define NX_FREE_ONLY(s)                 { TOY_ST_NONE, TOY_ST_NONE, s, TOY_ST_NONE }
+#define NX_TALK_AGAIN                   { AI_TOY_IDLE, AI_TOY_LISTEN, AI_TOY_LISTEN, AI_TOY_LISTEN }
+#define NX_SPEAK_END                    { AI_TOY_IDLE, AI_TOY_IDLE, AI_TOY_LISTEN, AI_TOY_LISTEN }
+
+#define TR(nx, act)                     { nx, act }
+#define TR_REJECT                       TR(NX_ALL(TOY_ST_NONE), 0)
+#define TR_ROW(t)                       { t, t, t, t, t }
+
+#define TOY_ACTS_MODE_UPDATE            (TOY_ACT_LED_OFF | TOY_ACT_PLAYER_STOP | TOY_ACT_DISPLAY_MODE | TOY_ACT_INTERRUPT | TOY_ACT_ALERT_MODE)
+#define TOY_ACTS_WAKEUP                 (TOY_ACT_TRACE | TOY_ACT_LED_ON | TOY_ACT_STRIP_BREATH | TOY_ACT_PLAYER_STOP | TOY_ACT_INTERRUPT | TOY_ACT_ALERT_WAKEUP)
+#define TOY_ACTS_VAD_START              (TOY_ACT_TRACE | TOY_ACT_VAD_ACTIVE | TOY_ACT_STOP_FIRST | TOY_ACT_PLAYER_STOP | TOY_ACT_INTERRUPT | \
+                                         TOY_ACT_LED_FLASH | TOY_ACT_STRIP_DIALOG | TOY_ACT_UPLOAD)
+
+//                                    AI_TOY_IDLE, AI_TOY_LISTEN, AI_TOY_UPLOAD, AI_TOY_THINK, AI_TOY_SPEAK
+STATIC CONST ai_toy_trans_t s_ai_toy_fsm[TOY_EV_MAX][AI_TOY_STATE_MAX] = {
+    [TOY_EV_MODE_UPDATE]  = TR_ROW(TR(NX_ALL(AI_TOY_IDLE), TOY_ACTS_MODE_UPDATE)),
+    [TOY_EV_WAKEUP]       = TR_ROW(TR(NX_TALK_AGAIN, TOY_ACTS_WAKEUP)),
+    [TOY_EV_REC_STOP]     = TR_ROW(TR(NX_ALL(AI_TOY_IDLE), TOY_ACT_LED_OFF | TOY_ACT_PLAYER_STOP)),
+    // 支持自由说模式, 说话打断，本地VAD不自打断
+    [TOY_EV_VAD_START]    = { TR_REJECT, TR(NX_ALL(TOY_ST_KEEP), TOY_ACTS_VAD_START), TR_REJECT, TR_REJECT,
+                              TR(NX_FREE_ONLY(TOY_ST_KEEP), TOY_ACTS_VAD_START) },
+    [TOY_EV_VAD_SPEAK]    = { TR_REJECT, TR(NX_ALL(TOY_ST_KEEP), TOY_ACT_UPLOAD), TR_REJECT, TR_REJECT,
+                              TR(NX_FREE_ONLY(TOY_ST_KEEP), TOY_ACT_UPLOAD) },
+    [TOY_EV_VAD_END]      = { TR_REJECT, TR(NX_ALL(AI_TOY_UPLOAD), TOY_ACT_LED_OFF | TOY_ACT_UPLOAD_FINISH), TR_REJECT, TR_REJECT,
+                              TR(NX_FREE_ONLY(AI_TOY_UPLOAD), TOY_ACT_LED_OFF | TOY_ACT_UPLOAD_FINISH) },
+    [TOY_EV_UPLOAD_DONE]  = { TR_REJECT, TR_REJECT, TR(NX_ALL(AI_TOY_THINK), 0), TR_REJECT, TR_REJECT },
+    [TOY_EV_ASR_OK]       = TR_ROW(TR(NX_ALL(TOY_ST_KEEP), TOY_ACT_LED_ON)),
+    [TOY_EV_ASR_FAIL]     = TR_ROW(TR(NX_TALK_AGAIN, 0)),
+    [TOY_EV_TTS_START]    = TR_ROW(TR(NX_ALL(TOY_ST_KEEP), TOY_ACT_PLAYER_READY | TOY_ACT_STRIP_IDLE)),
+    [TOY_EV_PLAYER_START] = { TR_REJECT, TR_REJECT, TR(NX_ALL(AI_TOY_SPEAK), TOY_ACT_PLAYER_STARTED),
+                              TR(NX_ALL(AI_TOY_SPEAK), TOY_ACT_PLAYER_STARTED), TR_REJECT },
+    [TOY_EV_PLAYER_END]   = { TR_REJECT, TR_REJECT, TR_REJECT, TR_REJECT, TR(NX_SPEAK_END, TOY_ACT_PLAYER_STOPPED) },
+};
+
+_Static_assert(AI_TOY_STATE_MAX == 5, "TR_ROW and s_ai_toy_fsm columns assume 5 toy states");
+_Static_assert(AI_TOY_STATE_MAX < TOY_ST_KEEP, "toy states collide with TOY_ST_KEEP/TOY_ST_NONE");
+
+// accepted / rejected dispatch counters per (event, state), toy worker only
+STATIC UINT32_T s_ai_toy_fsm_cnt[TOY_EV_MAX][AI_TOY_STATE_MAX];
+STATIC UINT32_T s_ai_toy_fsm_reject[TOY_EV_MAX][AI_TOY_STATE_MAX];
+
+UINT8_T ai_toy_fsm_step(AI_TOY_FSM_EV_E ev, UINT8_T state, AI_TOY_FSM_MODE_E mode, UINT32_T *actions)
+{
+    *actions = 0;
+    if ((UINT_T)ev >= TOY_EV_MAX || state >= AI_TOY_STATE_MAX || (UINT_T)mode >= TOY_MODE_MAX) {
+        return TOY_ST_NONE;
+    }
+
+    CONST ai_toy_trans_t *tr = &s_ai_toy_fsm[ev][state];
+    UINT8_T next = tr->next[mode];
+
+    if (TOY_ST_NONE == next) {
+        s_ai_toy_fsm_reject[ev][state]++;
+        return TOY_ST_NONE;
+    }
+    s_ai_toy_fsm_cnt[ev][state]++;
+    *actions = tr->actions;
+    return next;
+}
+
+VOID ai_toy_fsm_dump(VOID)
+{
+    TAL_PR_NOTICE("toy fsm (event, state): accepted/rejected");
+    for (INT_T ev = 0; ev < TOY_EV_MAX; ev++) {
+        for (INT_T st = 0; st < AI_TOY_STATE_MAX; st++) {
+            if (s_ai_toy_fsm_cnt[ev][st] || s_ai_toy_fsm_reject[ev][st]) {
+                TAL_PR_NOTICE("  (%d, %d): %d/%d", ev, st, s_ai_toy_fsm_cnt[ev][st], s_ai_toy_fsm_reject[ev][st]);
+            }
+        }
+    }
+}
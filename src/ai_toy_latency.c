@@ -0,0 +1,171 @@
+#include "ai_toy_latency.h"
+#include "tal_log.h"
+#include "tal_system.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    UINT32_T    ms[AI_TOY_LAT_MAX];
+} ai_toy_lat_turn_t;
+
+typedef struct {
+    SYS_TIME_T          stamp[AI_TOY_LAT_MARK_MAX];
+    BOOL_T              open;
+    ai_toy_lat_turn_t   ring[AI_TOY_LATENCY_TURNS];
+    UINT8_T             head;
+    UINT8_T             depth;
+    UINT32_T            turns;
+    UINT32_T            aborted;
+} ai_toy_lat_t;
+
+STATIC ai_toy_lat_t s_lat;
+
+STATIC CONST CHAR_T *s_lat_name[AI_TOY_LAT_MAX] = {
+    "upload", "asr", "llm", "play", "e2e",
+};
+
+STATIC UINT32_T __lat_span(AI_TOY_LAT_MARK_E from, AI_TOY_LAT_MARK_E to)
+{
+    if (0 == s_lat.stamp[from] || 0 == s_lat.stamp[to] || s_lat.stamp[to] < s_lat.stamp[from]) {
+        return AI_TOY_LAT_INVALID;
+    }
+    return (UINT32_T)(s_lat.stamp[to] - s_lat.stamp[from]);
+}
+
+STATIC VOID __lat_close_turn(VOID)
+{
+    ai_toy_lat_turn_t *t = &s_lat.ring[s_lat.head];
+
+    t->ms[AI_TOY_LAT_UPLOAD] = __lat_span(AI_TOY_LAT_MARK_VAD_END,     AI_TOY_LAT_MARK_UPLOAD_DONE);
+    t->ms[AI_TOY_LAT_ASR]    = __lat_span(AI_TOY_LAT_MARK_UPLOAD_DONE, AI_TOY_LAT_MARK_ASR_OK);
+    t->ms[AI_TOY_LAT_LLM]    = __lat_span(AI_TOY_LAT_MARK_ASR_OK,      AI_TOY_LAT_MARK_TTS_START);
+    t->ms[AI_TOY_LAT_PLAY]   = __lat_span(AI_TOY_LAT_MARK_TTS_START,   AI_TOY_LAT_MARK_PLAYER_START);
+    t->ms[AI_TOY_LAT_E2E]    = __lat_span(AI_TOY_LAT_MARK_VAD_END,     AI_TOY_LAT_MARK_PLAYER_START);
+
+    s_lat.head = (s_lat.head + 1) % AI_TOY_LATENCY_TURNS;
+    if (s_lat.depth < AI_TOY_LATENCY_TURNS) {
+        s_lat.depth++;
+    }
+    s_lat.turns++;
+    s_lat.open = FALSE;
+
+    TAL_PR_DEBUG("turn latency ms: upload %d, asr %d, llm %d, play %d, e2e %d",
+                 t->ms[AI_TOY_LAT_UPLOAD], t->ms[AI_TOY_LAT_ASR], t->ms[AI_TOY_LAT_LLM],
+                 t->ms[AI_TOY_LAT_PLAY], t->ms[AI_TOY_LAT_E2E]);
+}
+
+VOID ai_toy_latency_mark(AI_TOY_LAT_MARK_E mark)
+{
+    if (mark >= AI_TOY_LAT_MARK_MAX) {
+        return;
+    }
+
+    if (AI_TOY_LAT_MARK_VAD_END == mark) {
+        if (s_lat.open) {
+            s_lat.aborted++;
+        }
+        memset(s_lat.stamp, 0, sizeof(s_lat.stamp));
+        s_lat.open = TRUE;
+    } else if (!s_lat.open || s_lat.stamp[mark]) {
+        // outside a turn, or not the first occurrence within it
+        return;
+    }
+
+    s_lat.stamp[mark] = tal_system_get_millisecond();
+
+    if (AI_TOY_LAT_MARK_PLAYER_START == mark) {
+        __lat_close_turn();
+    }
+}
+
+VOID ai_toy_latency_abort(VOID)
+{
+    if (s_lat.open) {
+        s_lat.open = FALSE;
+        s_lat.aborted++;
+    }
+}
+
+STATIC VOID __lat_stat(AI_TOY_LAT_METRIC_E m, AI_TOY_LAT_STAT_T *st)
+{
+    UINT32_T v[AI_TOY_LATENCY_TURNS];
+    UINT32_T n = 0;
+
+    // insertion sort, the ring is tiny
+    for (UINT32_T i = 0; i < s_lat.depth; i++) {
+        UINT32_T x = s_lat.ring[i].ms[m];
+        if (AI_TOY_LAT_INVALID == x) {
+            continue;
+        }
+        UINT32_T j = n++;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+
+    memset(st, 0, sizeof(AI_TOY_LAT_STAT_T));
+    st->count = n;
+    if (n) {
+        st->p50_ms = v[(n - 1) * 50 / 100];
+        st->p90_ms = v[(n - 1) * 90 / 100];
+        st->p99_ms = v[(n - 1) * 99 / 100];
+        st->max_ms = v[n - 1];
+    }
+}
+
+VOID ai_toy_latency_summary_get(AI_TOY_LAT_SUMMARY_T *summary)
+{
+    if (NULL == summary) {
+        return;
+    }
+    summary->turns   = s_lat.turns;
+    summary->aborted = s_lat.aborted;
+    for (INT_T m = 0; m < AI_TOY_LAT_MAX; m++) {
+        __lat_stat(m, &summary->metric[m]);
+    }
+}
+
+UINT32_T ai_toy_latency_turns_get(VOID)
+{
+    return s_lat.turns;
+}
+
+INT_T ai_toy_latency_summary_json(CHAR_T *buf, UINT_T size)
+{
+    AI_TOY_LAT_SUMMARY_T sum;
+    INT_T off = 0;
+
+    if (NULL == buf || 0 == size) {
+        return 0;
+    }
+
+    ai_toy_latency_summary_get(&sum);
+    off += snprintf(buf + off, size - off, "{\"turns\":%u,\"aborted\":%u", sum.turns, sum.aborted);
+    for (INT_T m = 0; m < AI_TOY_LAT_MAX && off < (INT_T)size; m++) {
+        AI_TOY_LAT_STAT_T *st = &sum.metric[m];
+        off += snprintf(buf + off, size - off, ",\"%s\":[%u,%u,%u,%u]", s_lat_name[m], st->p50_ms, st->p90_ms, st->p99_ms, st->max_ms);
+    }
+    if (off < (INT_T)size) {
+        off += snprintf(buf + off, size - off, "}");
+    }
+    return MIN(off, (INT_T)size - 1);
+}
+
+VOID ai_toy_latency_dump(VOID)
+{
+    AI_TOY_LAT_SUMMARY_T sum;
+
+    ai_toy_latency_summary_get(&sum);
+#ifdef USER_SW_VER
+    TAL_PR_NOTICE("conversation latency, fw %s, turns %d, aborted %d", USER_SW_VER, sum.turns, sum.aborted);
+#else
+    TAL_PR_NOTICE("conversation latency, turns %d, aborted %d", sum.turns, sum.aborted);
+#endif
+    TAL_PR_NOTICE("  metric(ms)  count    p50    p90    p99    max");
+    for (INT_T m = 0; m < AI_TOY_LAT_MAX; m++) {
+        AI_TOY_LAT_STAT_T *st = &sum.metric[m];
+        TAL_PR_NOTICE("  %-10s %6u %6u %6u %6u %6u", s_lat_name[m], st->count, st->p50_ms, st->p90_ms, st->p99_ms, st->max_ms);
+    }
+}
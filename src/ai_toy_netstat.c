@@ -0,0 +1,265 @@
+#include "ai_toy_netstat.h"
+#include "led_controller.h"
+#include "tal_log.h"
+#include "tal_mutex.h"
+#include "tal_sw_timer.h"
+#include "tkl_wifi.h"
+
+#define RSSI_Q4(dbm)    ((INT32_T)(dbm) * 16)
+
+/**
+ * The writers are the Wi-Fi status callback and the sampler timer, readers
+ * are the audio/proc hot paths. The published values are single words, plain
+ * atomic loads and stores are enough; the filter state behind them is only
+ * touched under s_rssi_mutex.
+ */
+STATIC UINT32_T s_nw_stat = STAT_UNPROVISION_AP_STA_UNCFG;
+STATIC INT32_T  s_rssi = AI_TOY_RSSI_INVALID;
+STATIC INT32_T  s_rssi_q4 = RSSI_Q4(AI_TOY_RSSI_INVALID);  // filtered, 1/16 dBm
+STATIC UINT32_T s_level = 0;                                // 0 until the first sample
+STATIC UINT8_T  s_stable_cnt = 0;
+STATIC BOOL_T   s_lowpower = FALSE;
+STATIC BOOL_T   s_meter = FALSE;
+STATIC UINT32_T s_meter_left = 0;                           // samples until auto-off
+STATIC MUTEX_HANDLE s_rssi_mutex = NULL;
+STATIC TIMER_ID s_rssi_timer = NULL;
+
+STATIC BOOL_T __is_connected(GW_WIFI_NW_STAT_E nw_stat)
+{
+    return (nw_stat == STAT_CLOUD_CONN || nw_stat == STAT_STA_CONN) ? TRUE : FALSE;
+}
+
+/**
+ * @brief same linear mapping as before: >= -30dBm is full, <= -90dBm is one LED
+ */
+STATIC UINT8_T __rssi_to_level(INT32_T q4)
+{
+    if (q4 >= RSSI_Q4(-30)) {
+        return AI_TOY_RSSI_LEVEL_MAX;
+    }
+    if (q4 <= RSSI_Q4(-90)) {
+        return 1;
+    }
+    return (UINT8_T)((q4 - RSSI_Q4(-90)) / RSSI_Q4(5) + 1);
+}
+
+/**
+ * @brief move the level only once the filtered value is AI_TOY_RSSI_HYST_DB
+ *        past the boundary, so a signal sitting on an edge does not flicker
+ */
+STATIC UINT8_T __rssi_level_next(UINT8_T cur, INT32_T q4)
+{
+    UINT8_T up = __rssi_to_level(q4 - RSSI_Q4(AI_TOY_RSSI_HYST_DB));
+    UINT8_T down = __rssi_to_level(q4 + RSSI_Q4(AI_TOY_RSSI_HYST_DB));
+
+    if (0 == cur) {
+        return __rssi_to_level(q4);
+    }
+    if (up > cur) {
+        return up;
+    }
+    if (down < cur) {
+        return down;
+    }
+    return cur;
+}
+
+STATIC VOID __rssi_filter_reset(VOID)
+{
+    if (s_rssi_mutex) {
+        tal_mutex_lock(s_rssi_mutex);
+    }
+    s_rssi_q4 = RSSI_Q4(AI_TOY_RSSI_INVALID);
+    s_stable_cnt = 0;
+    __atomic_store_n(&s_level, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_rssi, AI_TOY_RSSI_INVALID, __ATOMIC_RELAXED);
+    if (s_rssi_mutex) {
+        tal_mutex_unlock(s_rssi_mutex);
+    }
+}
+
+/**
+ * @return BOOL_T TRUE if the level changed
+ */
+STATIC BOOL_T __rssi_filter_feed(SCHAR_T rssi)
+{
+    BOOL_T changed = FALSE;
+
+    if (s_rssi_mutex) {
+        tal_mutex_lock(s_rssi_mutex);
+    }
+    UINT8_T level = (UINT8_T)s_level;
+    if (0 == level) {
+        s_rssi_q4 = RSSI_Q4(rssi);
+    } else {
+        s_rssi_q4 += (RSSI_Q4(rssi) - s_rssi_q4) / (1 << AI_TOY_RSSI_EWMA_SHIFT);
+    }
+
+    UINT8_T next = __rssi_level_next(level, s_rssi_q4);
+    if (next != level) {
+        s_stable_cnt = 0;
+        changed = TRUE;
+        __atomic_store_n(&s_level, next, __ATOMIC_RELAXED);
+    } else if (s_stable_cnt < AI_TOY_RSSI_STABLE_SAMPLES) {
+        s_stable_cnt++;
+    }
+    if (s_rssi_mutex) {
+        tal_mutex_unlock(s_rssi_mutex);
+    }
+    return changed;
+}
+
+/**
+ * @brief sample fast for the meter, back off once the level has settled,
+ *        and not at all while disconnected or in low-power mode
+ */
+STATIC VOID __rssi_schedule(VOID)
+{
+    UINT32_T interval = AI_TOY_RSSI_SAMPLE_INTERVAL;
+
+    if (NULL == s_rssi_timer) {
+        return;
+    }
+    if (s_lowpower || !__is_connected(ai_toy_netstat_get())) {
+        tal_sw_timer_stop(s_rssi_timer);
+        return;
+    }
+    if (s_meter) {
+        interval = AI_TOY_RSSI_METER_INTERVAL;
+    } else if (s_stable_cnt >= AI_TOY_RSSI_STABLE_SAMPLES) {
+        interval = AI_TOY_RSSI_STABLE_INTERVAL;
+    }
+    tal_sw_timer_start(s_rssi_timer, interval, TAL_TIMER_ONCE);
+}
+
+SCHAR_T ai_toy_netstat_rssi_sample(VOID)
+{
+    SCHAR_T rssi = AI_TOY_RSSI_INVALID;
+
+    // the query would bring the radio out of its power-save DTIM schedule
+    if (s_lowpower) {
+        return ai_toy_netstat_rssi_get();
+    }
+    if (OPRT_OK != tkl_wifi_station_get_conn_ap_rssi(&rssi)) {
+        rssi = AI_TOY_RSSI_INVALID;
+    }
+    __atomic_store_n(&s_rssi, (INT32_T)rssi, __ATOMIC_RELAXED);
+
+    if (AI_TOY_RSSI_INVALID != rssi && __rssi_filter_feed(rssi) && s_meter) {
+        set_led_state(LED_SIGNAL_METER, ai_toy_netstat_rssi_level_get());
+    }
+    return rssi;
+}
+
+STATIC VOID __rssi_timer_cb(TIMER_ID timer_id, VOID_T *arg)
+{
+    ai_toy_netstat_rssi_sample();
+
+    if (s_meter && s_meter_left && 0 == --s_meter_left) {
+        TAL_PR_NOTICE("signal meter timeout");
+        ai_toy_netstat_meter_set(FALSE);
+        return;
+    }
+    __rssi_schedule();
+}
+
+OPERATE_RET ai_toy_netstat_init(VOID)
+{
+    OPERATE_RET rt = OPRT_OK;
+    GW_WIFI_NW_STAT_E nw_stat = STAT_UNPROVISION_AP_STA_UNCFG;
+
+    if (OPRT_OK == get_wf_gw_nw_status(&nw_stat)) {
+        __atomic_store_n(&s_nw_stat, (UINT32_T)nw_stat, __ATOMIC_RELAXED);
+    }
+    if (NULL == s_rssi_mutex) {
+        TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&s_rssi_mutex));
+    }
+    if (NULL == s_rssi_timer) {
+        TUYA_CALL_ERR_RETURN(tal_sw_timer_create(__rssi_timer_cb, NULL, &s_rssi_timer));
+    }
+    ai_toy_netstat_set(nw_stat);
+    return OPRT_OK;
+}
+
+VOID ai_toy_netstat_set(GW_WIFI_NW_STAT_E nw_stat)
+{
+    GW_WIFI_NW_STAT_E old = (GW_WIFI_NW_STAT_E)__atomic_exchange_n(&s_nw_stat, (UINT32_T)nw_stat, __ATOMIC_RELAXED);
+
+    if (NULL == s_rssi_timer) {
+        return;
+    }
+    // sample only while associated, there is nothing to measure otherwise
+    if (__is_connected(nw_stat)) {
+        if (!__is_connected(old)) {
+            // new association, possibly a different AP: start the filter over
+            __rssi_filter_reset();
+        } else if (tal_sw_timer_is_running(s_rssi_timer)) {
+            return;
+        }
+        ai_toy_netstat_rssi_sample();
+        __rssi_schedule();
+    } else {
+        tal_sw_timer_stop(s_rssi_timer);
+        __rssi_filter_reset();
+    }
+}
+
+GW_WIFI_NW_STAT_E ai_toy_netstat_get(VOID)
+{
+    return (GW_WIFI_NW_STAT_E)__atomic_load_n(&s_nw_stat, __ATOMIC_RELAXED);
+}
+
+BOOL_T ai_toy_netstat_is_provisioned(VOID)
+{
+    return (ai_toy_netstat_get() != STAT_UNPROVISION_AP_STA_UNCFG) ? TRUE : FALSE;
+}
+
+SCHAR_T ai_toy_netstat_rssi_get(VOID)
+{
+    return (SCHAR_T)__atomic_load_n(&s_rssi, __ATOMIC_RELAXED);
+}
+
+SCHAR_T ai_toy_netstat_rssi_filtered_get(VOID)
+{
+    INT32_T q4;
+
+    if (0 == ai_toy_netstat_rssi_level_get()) {
+        return AI_TOY_RSSI_INVALID;
+    }
+    q4 = __atomic_load_n(&s_rssi_q4, __ATOMIC_RELAXED);
+    return (SCHAR_T)(q4 / 16);
+}
+
+UINT8_T ai_toy_netstat_rssi_level_get(VOID)
+{
+    return (UINT8_T)__atomic_load_n(&s_level, __ATOMIC_RELAXED);
+}
+
+VOID ai_toy_netstat_lowpower_set(BOOL_T enable)
+{
+    s_lowpower = enable;
+    if (enable && s_meter) {
+        // the meter cannot update without sampling, blank it
+        ai_toy_netstat_meter_set(FALSE);
+        return;
+    }
+    __rssi_schedule();
+}
+
+VOID ai_toy_netstat_meter_set(BOOL_T enable)
+{
+    if (enable) {
+        s_meter_left = AI_TOY_SIGNAL_METER_TIMEOUT / AI_TOY_RSSI_METER_INTERVAL;
+        s_meter = TRUE;
+        TAL_PR_NOTICE("signal meter on, level %d", ai_toy_netstat_rssi_level_get());
+        set_led_state(LED_SIGNAL_METER, ai_toy_netstat_rssi_level_get());
+    } else {
+        if (!s_meter) {
+            return;
+        }
+        s_meter = FALSE;
+        TAL_PR_NOTICE("signal meter off");
+        set_led_state(LED_IDLE, 0);
+    }
+    __rssi_schedule();
+}
@@ -0,0 +1,330 @@
+#include "ai_toy_power.h"
+#include "tal_log.h"
+#include "tal_mutex.h"
+#include "tal_system.h"
+#include <string.h>
+
+/**
+ * Two small histograms drive the decisions.
+ *
+ * Idle gaps, from entering idle to the next interaction, in log2-second
+ * buckets. The gap is measured whether or not the device slept in between,
+ * so it is not cut short by the timeout it feeds. The low-power timeout is
+ * the candidate with the lowest expected cost over the histogram, where
+ * staying awake costs idle draw, sleeping costs AI_TOY_POWER_LP_DRAW_PCT of
+ * it, and every gap that outlasts the timeout pays AI_TOY_POWER_WAKE_PENALTY
+ * for the slow wake.
+ *
+ * Listen delays, from opening the listen window to the first speech, in 1s
+ * buckets. A window that times out is counted at the current timeout, so if
+ * more than 1 - AI_TOY_POWER_LISTEN_PCT of windows run out the percentile
+ * lands on the timeout and the margin pushes it back up instead of the
+ * window shrinking for good.
+ *
+ * Both histograms halve every AI_TOY_POWER_HIST_WINDOW samples, old habits
+ * fade out. Nothing is persisted, a deep sleep wake starts from the defaults.
+ */
+typedef struct {
+    MUTEX_HANDLE        mutex;
+    UINT32_T            listen_def;
+    UINT32_T            lowpower_def;
+    UINT16_T            gap_hist[AI_TOY_POWER_GAP_BUCKETS];
+    UINT16_T            gap_cnt;
+    UINT16_T            listen_hist[AI_TOY_POWER_LISTEN_BUCKETS];
+    UINT16_T            listen_cnt;
+    AI_TOY_PWR_STATE_E  state;
+    SYS_TIME_T          state_ms;       ///< entry time of the current state
+    SYS_TIME_T          idle_ms;        ///< start of the current idle gap
+    SYS_TIME_T          listen_ms;      ///< open listen window, 0 when none
+    AI_TOY_POWER_STAT_T stat;
+} ai_toy_power_t;
+
+STATIC ai_toy_power_t s_power;
+
+STATIC VOID __power_lock(VOID)
+{
+    if (s_power.mutex) {
+        tal_mutex_lock(s_power.mutex);
+    }
+}
+
+STATIC VOID __power_unlock(VOID)
+{
+    if (s_power.mutex) {
+        tal_mutex_unlock(s_power.mutex);
+    }
+}
+
+STATIC VOID __hist_add(UINT16_T *hist, UINT8_T buckets, UINT16_T *cnt, UINT8_T idx)
+{
+    hist[idx]++;
+    if (++(*cnt) < AI_TOY_POWER_HIST_WINDOW) {
+        return;
+    }
+    *cnt = 0;
+    for (UINT8_T i = 0; i < buckets; i++) {
+        hist[i] >>= 1;
+        *cnt += hist[i];
+    }
+}
+
+STATIC UINT32_T __hist_total(CONST UINT16_T *hist, UINT8_T buckets)
+{
+    UINT32_T total = 0;
+
+    for (UINT8_T i = 0; i < buckets; i++) {
+        total += hist[i];
+    }
+    return total;
+}
+
+STATIC UINT8_T __gap_bucket(UINT32_T gap_ms)
+{
+    UINT32_T sec = gap_ms / 1000;
+    UINT8_T idx = 0;
+
+    while (sec > 1 && idx < AI_TOY_POWER_GAP_BUCKETS - 1) {
+        sec >>= 1;
+        idx++;
+    }
+    return idx;
+}
+
+/**
+ * @brief representative gap of a bucket, ms: the middle of [2^i, 2^(i+1)) s
+ */
+STATIC UINT64_T __gap_mid(UINT8_T idx)
+{
+    return (0 == idx) ? 1000 : (UINT64_T)3000 << (idx - 1);
+}
+
+/**
+ * @brief expected cost of one idle gap for a given low-power timeout, in
+ *        ms of awake idle draw times 100
+ */
+STATIC UINT64_T __lowpower_cost(UINT32_T timeout)
+{
+    UINT64_T cost = 0;
+
+    for (UINT8_T i = 0; i < AI_TOY_POWER_GAP_BUCKETS; i++) {
+        UINT64_T gap = __gap_mid(i);
+        UINT64_T c;
+
+        if (0 == s_power.gap_hist[i]) {
+            continue;
+        }
+        if (gap <= timeout) {
+            c = gap * 100;
+        } else {
+            c = (UINT64_T)timeout * 100 + (gap - timeout) * AI_TOY_POWER_LP_DRAW_PCT +
+                (UINT64_T)AI_TOY_POWER_WAKE_PENALTY * 100;
+        }
+        cost += c * s_power.gap_hist[i];
+    }
+    return cost;
+}
+
+STATIC UINT32_T __lowpower_pick(VOID)
+{
+    UINT32_T best = s_power.lowpower_def;
+    UINT64_T best_cost;
+
+    if (__hist_total(s_power.gap_hist, AI_TOY_POWER_GAP_BUCKETS) < AI_TOY_POWER_MIN_SAMPLES) {
+        return s_power.lowpower_def;
+    }
+    // candidates: the bounds and every bucket edge between them
+    best_cost = __lowpower_cost(best);
+    for (UINT8_T i = 0; i <= AI_TOY_POWER_GAP_BUCKETS; i++) {
+        UINT32_T t = (0 == i) ? AI_TOY_POWER_LOWPOWER_MIN : (1000U << (i - 1));
+        UINT64_T c;
+
+        if (t < AI_TOY_POWER_LOWPOWER_MIN) {
+            continue;
+        }
+        if (t >= s_power.lowpower_def) {
+            break;
+        }
+        c = __lowpower_cost(t);
+        if (c < best_cost) {
+            best_cost = c;
+            best = t;
+        }
+    }
+    return best;
+}
+
+STATIC UINT32_T __listen_pick(VOID)
+{
+    UINT32_T total = __hist_total(s_power.listen_hist, AI_TOY_POWER_LISTEN_BUCKETS);
+    UINT32_T need, acc = 0, timeout;
+    UINT8_T i;
+
+    if (total < AI_TOY_POWER_MIN_SAMPLES) {
+        return s_power.listen_def;
+    }
+    need = (total * AI_TOY_POWER_LISTEN_PCT + 99) / 100;
+    for (i = 0; i < AI_TOY_POWER_LISTEN_BUCKETS - 1; i++) {
+        acc += s_power.listen_hist[i];
+        if (acc >= need) {
+            break;
+        }
+    }
+    timeout = (UINT32_T)(i + 1) * 1000 + AI_TOY_POWER_LISTEN_MARGIN;
+    if (timeout < AI_TOY_POWER_LISTEN_MIN) {
+        timeout = AI_TOY_POWER_LISTEN_MIN;
+    }
+    return (timeout > s_power.listen_def) ? s_power.listen_def : timeout;
+}
+
+STATIC VOID __decide(VOID)
+{
+    UINT32_T listen = __listen_pick();
+    UINT32_T lowpower = __lowpower_pick();
+
+    if (listen == s_power.stat.listen_timeout && lowpower == s_power.stat.lowpower_timeout) {
+        return;
+    }
+    TAL_PR_NOTICE("power governor: listen %dms -> %dms, lowpower %dms -> %dms",
+                  s_power.stat.listen_timeout, listen, s_power.stat.lowpower_timeout, lowpower);
+    s_power.stat.listen_timeout = listen;
+    s_power.stat.lowpower_timeout = lowpower;
+    s_power.stat.decisions++;
+}
+
+STATIC VOID __listen_add(UINT32_T delay_ms)
+{
+    UINT32_T idx = delay_ms / 1000;
+
+    if (idx >= AI_TOY_POWER_LISTEN_BUCKETS) {
+        idx = AI_TOY_POWER_LISTEN_BUCKETS - 1;
+    }
+    __hist_add(s_power.listen_hist, AI_TOY_POWER_LISTEN_BUCKETS, &s_power.listen_cnt, (UINT8_T)idx);
+    __decide();
+}
+
+OPERATE_RET ai_toy_power_init(UINT32_T listen_ms, UINT32_T lowpower_ms)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == s_power.mutex) {
+        TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&s_power.mutex));
+    }
+    __power_lock();
+    s_power.listen_def = listen_ms;
+    s_power.lowpower_def = lowpower_ms;
+    s_power.stat.listen_timeout = listen_ms;
+    s_power.stat.lowpower_timeout = lowpower_ms;
+    s_power.state = AI_TOY_PWR_IDLE;
+    s_power.state_ms = tal_system_get_millisecond();
+    s_power.idle_ms = s_power.state_ms;
+    __power_unlock();
+    return OPRT_OK;
+}
+
+VOID ai_toy_power_state_set(AI_TOY_PWR_STATE_E state)
+{
+    SYS_TIME_T now = tal_system_get_millisecond();
+    AI_TOY_PWR_STATE_E old;
+
+    if (state >= AI_TOY_PWR_MAX) {
+        return;
+    }
+    __power_lock();
+    old = s_power.state;
+    if (old == state) {
+        __power_unlock();
+        return;
+    }
+    s_power.stat.residency_ms[old] += now - s_power.state_ms;
+    if (AI_TOY_PWR_LOWPOWER == old) {
+        // a sleep this short did not pay for its slow wake
+        s_power.stat.wakes++;
+        if (now - s_power.state_ms < AI_TOY_POWER_WAKE_PENALTY) {
+            s_power.stat.quick_wakes++;
+        }
+    }
+    s_power.state = state;
+    s_power.state_ms = now;
+
+    if (AI_TOY_PWR_ACTIVE == state) {
+        // the idle gap ends with the next interaction, slept through or not
+        __hist_add(s_power.gap_hist, AI_TOY_POWER_GAP_BUCKETS, &s_power.gap_cnt,
+                   __gap_bucket((UINT32_T)(now - s_power.idle_ms)));
+        s_power.stat.gaps++;
+        __decide();
+    } else if (AI_TOY_PWR_ACTIVE == old) {
+        s_power.idle_ms = now;
+    }
+    __power_unlock();
+}
+
+VOID ai_toy_power_listen_start(VOID)
+{
+    __power_lock();
+    s_power.listen_ms = tal_system_get_millisecond();
+    __power_unlock();
+}
+
+VOID ai_toy_power_listen_heard(VOID)
+{
+    __power_lock();
+    if (s_power.listen_ms) {
+        s_power.stat.listen_hits++;
+        __listen_add((UINT32_T)(tal_system_get_millisecond() - s_power.listen_ms));
+        s_power.listen_ms = 0;
+    }
+    __power_unlock();
+}
+
+VOID ai_toy_power_listen_expired(VOID)
+{
+    __power_lock();
+    if (s_power.listen_ms) {
+        s_power.stat.listen_misses++;
+        __listen_add(s_power.stat.listen_timeout);
+        s_power.listen_ms = 0;
+    }
+    __power_unlock();
+}
+
+UINT32_T ai_toy_power_listen_timeout(VOID)
+{
+    return __atomic_load_n(&s_power.stat.listen_timeout, __ATOMIC_RELAXED);
+}
+
+UINT32_T ai_toy_power_lowpower_timeout(VOID)
+{
+    return __atomic_load_n(&s_power.stat.lowpower_timeout, __ATOMIC_RELAXED);
+}
+
+VOID ai_toy_power_stat_get(AI_TOY_POWER_STAT_T *stat)
+{
+    if (NULL == stat) {
+        return;
+    }
+    __power_lock();
+    *stat = s_power.stat;
+    stat->residency_ms[s_power.state] += tal_system_get_millisecond() - s_power.state_ms;
+    __power_unlock();
+}
+
+VOID ai_toy_power_dump(VOID)
+{
+    STATIC CONST CHAR_T *state_str[AI_TOY_PWR_MAX] = {"active", "idle", "lowpower"};
+    AI_TOY_POWER_STAT_T stat;
+
+    ai_toy_power_stat_get(&stat);
+    for (UINT8_T i = 0; i < AI_TOY_PWR_MAX; i++) {
+        TAL_PR_NOTICE("power %-8s %ds", state_str[i], (UINT32_T)(stat.residency_ms[i] / 1000));
+    }
+    TAL_PR_NOTICE("power listen %dms (hit %d miss %d), lowpower %dms, %d decisions",
+                  stat.listen_timeout, stat.listen_hits, stat.listen_misses, stat.lowpower_timeout, stat.decisions);
+    TAL_PR_NOTICE("power %d gaps, %d wakes, %d quick", stat.gaps, stat.wakes, stat.quick_wakes);
+    __power_lock();
+    for (UINT8_T i = 0; i < AI_TOY_POWER_GAP_BUCKETS; i++) {
+        if (s_power.gap_hist[i]) {
+            TAL_PR_NOTICE("power gap >= %6ds: %d", (0 == i) ? 0 : (1 << i), s_power.gap_hist[i]);
+        }
+    }
+    __power_unlock();
+}
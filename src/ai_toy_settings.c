@@ -0,0 +1,322 @@
+#include "ai_toy_settings.h"
+#include "ai_toy_wheel.h"
+#include "tal_log.h"
+#include "tal_mutex.h"
+#include "tuya_ws_db.h"
+#include "ty_cJSON.h"
+#include <string.h>
+
+#define AI_TOY_SETTINGS_MAGIC           0x5441      // "AT"
+#define AI_TOY_SETTINGS_VERSION         1
+#define AI_TOY_SETTINGS_REC_MAX         64
+#define AI_TOY_SETTINGS_JSON_MAX        128         // largest legacy text record we migrate
+
+/**
+ * Stored record: header, payload of hdr.size bytes, CRC-32 over both.
+ * Fields are only ever appended to the payload, bump the version when
+ * one is added.
+ */
+typedef struct {
+    UINT16_T    magic;
+    UINT8_T     version;
+    UINT8_T     size;           ///< payload bytes that follow
+} AI_TOY_SETTINGS_HDR_T;
+
+typedef struct {
+    UINT8_T     volume;         ///< v1
+} AI_TOY_SETTINGS_DATA_T;
+
+_Static_assert(sizeof(AI_TOY_SETTINGS_HDR_T) + sizeof(AI_TOY_SETTINGS_DATA_T) + sizeof(UINT32_T) <= AI_TOY_SETTINGS_REC_MAX,
+               "settings record outgrew AI_TOY_SETTINGS_REC_MAX");
+
+/**
+ * Write-behind store: the first change in a window arms the flush timer,
+ * later changes in the same window only update the value. The window does
+ * not restart on every change, so a long slider drag still persists once per
+ * window instead of never.
+ */
+typedef struct {
+    MUTEX_HANDLE                mutex;
+    AI_TOY_WHEEL_TIMER_T        timer;
+    AI_TOY_SETTINGS_FLUSH_CB    cb;
+    UINT32_T                    window_ms;
+    UINT8_T                     volume;
+    UINT8_T                     saved_volume;
+    BOOL_T                      saved_valid;    // a record holding saved_volume is stored
+    BOOL_T                      dirty;
+    UINT8_T                     retries;        // failed writes of the pending value
+    UINT32_T                    report_mask;
+    AI_TOY_SETTINGS_STAT_T      stat;
+} ai_toy_settings_t;
+
+STATIC ai_toy_settings_t s_settings = {
+    .window_ms = AI_TOY_SETTINGS_WINDOW_MS,
+};
+
+/**
+ * @brief CRC-32 (IEEE, reflected), bitwise, the record is a handful of bytes
+ */
+STATIC UINT32_T __settings_crc32(CONST UINT8_T *buf, UINT32_T len)
+{
+    UINT32_T crc = 0xFFFFFFFF;
+
+    while (len--) {
+        crc ^= *buf++;
+        for (UINT8_T i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+STATIC OPERATE_RET __settings_write(UINT8_T volume)
+{
+    UINT8_T rec[AI_TOY_SETTINGS_REC_MAX];
+    AI_TOY_SETTINGS_HDR_T hdr = {
+        .magic = AI_TOY_SETTINGS_MAGIC,
+        .version = AI_TOY_SETTINGS_VERSION,
+        .size = sizeof(AI_TOY_SETTINGS_DATA_T),
+    };
+    AI_TOY_SETTINGS_DATA_T data = {
+        .volume = volume,
+    };
+    UINT32_T crc;
+
+    memcpy(rec, &hdr, sizeof(hdr));
+    memcpy(rec + sizeof(hdr), &data, sizeof(data));
+    crc = __settings_crc32(rec, sizeof(hdr) + sizeof(data));
+    memcpy(rec + sizeof(hdr) + sizeof(data), &crc, sizeof(crc));
+
+    return wd_common_write(AI_TOY_SETTINGS_KEY, rec, sizeof(hdr) + sizeof(data) + sizeof(crc));
+}
+
+/**
+ * @brief validate a binary record and copy its payload over the defaults
+ *
+ * A record from a newer firmware carries a longer payload, the fields this
+ * version knows are read and the tail is ignored. An older, shorter one
+ * leaves the newer fields at their defaults.
+ */
+STATIC OPERATE_RET __settings_decode(CONST BYTE_T *buf, UINT_T len, AI_TOY_SETTINGS_DATA_T *data)
+{
+    AI_TOY_SETTINGS_HDR_T hdr;
+    UINT32_T crc;
+
+    if (len < sizeof(hdr) + sizeof(crc)) {
+        return OPRT_INVALID_PARM;
+    }
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.magic != AI_TOY_SETTINGS_MAGIC || len != sizeof(hdr) + hdr.size + sizeof(crc)) {
+        return OPRT_INVALID_PARM;
+    }
+    memcpy(&crc, buf + sizeof(hdr) + hdr.size, sizeof(crc));
+    if (crc != __settings_crc32(buf, sizeof(hdr) + hdr.size)) {
+        TAL_PR_ERR("settings crc mismatch");
+        return OPRT_CRC32_FAILED;
+    }
+    memcpy(data, buf + sizeof(hdr), (hdr.size < sizeof(*data)) ? hdr.size : sizeof(*data));
+    return OPRT_OK;
+}
+
+/**
+ * @brief read the pre-binary {"volume": 70} text record, first boot after upgrade only
+ */
+STATIC OPERATE_RET __settings_decode_json(CONST BYTE_T *buf, UINT_T len, AI_TOY_SETTINGS_DATA_T *data)
+{
+    CHAR_T text[AI_TOY_SETTINGS_JSON_MAX];
+
+    if (0 == len || len >= sizeof(text) || '{' != buf[0]) {
+        return OPRT_INVALID_PARM;
+    }
+    memcpy(text, buf, len);
+    text[len] = '\0';
+
+    cJSON *root = ty_cJSON_Parse(text);
+    if (root == NULL) {
+        TAL_PR_ERR("parse ai_toy config fail");
+        return OPRT_CJSON_PARSE_ERR;
+    }
+    cJSON *child = ty_cJSON_GetObjectItem(root, "volume");
+    if (child && child->valueint <= 100 && child->valueint >= 0) {
+        data->volume = child->valueint;
+    } else {
+        TAL_PR_ERR("parse volume fail");
+    }
+    ty_cJSON_Delete(root);
+    return OPRT_OK;
+}
+
+OPERATE_RET ai_toy_settings_load(UINT8_T *volume)
+{
+    OPERATE_RET rt = OPRT_OK;
+    BYTE_T *value = NULL;
+    UINT_T len = 0;
+    AI_TOY_SETTINGS_DATA_T data = {
+        .volume = *volume,
+    };
+    BOOL_T stored = FALSE;
+
+    // nothing stored yet: the first flush writes whatever the volume is then
+    s_settings.volume = *volume;
+    s_settings.saved_valid = FALSE;
+    rt = wd_common_read(AI_TOY_SETTINGS_KEY, &value, &len);
+    if (OPRT_OK != rt) {
+        TAL_PR_NOTICE("no settings stored, rt %d, using defaults", rt);
+        return rt;
+    }
+    rt = __settings_decode(value, len, &data);
+    stored = (OPRT_OK == rt);
+    if (OPRT_OK != rt && OPRT_OK == __settings_decode_json(value, len, &data)) {
+        // migrate in place, the next boot takes the binary path
+        TAL_PR_NOTICE("settings migrated from json, volume %d", data.volume);
+        rt = OPRT_OK;
+        s_settings.stat.flash_writes++;
+        stored = (OPRT_OK == __settings_write(data.volume));
+        if (!stored) {
+            TAL_PR_ERR("save volume to kv fail");
+            s_settings.stat.flash_fails++;
+        }
+    }
+    wd_common_free_data(value);
+
+    if (OPRT_OK != rt) {
+        TAL_PR_ERR("settings record invalid, rt %d, using defaults", rt);
+    } else if (data.volume <= 100) {
+        *volume = data.volume;
+    } else {
+        stored = FALSE;
+    }
+    s_settings.volume = *volume;
+    s_settings.saved_volume = *volume;
+    s_settings.saved_valid = stored;
+    return rt;
+}
+
+/**
+ * @brief window closed, runs on the timer thread
+ */
+STATIC VOID __settings_timer_cb(VOID *arg)
+{
+    ai_toy_settings_flush();
+}
+
+OPERATE_RET ai_toy_settings_init(AI_TOY_SETTINGS_FLUSH_CB cb)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == s_settings.mutex) {
+        TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&s_settings.mutex));
+    }
+    s_settings.cb = cb;
+    ai_toy_wheel_timer_init(&s_settings.timer, __settings_timer_cb, NULL, 0);
+    return OPRT_OK;
+}
+
+VOID ai_toy_settings_volume_set(UINT8_T volume, UINT32_T report_mask)
+{
+    if (NULL == s_settings.mutex) {
+        return;
+    }
+    tal_mutex_lock(s_settings.mutex);
+    if (volume != s_settings.volume) {
+        s_settings.stat.changes++;
+    }
+    s_settings.volume = volume;
+    s_settings.report_mask |= report_mask;
+    s_settings.dirty = TRUE;
+    if (!ai_toy_wheel_is_armed(&s_settings.timer)) {
+        ai_toy_wheel_arm(&s_settings.timer, s_settings.window_ms);
+    }
+    tal_mutex_unlock(s_settings.mutex);
+}
+
+VOID ai_toy_settings_flush(VOID)
+{
+    OPERATE_RET rt = OPRT_OK;
+    BOOL_T write = FALSE;
+    UINT8_T volume;
+    UINT32_T report_mask;
+
+    if (NULL == s_settings.mutex) {
+        return;
+    }
+    tal_mutex_lock(s_settings.mutex);
+    ai_toy_wheel_cancel(&s_settings.timer);
+    if (!s_settings.dirty) {
+        tal_mutex_unlock(s_settings.mutex);
+        return;
+    }
+    volume = s_settings.volume;
+    report_mask = s_settings.report_mask;
+
+    // a drag that ended where it started needs no flash write, once a record exists
+    if (!s_settings.saved_valid || volume != s_settings.saved_volume) {
+        write = TRUE;
+        s_settings.stat.flash_writes++;
+        rt = __settings_write(volume);
+        if (OPRT_OK == rt) {
+            s_settings.saved_volume = volume;
+            s_settings.saved_valid = TRUE;
+        } else {
+            s_settings.stat.flash_fails++;
+        }
+    }
+    if (OPRT_OK != rt && s_settings.retries < AI_TOY_SETTINGS_RETRY_MAX) {
+        // keep it pending, retry after window << retries
+        UINT32_T delay = MIN((UINT64_T)s_settings.window_ms << s_settings.retries, AI_TOY_SETTINGS_RETRY_CAP_MS);
+        s_settings.retries++;
+        ai_toy_wheel_arm(&s_settings.timer, delay);
+        tal_mutex_unlock(s_settings.mutex);
+        TAL_PR_ERR("settings write fail %d, volume %d, retry %d in %dms", rt, volume, s_settings.retries, delay);
+        return;
+    }
+    if (OPRT_OK != rt) {
+        s_settings.stat.gave_up++;
+        TAL_PR_ERR("settings write fail %d, volume %d left unsaved", rt, volume);
+    }
+    s_settings.retries = 0;
+    s_settings.dirty = FALSE;
+    s_settings.report_mask = 0;
+    s_settings.stat.flushes++;
+    tal_mutex_unlock(s_settings.mutex);
+
+    if (write) {
+        TAL_PR_DEBUG("settings flushed, volume %d, rt %d", volume, rt);
+    }
+    if (s_settings.cb) {
+        s_settings.cb(volume, report_mask);
+    }
+}
+
+OPERATE_RET ai_toy_settings_erase(VOID)
+{
+    OPERATE_RET ret = OPRT_OK;
+
+    if (s_settings.mutex) {
+        tal_mutex_lock(s_settings.mutex);
+        ai_toy_wheel_cancel(&s_settings.timer);
+        s_settings.dirty = FALSE;
+        s_settings.retries = 0;
+        s_settings.report_mask = 0;
+    }
+    ret = wd_common_delete(AI_TOY_SETTINGS_KEY);
+    s_settings.saved_valid = FALSE;
+    if (s_settings.mutex) {
+        tal_mutex_unlock(s_settings.mutex);
+    }
+    TAL_PR_NOTICE("delete key=%s, ret = %d", AI_TOY_SETTINGS_KEY, ret);
+    return ret;
+}
+
+VOID ai_toy_settings_window_set(UINT32_T window_ms)
+{
+    s_settings.window_ms = window_ms;
+}
+
+VOID ai_toy_settings_stat_get(AI_TOY_SETTINGS_STAT_T *stat)
+{
+    if (NULL == stat) {
+        return;
+    }
+    *stat = s_settings.stat;
+}
@@ -0,0 +1,77 @@
+#include "ai_toy_text.h"
+#include <string.h>
+
+UINT_T ai_toy_utf8_complete_len(CONST CHAR_T *buf, UINT_T len)
+{
+    UINT_T i = len;
+    UINT_T back = 0;
+
+    // find the lead byte of the last codepoint, at most 3 continuation bytes back
+    while (i > 0 && back < 4) {
+        UCHAR_T c = (UCHAR_T)buf[i - 1];
+        i--;
+        back++;
+        if ((c & 0xC0) != 0x80) {
+            UINT_T need = (c < 0x80) ? 1 : ((c & 0xE0) == 0xC0) ? 2 : ((c & 0xF0) == 0xE0) ? 3 : ((c & 0xF8) == 0xF0) ? 4 : 1;
+            return (back >= need) ? len : i;
+        }
+    }
+
+    // no lead byte found, not UTF-8, flush everything
+    return len;
+}
+
+STATIC VOID __text_stream_flush(AI_TOY_TEXT_STREAM_T *st, BOOL_T force)
+{
+    UINT_T cut = force ? st->len : ai_toy_utf8_complete_len(st->buf, st->len);
+    if (0 == cut) {
+        cut = st->len;
+    }
+
+    CHAR_T keep = st->buf[cut];
+    st->buf[cut] = '\0';
+    if (st->line_cb) {
+        st->line_cb(st->buf, cut, st->arg);
+    }
+    st->buf[cut] = keep;
+
+    // carry the incomplete codepoint tail (at most 3 bytes) to the next line
+    st->len -= cut;
+    if (st->len) {
+        memmove(st->buf, st->buf + cut, st->len);
+    }
+}
+
+VOID ai_toy_text_stream_init(AI_TOY_TEXT_STREAM_T *st, AI_TOY_TEXT_LINE_CB line_cb, VOID *arg)
+{
+    memset(st, 0, sizeof(*st));
+    st->line_cb = line_cb;
+    st->arg = arg;
+}
+
+VOID ai_toy_text_stream_start(AI_TOY_TEXT_STREAM_T *st)
+{
+    st->len = 0;
+}
+
+VOID ai_toy_text_stream_put(AI_TOY_TEXT_STREAM_T *st, CONST UCHAR_T *data, UINT_T len)
+{
+    while (len > 0) {
+        UINT_T room = sizeof(st->buf) - 1 - st->len;
+        UINT_T n = MIN(len, room);
+        memcpy(st->buf + st->len, data, n);
+        st->len += n;
+        len -= n;
+        data += n;
+        if (st->len >= sizeof(st->buf) - 1) {
+            __text_stream_flush(st, FALSE);
+        }
+    }
+}
+
+VOID ai_toy_text_stream_stop(AI_TOY_TEXT_STREAM_T *st)
+{
+    if (st->len > 0) {
+        __text_stream_flush(st, TRUE);
+    }
+}
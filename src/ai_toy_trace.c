@@ -0,0 +1,216 @@
+#include "ai_toy_trace.h"
+#include "tal_log.h"
+#include <string.h>
+
+STATIC CONST CHAR_T *s_tp_name[AI_TOY_TP_MAX] = {
+    "queue",
+    "led",
+    "player_stop",
+    "llm_interrupt",
+    "alert",
+    "state_update",
+    "total",
+};
+
+STATIC AI_TOY_TRACE_HIST_T s_trace_hist[AI_TOY_TP_MAX];
+
+#if AI_TOY_TRACE_CYCCNT
+/**
+ * DWT cycle counter extended to 64-bit microseconds
+ *
+ * CYCCNT wraps every 2^32 cycles (about 9 s at 480 MHz). Each call converts
+ * the cycles since the previous call and carries the remainder, so the clock
+ * keeps cycle resolution while calls are less than half a wrap apart; after a
+ * longer gap the millisecond tick supplies the step. Without
+ * AI_TOY_TRACE_CPU_MHZ the cycle rate is measured against the tick over the
+ * first TRACE_CAL_MIN_MS, the tick alone drives the clock until then.
+ */
+#define DWT_CTRL                        (*(volatile UINT32_T *)0xE0001000)
+#define DWT_CYCCNT                      (*(volatile UINT32_T *)0xE0001004)
+#define DEMCR                           (*(volatile UINT32_T *)0xE000EDFC)
+#define DEMCR_TRCENA                    (1U << 24)
+#define DWT_CTRL_CYCCNTENA              (1U << 0)
+
+#define TRACE_CAL_MIN_MS                100
+#define TRACE_CAL_MAX_MS                2000    // inside one wrap up to 2 GHz
+
+typedef struct {
+    BOOL_T          started;
+    UINT32_T        mhz;                // cycles per us, 0 until calibrated
+    UINT32_T        gap_ms;             // half a wrap, longer gaps step on the tick
+    UINT32_T        last_cyc;
+    SYS_TIME_T      last_ms;
+    UINT64_T        us;
+    UINT32_T        cal_cyc;
+    SYS_TIME_T      cal_ms;
+} trace_clock_t;
+
+STATIC trace_clock_t s_clock;
+
+STATIC VOID __clock_rate_set(trace_clock_t *c, UINT32_T mhz)
+{
+    c->mhz    = MAX(mhz, 1);
+    c->gap_ms = 0x80000000U / (c->mhz * 1000);
+}
+
+UINT64_T ai_toy_trace_now_us(VOID)
+{
+    trace_clock_t *c = &s_clock;
+    UINT64_T us;
+
+    TAL_ENTER_CRITICAL();
+    if (!c->started) {
+        DEMCR    |= DEMCR_TRCENA;
+        DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+        c->last_cyc = c->cal_cyc = DWT_CYCCNT;
+        c->last_ms  = c->cal_ms  = tal_system_get_millisecond();
+        c->us       = (UINT64_T)c->last_ms * 1000;
+        if (AI_TOY_TRACE_CPU_MHZ) {
+            __clock_rate_set(c, AI_TOY_TRACE_CPU_MHZ);
+        }
+        c->started = TRUE;
+    }
+
+    UINT32_T cyc = DWT_CYCCNT;
+    SYS_TIME_T ms = tal_system_get_millisecond();
+
+    if (0 == c->mhz) {
+        SYS_TIME_T cal = ms - c->cal_ms;
+        if (cal > TRACE_CAL_MAX_MS) {
+            c->cal_cyc = cyc;
+            c->cal_ms  = ms;
+        } else if (cal >= TRACE_CAL_MIN_MS) {
+            __clock_rate_set(c, (UINT32_T)(((UINT64_T)(cyc - c->cal_cyc) + cal * 500) / (cal * 1000)));
+        }
+    }
+
+    if (0 == c->mhz || ms - c->last_ms >= c->gap_ms) {
+        c->us      += (UINT64_T)(ms - c->last_ms) * 1000;
+        c->last_cyc = cyc;
+    } else {
+        UINT32_T step = (cyc - c->last_cyc) / c->mhz;
+        c->us       += step;
+        c->last_cyc += step * c->mhz;
+    }
+    c->last_ms = ms;
+    us = c->us;
+    TAL_EXIT_CRITICAL();
+
+    return us;
+}
+#endif
+
+#if AI_TOY_TRACE_ENABLE
+volatile BOOL_T g_ai_toy_trace_on = TRUE;
+
+// barge-in steps run on the toy worker, one trace is open at a time; t0 is the recorder callback
+STATIC UINT64_T s_trace_t0;
+STATIC UINT64_T s_trace_prev;
+
+STATIC VOID __hist_add(AI_TOY_TRACE_HIST_T *h, UINT32_T us)
+{
+    UINT32_T b = 0;
+
+    while (b < AI_TOY_TRACE_HIST_BUCKETS - 1 && (us >> b) > 1) {
+        b++;
+    }
+    h->bucket[b]++;
+    if (0 == h->count || us < h->min_us) {
+        h->min_us = us;
+    }
+    if (us > h->max_us) {
+        h->max_us = us;
+    }
+    h->sum_us += us;
+    h->count++;
+}
+
+VOID ai_toy_trace_begin(UINT32_T stamp_us)
+{
+    UINT64_T now = AI_TOY_TRACE_NOW_US();
+
+    s_trace_prev = now;
+    if (0 == stamp_us) {
+        s_trace_t0 = now;
+        return;
+    }
+    // the stamp holds the low bits of the same clock, the wait is far below a wrap
+    UINT32_T wait = (UINT32_T)now - stamp_us;
+    s_trace_t0 = now - wait;
+    __hist_add(&s_trace_hist[AI_TOY_TP_QUEUE], wait);
+}
+
+VOID ai_toy_trace_point(AI_TOY_TRACE_POINT_E tp)
+{
+    if (tp >= AI_TOY_TP_MAX || 0 == s_trace_t0) {
+        return;
+    }
+    UINT64_T now = AI_TOY_TRACE_NOW_US();
+    __hist_add(&s_trace_hist[tp], (UINT32_T)(now - s_trace_prev));
+    s_trace_prev = now;
+}
+
+VOID ai_toy_trace_end(VOID)
+{
+    if (0 == s_trace_t0) {
+        return;
+    }
+    __hist_add(&s_trace_hist[AI_TOY_TP_TOTAL], (UINT32_T)(AI_TOY_TRACE_NOW_US() - s_trace_t0));
+    s_trace_t0 = 0;
+}
+#endif
+
+VOID ai_toy_trace_enable(BOOL_T enable)
+{
+#if AI_TOY_TRACE_ENABLE
+    g_ai_toy_trace_on = enable;
+#endif
+}
+
+OPERATE_RET ai_toy_trace_hist_get(AI_TOY_TRACE_POINT_E tp, AI_TOY_TRACE_HIST_T *hist)
+{
+    if (tp >= AI_TOY_TP_MAX || NULL == hist) {
+        return OPRT_INVALID_PARM;
+    }
+    memcpy(hist, &s_trace_hist[tp], sizeof(AI_TOY_TRACE_HIST_T));
+    return OPRT_OK;
+}
+
+/**
+ * @brief upper bound of the bucket holding the 99th percentile sample
+ */
+STATIC UINT32_T __hist_p99(CONST AI_TOY_TRACE_HIST_T *h)
+{
+    UINT32_T target = h->count - h->count / 100;
+    UINT32_T acc = 0;
+
+    for (UINT32_T b = 0; b < AI_TOY_TRACE_HIST_BUCKETS; b++) {
+        acc += h->bucket[b];
+        if (acc >= target) {
+            UINT32_T upper = (b >= 31) ? 0xFFFFFFFF : ((1U << (b + 1)) - 1);
+            return MIN(upper, h->max_us);
+        }
+    }
+    return h->max_us;
+}
+
+VOID ai_toy_trace_dump(VOID)
+{
+#if AI_TOY_TRACE_CYCCNT
+    TAL_PR_NOTICE("trace clock: cycle counter, %u MHz", s_clock.mhz);
+#endif
+    TAL_PR_NOTICE("barge-in trace (us)    count      min      avg      p99      max");
+    for (INT_T i = 0; i < AI_TOY_TP_MAX; i++) {
+        AI_TOY_TRACE_HIST_T *h = &s_trace_hist[i];
+        if (0 == h->count) {
+            continue;
+        }
+        TAL_PR_NOTICE("  %-16s %8u %8u %8u %8u %8u", s_tp_name[i], h->count, h->min_us,
+                      (UINT32_T)(h->sum_us / h->count), __hist_p99(h), h->max_us);
+    }
+}
+
+VOID ai_toy_trace_reset(VOID)
+{
+    memset(s_trace_hist, 0, sizeof(s_trace_hist));
+}
@@ -0,0 +1,146 @@
+#include "ai_toy_wake.h"
+#include "ai_toy_trace.h"
+#include "tal_log.h"
+#include "tal_mutex.h"
+#include <string.h>
+
+/**
+ * One wake is open at a time, from the press until the next press. Stages
+ * are stamped relative to the press and folded into the stats right away,
+ * a stage that never happens (no recorder start for this key) simply does
+ * not count. The first audio frame comes from the recorder thread, the rest
+ * from the worker, so the marks go through a critical section; it is a
+ * handful of stores.
+ */
+typedef struct {
+    UINT64_T            press_us;       ///< 0 when no wake is open
+    BOOL_T              audio_armed;
+    UINT8_T             marked;         ///< bitmap of stages stamped in this wake
+    AI_TOY_WAKE_STAT_T  stat;
+} ai_toy_wake_t;
+
+STATIC ai_toy_wake_t s_wake;
+STATIC MUTEX_HANDLE s_wake_mutex = NULL;
+
+STATIC VOID __wake_lock(VOID)
+{
+    if (s_wake_mutex) {
+        tal_mutex_lock(s_wake_mutex);
+    }
+}
+
+STATIC VOID __wake_unlock(VOID)
+{
+    if (s_wake_mutex) {
+        tal_mutex_unlock(s_wake_mutex);
+    }
+}
+
+STATIC VOID __wake_record(AI_TOY_WAKE_STAGE_E stage, UINT64_T now)
+{
+    AI_TOY_WAKE_STAGE_STAT_T *st = &s_wake.stat.stage[stage];
+    UINT32_T us = (UINT32_T)(now - s_wake.press_us);
+
+    if (s_wake.marked & (1 << stage)) {
+        return;
+    }
+    s_wake.marked |= (1 << stage);
+    st->count++;
+    st->last_us = us;
+    st->sum_us += us;
+    if (us > st->max_us) {
+        st->max_us = us;
+    }
+}
+
+OPERATE_RET ai_toy_wake_init(VOID)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (NULL == s_wake_mutex) {
+        TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&s_wake_mutex));
+    }
+    return OPRT_OK;
+}
+
+VOID ai_toy_wake_press(UINT32_T stamp_us)
+{
+    UINT64_T now = AI_TOY_TRACE_NOW_US();
+
+    // the stamp holds the low bits of the same clock, the queue wait is far below a wrap
+    if (stamp_us) {
+        now -= (UINT32_T)now - stamp_us;
+    }
+    __wake_lock();
+    s_wake.press_us = now;
+    s_wake.audio_armed = FALSE;
+    s_wake.marked = 0;
+    s_wake.stat.wakes++;
+    __wake_unlock();
+}
+
+VOID ai_toy_wake_mark(AI_TOY_WAKE_STAGE_E stage)
+{
+    UINT64_T now = AI_TOY_TRACE_NOW_US();
+
+    if (stage >= AI_TOY_WAKE_ST_MAX || AI_TOY_WAKE_ST_AUDIO == stage) {
+        return;
+    }
+    __wake_lock();
+    if (s_wake.press_us) {
+        __wake_record(stage, now);
+        if (AI_TOY_WAKE_ST_RECORDER == stage) {
+            s_wake.audio_armed = TRUE;
+        }
+    }
+    __wake_unlock();
+}
+
+VOID ai_toy_wake_audio(VOID)
+{
+    UINT64_T now;
+
+    // recorder hot path, almost always disarmed
+    if (!__atomic_load_n(&s_wake.audio_armed, __ATOMIC_RELAXED)) {
+        return;
+    }
+    now = AI_TOY_TRACE_NOW_US();
+    __wake_lock();
+    if (s_wake.audio_armed) {
+        s_wake.audio_armed = FALSE;
+        if (now - s_wake.press_us <= AI_TOY_WAKE_AUDIO_MAX) {
+            __wake_record(AI_TOY_WAKE_ST_AUDIO, now);
+            TAL_PR_NOTICE("wake: press to first audio %dus", s_wake.stat.stage[AI_TOY_WAKE_ST_AUDIO].last_us);
+        }
+    }
+    __wake_unlock();
+}
+
+VOID ai_toy_wake_stat_get(AI_TOY_WAKE_STAT_T *stat)
+{
+    if (NULL == stat) {
+        return;
+    }
+    __wake_lock();
+    *stat = s_wake.stat;
+    __wake_unlock();
+}
+
+VOID ai_toy_wake_dump(VOID)
+{
+    STATIC CONST CHAR_T *stage_str[AI_TOY_WAKE_ST_MAX] = {
+        "dispatch", "cpu", "ack", "recorder", "wifi", "periph", "audio"
+    };
+    AI_TOY_WAKE_STAT_T stat;
+
+    ai_toy_wake_stat_get(&stat);
+    TAL_PR_NOTICE("wake: %d wakes from keep-alive", stat.wakes);
+    for (UINT8_T i = 0; i < AI_TOY_WAKE_ST_MAX; i++) {
+        CONST AI_TOY_WAKE_STAGE_STAT_T *st = &stat.stage[i];
+        if (0 == st->count) {
+            continue;
+        }
+        TAL_PR_NOTICE("wake %-8s n %4d last %7dus avg %7dus max %7dus", stage_str[i], st->count,
+                      st->last_us, (UINT32_T)(st->sum_us / st->count), st->max_us);
+    }
+}
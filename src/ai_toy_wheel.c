@@ -0,0 +1,491 @@
+#include "ai_toy_wheel.h"
+#include "tal_log.h"
+#include "tal_mutex.h"
+#include "tal_sw_timer.h"
+#include "tal_system.h"
+#include <string.h>
+
+#define WHEEL_NEVER     0xFFFFFFFF
+#define WHEEL_SLOTS     64      // one bit each in the occupancy map
+#define WHEEL_SLOT_MASK (WHEEL_SLOTS - 1)
+
+/**
+ * Armed timers hang off a hashed wheel: slot (expire % WHEEL_SLOTS) keeps its
+ * timers in arm order, and a bitmap says which slots are in use. Arm appends
+ * to one slot and cancel unlinks in place, both O(1). A timer further out
+ * than one turn shares its slot with nearer ones and is skipped until its
+ * own turn comes.
+ *
+ * Each slot keeps a lower bound of its earliest (expire + slack). A wake-up
+ * only walks the slots whose tick has passed since the last one, or every
+ * used slot after a gap of a whole turn, and takes the next wake-up from the
+ * bounds of the others. Cancel leaves the bound alone; at worst that costs
+ * one early wake-up that finds nothing due and re-aims.
+ *
+ * One one-shot software timer drives the whole wheel. It is aimed at the
+ * earliest (expire + slack) of everything pending; when it fires, every timer
+ * whose deadline has passed by then runs in the same wake-up, in expire order
+ * and in arm order within a tick. Re-arming or cancelling never pulls the
+ * wake-up later.
+ *
+ * Timers moved onto the manual clock keep a wheel of their own, which only
+ * ai_toy_wheel_advance runs, so a benchmark never holds back real timers.
+ */
+typedef enum {
+    WHEEL_CLK_REAL,
+    WHEEL_CLK_MANUAL,
+    WHEEL_CLK_MAX
+} ai_toy_wheel_clk_e;
+
+typedef struct {
+    AI_TOY_WHEEL_TIMER_T   *head;
+    AI_TOY_WHEEL_TIMER_T  **tail;       // next field of the last timer, valid while head is set
+} ai_toy_wheel_list_t;
+
+typedef struct {
+    ai_toy_wheel_list_t     list;       // arm order
+    UINT32_T                next;       // lower bound of the earliest expire + slack
+} ai_toy_wheel_slot_t;
+
+typedef struct {
+    UINT32_T                wake;       // absolute tick of the next wake-up
+    UINT32_T                last;       // every tick up to here has been collected
+    UINT64_T                used;       // bit per non-empty slot
+    ai_toy_wheel_slot_t     slot[WHEEL_SLOTS];
+    ai_toy_wheel_list_t     due;        // collected, waiting for their callback, by expire
+    UINT32_T                due_max;    // upper bound of the last expire on the due list
+    AI_TOY_WHEEL_TIMER_T   *running;    // callback in progress, lock dropped
+} ai_toy_wheel_clk_t;
+
+typedef struct {
+    MUTEX_HANDLE            mutex;
+    TIMER_ID                timer;      // drives the real clock
+    UINT32_T                pending;
+    ai_toy_wheel_clk_t      clk[WHEEL_CLK_MAX];
+    AI_TOY_WHEEL_TIMER_T   *free;
+    AI_TOY_WHEEL_TIMER_T    pool[AI_TOY_WHEEL_POOL];
+    AI_TOY_WHEEL_STAT_T     stat;
+    UINT32_T                manual_ms;  // only moves in ai_toy_wheel_advance
+} ai_toy_wheel_t;
+
+_Static_assert(WHEEL_SLOTS == 64, "the occupancy map is one UINT64_T");
+
+STATIC ai_toy_wheel_t s_wheel;
+
+STATIC UINT32_T __wheel_now_tick(ai_toy_wheel_clk_e clk)
+{
+    if (WHEEL_CLK_MANUAL == clk) {
+        return s_wheel.manual_ms / AI_TOY_WHEEL_TICK_MS;
+    }
+    return (UINT32_T)(tal_system_get_millisecond() / AI_TOY_WHEEL_TICK_MS);
+}
+
+STATIC VOID __list_append(ai_toy_wheel_list_t *l, AI_TOY_WHEEL_TIMER_T *t)
+{
+    if (NULL == l->head) {
+        l->tail = &l->head;
+    }
+    t->next = NULL;
+    t->pprev = l->tail;
+    *l->tail = t;
+    l->tail = &t->next;
+}
+
+// link t in front of *pos, pos is a next field of l or its head
+STATIC VOID __list_insert(ai_toy_wheel_list_t *l, AI_TOY_WHEEL_TIMER_T **pos, AI_TOY_WHEEL_TIMER_T *t)
+{
+    if (NULL == *pos) {
+        __list_append(l, t);
+        return;
+    }
+    t->next = *pos;
+    t->next->pprev = &t->next;
+    t->pprev = pos;
+    *pos = t;
+}
+
+STATIC VOID __list_unlink(ai_toy_wheel_list_t *l, AI_TOY_WHEEL_TIMER_T *t)
+{
+    if (l->tail == &t->next) {
+        l->tail = t->pprev;
+    }
+    *t->pprev = t->next;
+    if (t->next) {
+        t->next->pprev = t->pprev;
+    }
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+/**
+ * @brief aim the clock's next wake-up at tick, only ever earlier than it already is
+ */
+STATIC VOID __wheel_aim(ai_toy_wheel_clk_e clk, UINT32_T now, UINT32_T tick)
+{
+    ai_toy_wheel_clk_t *c = &s_wheel.clk[clk];
+
+    if (WHEEL_NEVER != c->wake && (INT32_T)(tick - c->wake) >= 0) {
+        return;
+    }
+    c->wake = tick;
+    if (WHEEL_CLK_MANUAL == clk) {
+        return;     // ai_toy_wheel_advance picks it up
+    }
+    UINT32_T ticks = ((INT32_T)(tick - now) > 0) ? (tick - now) : 1;
+    tal_sw_timer_start(s_wheel.timer, ticks * AI_TOY_WHEEL_TICK_MS, TAL_TIMER_ONCE);
+}
+
+STATIC VOID __wheel_insert(AI_TOY_WHEEL_TIMER_T *t, UINT32_T now, UINT32_T delay_ms)
+{
+    ai_toy_wheel_clk_t *c = &s_wheel.clk[t->clk];
+    UINT32_T ticks = (delay_ms + AI_TOY_WHEEL_TICK_MS - 1) / AI_TOY_WHEEL_TICK_MS;
+
+    // at least one tick ahead, so it cannot land behind the current wake-up;
+    // now was read before the lock, a wake-up may have collected past it since
+    t->expire = now + (ticks ? ticks : 1);
+    if ((INT32_T)(t->expire - c->last) <= 0) {
+        t->expire = c->last + 1;
+    }
+
+    UINT32_T idx = t->expire & WHEEL_SLOT_MASK;
+    ai_toy_wheel_slot_t *s = &c->slot[idx];
+    if (NULL == s->list.head || (INT32_T)(t->expire + t->slack - s->next) < 0) {
+        s->next = t->expire + t->slack;
+    }
+    // behind every timer with the same expire, they fire in arm order
+    __list_append(&s->list, t);
+    t->due = FALSE;
+    c->used |= (1ULL << idx);
+
+    if (++s_wheel.pending > s_wheel.stat.max_pending) {
+        s_wheel.stat.max_pending = s_wheel.pending;
+    }
+    __wheel_aim(t->clk, now, t->expire + t->slack);
+}
+
+STATIC VOID __wheel_remove(AI_TOY_WHEEL_TIMER_T *t)
+{
+    ai_toy_wheel_clk_t *c = &s_wheel.clk[t->clk];
+
+    if (t->due) {
+        __list_unlink(&c->due, t);
+        t->due = FALSE;
+    } else {
+        UINT32_T idx = t->expire & WHEEL_SLOT_MASK;
+        __list_unlink(&c->slot[idx].list, t);
+        if (NULL == c->slot[idx].list.head) {
+            c->used &= ~(1ULL << idx);
+        }
+    }
+    s_wheel.pending--;
+}
+
+/**
+ * @brief queue a collected timer for its callback, behind every timer with
+ *        an expire up to its own
+ */
+STATIC VOID __wheel_due_add(ai_toy_wheel_clk_t *c, AI_TOY_WHEEL_TIMER_T *t)
+{
+    if (NULL == c->due.head || (INT32_T)(t->expire - c->due_max) >= 0) {
+        __list_append(&c->due, t);
+        c->due_max = t->expire;
+    } else {
+        // only after a gap of a whole turn, a slot can hold due timers of two ticks
+        AI_TOY_WHEEL_TIMER_T **pos = &c->due.head;
+        while (*pos && (INT32_T)((*pos)->expire - t->expire) <= 0) {
+            pos = &(*pos)->next;
+        }
+        __list_insert(&c->due, pos, t);
+    }
+    t->due = TRUE;
+}
+
+/**
+ * @brief move every timer due at now onto the due list, in expire order, and
+ *        return the next wake-up for the rest
+ *
+ * Slots are visited in tick order starting after the last collected tick.
+ * Within less than a turn only the slots of the elapsed ticks can hold due
+ * timers, each of a single tick; the other slots just contribute their bound.
+ */
+STATIC UINT32_T __wheel_collect(ai_toy_wheel_clk_t *c, UINT32_T now)
+{
+    UINT32_T elapsed = now - c->last;
+    UINT32_T start = (c->last + 1) & WHEEL_SLOT_MASK;
+    UINT64_T used = start ? ((c->used >> start) | (c->used << (WHEEL_SLOTS - start))) : c->used;
+    UINT32_T next = WHEEL_NEVER;
+
+    if ((INT32_T)elapsed <= 0) {
+        elapsed = 0;
+    }
+    while (used) {
+        UINT32_T dist = __builtin_ctzll(used);
+        UINT32_T idx = (start + dist) & WHEEL_SLOT_MASK;
+        ai_toy_wheel_slot_t *s = &c->slot[idx];
+        AI_TOY_WHEEL_TIMER_T *t;
+
+        used &= used - 1;
+        if (elapsed < WHEEL_SLOTS && dist >= elapsed) {
+            if (WHEEL_NEVER == next || (INT32_T)(s->next - next) < 0) {
+                next = s->next;
+            }
+            continue;
+        }
+
+        // walk the slot, due timers leave, the bound is rebuilt from the rest
+        UINT32_T bound = WHEEL_NEVER;
+        t = s->list.head;
+        while (t) {
+            AI_TOY_WHEEL_TIMER_T *n = t->next;
+            if ((INT32_T)(t->expire - now) <= 0) {
+                __list_unlink(&s->list, t);
+                __wheel_due_add(c, t);
+            } else if (WHEEL_NEVER == bound || (INT32_T)(t->expire + t->slack - bound) < 0) {
+                bound = t->expire + t->slack;
+            }
+            t = n;
+        }
+        if (NULL == s->list.head) {
+            c->used &= ~(1ULL << idx);
+            continue;
+        }
+        s->next = bound;
+        if (WHEEL_NEVER == next || (INT32_T)(bound - next) < 0) {
+            next = bound;
+        }
+    }
+    if ((INT32_T)(now - c->last) > 0) {
+        c->last = now;
+    }
+    return next;
+}
+
+STATIC VOID __wheel_run(ai_toy_wheel_clk_e clk)
+{
+    ai_toy_wheel_clk_t *c = &s_wheel.clk[clk];
+    UINT32_T now = __wheel_now_tick(clk);
+    UINT32_T fired = 0;
+
+    tal_mutex_lock(s_wheel.mutex);
+    s_wheel.stat.wakeups++;
+    c->wake = WHEEL_NEVER;
+    UINT32_T next = __wheel_collect(c, now);
+
+    // one at a time, so a callback may arm or cancel any timer, itself included
+    while (c->due.head) {
+        AI_TOY_WHEEL_TIMER_T *t = c->due.head;
+        AI_TOY_WHEEL_CB cb = t->cb;
+        VOID *cb_arg = t->arg;
+
+        __wheel_remove(t);
+        t->fired_gen = t->gen;
+        if (t->pooled) {
+            t->next = s_wheel.free;
+            s_wheel.free = t;
+        }
+        s_wheel.stat.fired++;
+        if (fired++) {
+            s_wheel.stat.coalesced++;
+        }
+        c->running = t;
+        tal_mutex_unlock(s_wheel.mutex);
+        cb(cb_arg);
+        tal_mutex_lock(s_wheel.mutex);
+        c->running = NULL;
+    }
+
+    if (WHEEL_NEVER != next) {
+        __wheel_aim(clk, __wheel_now_tick(clk), next);
+    }
+    tal_mutex_unlock(s_wheel.mutex);
+}
+
+STATIC VOID __wheel_timer_cb(TIMER_ID timer_id, VOID_T *arg)
+{
+    __wheel_run(WHEEL_CLK_REAL);
+}
+
+OPERATE_RET ai_toy_wheel_init(VOID)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (s_wheel.mutex) {
+        return OPRT_OK;
+    }
+    memset(&s_wheel, 0, sizeof(s_wheel));
+    s_wheel.clk[WHEEL_CLK_REAL].wake = WHEEL_NEVER;
+    s_wheel.clk[WHEEL_CLK_REAL].last = __wheel_now_tick(WHEEL_CLK_REAL);
+    s_wheel.clk[WHEEL_CLK_MANUAL].wake = WHEEL_NEVER;
+    for (UINT32_T i = 0; i < AI_TOY_WHEEL_POOL; i++) {
+        s_wheel.pool[i].pooled = TRUE;
+        s_wheel.pool[i].next = s_wheel.free;
+        s_wheel.free = &s_wheel.pool[i];
+    }
+    TUYA_CALL_ERR_RETURN(tal_sw_timer_create(__wheel_timer_cb, NULL, &s_wheel.timer));
+    rt = tal_mutex_create_init(&s_wheel.mutex);
+    if (OPRT_OK != rt) {
+        tal_sw_timer_delete(s_wheel.timer);
+        s_wheel.timer = NULL;
+    }
+    return rt;
+}
+
+VOID ai_toy_wheel_timer_init(AI_TOY_WHEEL_TIMER_T *timer, AI_TOY_WHEEL_CB cb, VOID *arg, UINT32_T slack_ms)
+{
+    memset(timer, 0, sizeof(AI_TOY_WHEEL_TIMER_T));
+    timer->cb = cb;
+    timer->arg = arg;
+    timer->slack = slack_ms / AI_TOY_WHEEL_TICK_MS;
+}
+
+OPERATE_RET ai_toy_wheel_arm(AI_TOY_WHEEL_TIMER_T *timer, UINT32_T delay_ms)
+{
+    if (NULL == s_wheel.mutex || NULL == timer || NULL == timer->cb) {
+        return OPRT_INVALID_PARM;
+    }
+
+    UINT32_T now = __wheel_now_tick(timer->clk);
+
+    tal_mutex_lock(s_wheel.mutex);
+    if (timer->pprev) {
+        __wheel_remove(timer);
+    }
+    timer->gen++;
+    __wheel_insert(timer, now, delay_ms);
+    tal_mutex_unlock(s_wheel.mutex);
+
+    return OPRT_OK;
+}
+
+VOID ai_toy_wheel_cancel(AI_TOY_WHEEL_TIMER_T *timer)
+{
+    if (NULL == s_wheel.mutex || NULL == timer) {
+        return;
+    }
+    tal_mutex_lock(s_wheel.mutex);
+    if (timer->pprev) {
+        __wheel_remove(timer);
+    }
+    timer->gen++;
+    tal_mutex_unlock(s_wheel.mutex);
+}
+
+VOID ai_toy_wheel_cancel_sync(AI_TOY_WHEEL_TIMER_T *timer)
+{
+    BOOL_T running;
+
+    ai_toy_wheel_cancel(timer);
+    if (NULL == s_wheel.mutex || NULL == timer) {
+        return;
+    }
+    do {
+        tal_mutex_lock(s_wheel.mutex);
+        running = (s_wheel.clk[WHEEL_CLK_REAL].running == timer || s_wheel.clk[WHEEL_CLK_MANUAL].running == timer);
+        tal_mutex_unlock(s_wheel.mutex);
+        if (running) {
+            tal_system_sleep(1);
+        }
+    } while (running);
+}
+
+BOOL_T ai_toy_wheel_is_armed(AI_TOY_WHEEL_TIMER_T *timer)
+{
+    return (timer && timer->pprev) ? TRUE : FALSE;
+}
+
+UINT32_T ai_toy_wheel_fired_gen(CONST AI_TOY_WHEEL_TIMER_T *timer)
+{
+    // written by the thread running the callback, just before it
+    return timer->fired_gen;
+}
+
+BOOL_T ai_toy_wheel_gen_current(AI_TOY_WHEEL_TIMER_T *timer, UINT32_T gen)
+{
+    BOOL_T current;
+
+    if (NULL == s_wheel.mutex || NULL == timer) {
+        return FALSE;
+    }
+    tal_mutex_lock(s_wheel.mutex);
+    current = (timer->gen == gen) ? TRUE : FALSE;
+    tal_mutex_unlock(s_wheel.mutex);
+    return current;
+}
+
+OPERATE_RET ai_toy_wheel_defer(UINT32_T delay_ms, AI_TOY_WHEEL_CB cb, VOID *arg)
+{
+    if (NULL == s_wheel.mutex || NULL == cb) {
+        return OPRT_INVALID_PARM;
+    }
+
+    UINT32_T now = __wheel_now_tick(WHEEL_CLK_REAL);
+
+    tal_mutex_lock(s_wheel.mutex);
+    AI_TOY_WHEEL_TIMER_T *node = s_wheel.free;
+    if (NULL == node) {
+        s_wheel.stat.full++;
+        tal_mutex_unlock(s_wheel.mutex);
+        TAL_PR_ERR("wheel full, defer %dms refused", delay_ms);
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+    s_wheel.free = node->next;
+    node->next = NULL;
+    node->cb = cb;
+    node->arg = arg;
+    node->slack = 0;
+    __wheel_insert(node, now, delay_ms);
+    s_wheel.stat.deferred++;
+    tal_mutex_unlock(s_wheel.mutex);
+
+    return OPRT_OK;
+}
+
+VOID ai_toy_wheel_stat_get(AI_TOY_WHEEL_STAT_T *stat)
+{
+    if (NULL == stat || NULL == s_wheel.mutex) {
+        return;
+    }
+    tal_mutex_lock(s_wheel.mutex);
+    *stat = s_wheel.stat;
+    tal_mutex_unlock(s_wheel.mutex);
+}
+
+VOID ai_toy_wheel_timer_manual(AI_TOY_WHEEL_TIMER_T *timer, BOOL_T manual)
+{
+    if (NULL == s_wheel.mutex || NULL == timer || timer->pooled) {
+        return;
+    }
+    tal_mutex_lock(s_wheel.mutex);
+    if (timer->pprev) {
+        __wheel_remove(timer);
+    }
+    timer->clk = manual ? WHEEL_CLK_MANUAL : WHEEL_CLK_REAL;
+    tal_mutex_unlock(s_wheel.mutex);
+}
+
+VOID ai_toy_wheel_advance(UINT32_T ms)
+{
+    ai_toy_wheel_clk_t *c = &s_wheel.clk[WHEEL_CLK_MANUAL];
+    UINT32_T target;
+
+    if (NULL == s_wheel.mutex) {
+        return;
+    }
+    tal_mutex_lock(s_wheel.mutex);
+    target = s_wheel.manual_ms + ms;
+    while (WHEEL_NEVER != c->wake && (INT32_T)(c->wake * AI_TOY_WHEEL_TICK_MS - target) <= 0) {
+        if ((INT32_T)(c->wake * AI_TOY_WHEEL_TICK_MS - s_wheel.manual_ms) > 0) {
+            s_wheel.manual_ms = c->wake * AI_TOY_WHEEL_TICK_MS;
+        }
+        tal_mutex_unlock(s_wheel.mutex);
+        __wheel_run(WHEEL_CLK_MANUAL);
+        tal_mutex_lock(s_wheel.mutex);
+    }
+    s_wheel.manual_ms = target;
+    tal_mutex_unlock(s_wheel.mutex);
+}
+
+UINT32_T ai_toy_wheel_manual_ms(VOID)
+{
+    return s_wheel.manual_ms;
+}
@@ -1,8 +1,14 @@
 #include "led_controller.h"
 #include "tal_log.h"
 #include "tal_sw_timer.h"
+#include "tal_mutex.h"
 #include "tal_gpio.h"
+#include "tal_system.h"
 #include "ws2812_spi.h"
+#include "ai_toy_wheel.h"
+#include "ai_toy_trace.h"
+#include "led_sim.h"
+#include <stdio.h>
 #include <string.h>
 
 // 颜色分量结构（RGB格式）
@@ -19,6 +25,10 @@ static const RGBColor COLOR_GREEN   = {0, 255, 0};   // 绿色
 static const RGBColor COLOR_BLUE    = {0, 0, 255};   // 蓝色
 static const RGBColor COLOR_YELLOW  = {255, 255, 0}; // 黄色
 
+// 信号强度表颜色分界（等级 <= 该值时使用对应颜色）
+#define SIGNAL_METER_WEAK_LEVEL     3   // 红色：弱信号
+#define SIGNAL_METER_FAIR_LEVEL     6   // 黄色：一般，更高为绿色
+
 // 呼吸灯亮度表（非线性变化，符合人眼感知）
 static const uint8_t BREATH_BRIGHTNESS_TABLE[BREATH_TABLE_SIZE] = {
     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,   1,   1,   1,   1,
@@ -42,9 +52,21 @@ static const uint8_t BREATH_BRIGHTNESS_TABLE[BREATH_TABLE_SIZE] = {
 // LED控制状态机结构
 typedef struct {
     LedState current_state;      // 当前状态
-    LedState pending_state;      // 等待状态（在自检过程中接收的新状态）
-    uint8_t pending_value;       // 等待状态参数
-    BOOL_T has_pending_state;    // 是否有等待状态
+    
+    // 状态请求、定时器回调和挂起/唤醒可能来自不同线程，统一由此锁串行化
+    MUTEX_HANDLE mutex;
+    
+    // 自检计时（自检为低优先级叠加层，任何非空闲状态到来即提前结束）
+    SYS_TIME_T selftest_start_ms;     // 自检开始时刻
+    LedSelftestStats selftest;
+    
+    // 低功耗挂起（SPI 关闭，动画定时器停止，状态保留）
+    BOOL_T suspended;
+    LedResumeStats resume;
+    
+    // 统计
+    UINT64_T breath_last_us;     // 上次呼吸步进时刻，0=无
+    LedStats stats;
     
     // 状态专用数据
     union {
@@ -58,14 +80,27 @@ typedef struct {
             BOOL_T is_light_on;  // 当前LED亮灭状态
             uint16_t blink_count; // 已闪烁次数
         } blink;
+        struct {
+            uint8_t id;          // 效果编号
+            uint32_t t_ms;       // 效果时间（按帧周期累加，与定时器抖动无关）
+        } effect;
     } state_data;
     
+    LedEffectCtx effect_ctx;     // 效果运行参数
+    
     // 定时器
-    TIMER_ID main_timer;   // 主定时器：处理所有状态转换和动作
+    AI_TOY_WHEEL_TIMER_T main_timer;   // 主定时器：处理所有状态转换和动作（共享时间轮）
+    uint32_t timer_gen;                // 最近一次启动/停止后的定时器代数，回调据此丢弃过期派发
 } LedController;
 
 static LedController led_ctrl;
 
+// 效果帧缓冲（R/G/B 分通道），闪烁等效果在上一帧基础上渲染
+static uint8_t s_fx_r[WS2812_LED_COUNT];
+static uint8_t s_fx_g[WS2812_LED_COUNT];
+static uint8_t s_fx_b[WS2812_LED_COUNT];
+static const LedFrame s_fx_frame = {s_fx_r, s_fx_g, s_fx_b, WS2812_LED_COUNT};
+
 // LED点亮顺序表（从LED9开始的特定顺序）
 // 索引0对应0挡（不亮），索引1对应1挡（亮LED9），以此类推
 static const uint8_t LED_LIGHT_ORDER[13] = {
@@ -84,6 +119,17 @@ static const uint8_t LED_LIGHT_ORDER[13] = {
     10    // 12挡：led10
 };
 
+// 启动/停止主定时器（持锁调用），记录代数
+static void led_timer_arm(uint32_t ms) {
+    ai_toy_wheel_arm(&led_ctrl.main_timer, ms);
+    led_ctrl.timer_gen = led_ctrl.main_timer.gen;
+}
+
+static void led_timer_cancel(void) {
+    ai_toy_wheel_cancel(&led_ctrl.main_timer);
+    led_ctrl.timer_gen = led_ctrl.main_timer.gen;
+}
+
 // 设置所有LED为同一颜色
 static void set_all_leds(const RGBColor *color) {
     ws2812_spi_set_all(color->r, color->g, color->b);
@@ -92,30 +138,105 @@ static void set_all_leds(const RGBColor *color) {
 
 // 设置等级显示（用于信号强度和音量）- 修改为新的点亮顺序
 static void set_level_leds(const RGBColor *color, uint8_t level) {
+    // 整帧先全部熄灭，再按顺序点亮，一次提交给驱动
+    uint8_t r[WS2812_LED_COUNT] = {0};
+    uint8_t g[WS2812_LED_COUNT] = {0};
+    uint8_t b[WS2812_LED_COUNT] = {0};
+    
     // 确保等级在有效范围内
     if (level > 12) {
         level = 12;
     }
     
-    // 首先关闭所有LED
-    for (int i = 0; i < WS2812_LED_COUNT; i++) {
-        ws2812_spi_set_pixel(i, COLOR_BLACK.r, COLOR_BLACK.g, COLOR_BLACK.b);
-    }
-    
     // 按照新的顺序点亮LED
     for (int i = 1; i <= level; i++) {
         uint8_t led_num = LED_LIGHT_ORDER[i];  // 获取LED编号(1-12)
         if (led_num > 0 && led_num <= WS2812_LED_COUNT) {  // 边界检查
             uint8_t led_index = led_num - 1;  // 转换为0-based索引
-            ws2812_spi_set_pixel(led_index, color->r, color->g, color->b);
+            r[led_index] = color->r;
+            g[led_index] = color->g;
+            b[led_index] = color->b;
         }
     }
     
+    ws2812_spi_set_frame(r, g, b);
     ws2812_spi_refresh();
 }
 
-// 主定时器回调：处理所有状态事件
-static void main_timer_cb(TIMER_ID timer_id, VOID_T *arg) {
+// 信号强度表：按等级选择颜色
+static void set_signal_meter_leds(uint8_t level) {
+    if (level <= SIGNAL_METER_WEAK_LEVEL) {
+        set_level_leds(&COLOR_RED, level);
+    } else if (level <= SIGNAL_METER_FAIR_LEVEL) {
+        set_level_leds(&COLOR_YELLOW, level);
+    } else {
+        set_level_leds(&COLOR_GREEN, level);
+    }
+}
+
+// 渲染当前效果的一帧并发送
+static void effect_render(void) {
+    const LedEffect *fx = led_effect_get((LedEffectId)led_ctrl.state_data.effect.id);
+    
+    if (NULL == fx) {
+        return;
+    }
+    fx->render(&s_fx_frame, led_ctrl.state_data.effect.t_ms, &led_ctrl.effect_ctx);
+    ws2812_spi_set_frame(s_fx_r, s_fx_g, s_fx_b);
+    ws2812_spi_refresh();
+}
+
+// 进入新状态并计数
+static void led_state_enter(LedState state) {
+    if (state < LED_STATE_MAX) {
+        led_ctrl.stats.transitions[state]++;
+    }
+    led_ctrl.current_state = state;
+}
+
+// 呼吸步进间隔抖动：实际间隔相对 BREATH_TIMER_INTERVAL 的偏差
+static void breath_jitter_sample(void) {
+    UINT64_T now = AI_TOY_TRACE_NOW_US();
+    
+    if (led_ctrl.breath_last_us) {
+        int32_t jitter = (int32_t)(now - led_ctrl.breath_last_us) - BREATH_TIMER_INTERVAL * 1000;
+        if (0 == led_ctrl.stats.jitter_count || jitter < led_ctrl.stats.jitter_min_us) {
+            led_ctrl.stats.jitter_min_us = jitter;
+        }
+        if (0 == led_ctrl.stats.jitter_count || jitter > led_ctrl.stats.jitter_max_us) {
+            led_ctrl.stats.jitter_max_us = jitter;
+        }
+        led_ctrl.stats.jitter_sum_us += jitter;
+        led_ctrl.stats.jitter_count++;
+    }
+    led_ctrl.breath_last_us = now;
+}
+
+// 自检结束：记录耗时并回到空闲（由调用方决定随后显示什么）
+static void selftest_end(LedState by) {
+    uint32_t elapsed = (uint32_t)(tal_system_get_millisecond() - led_ctrl.selftest_start_ms);
+    
+    led_ctrl.selftest.run_ms = elapsed;
+    led_ctrl.selftest.steps_done = led_ctrl.state_data.init.step;
+    led_ctrl.selftest.preempted_by = by;
+    led_ctrl.selftest.saved_ms = (elapsed < LED_SELFTEST_TOTAL_TIME) ? (LED_SELFTEST_TOTAL_TIME - elapsed) : 0;
+    TAL_PR_DEBUG("Self-test ended after %dms, by state %d, saved %dms",
+                 elapsed, by, led_ctrl.selftest.saved_ms);
+    
+    led_timer_cancel();
+    led_ctrl.current_state = LED_IDLE;
+}
+
+// 自检正常结束或被快速启动结束：熄灭进入空闲
+static void selftest_complete(void) {
+    selftest_end(LED_INIT);
+    led_ctrl.stats.transitions[LED_IDLE]++;
+    set_all_leds(&COLOR_BLACK);
+}
+
+// 主定时器步进：处理所有状态事件（持锁调用）
+static void main_timer_step(void) {
+    led_ctrl.stats.timer_cbs++;
     switch (led_ctrl.current_state) {
         case LED_INIT:
             // 自检状态转换：红->绿->蓝
@@ -124,41 +245,22 @@ static void main_timer_cb(TIMER_ID timer_id, VOID_T *arg) {
             if (led_ctrl.state_data.init.step == 1) {
                 // 切换到绿色
                 set_all_leds(&COLOR_GREEN);
-                tal_sw_timer_start(led_ctrl.main_timer, INIT_GREEN_TIME, TAL_TIMER_ONCE);
+                led_timer_arm(INIT_GREEN_TIME);
             } else if (led_ctrl.state_data.init.step == 2) {
                 // 切换到蓝色
                 set_all_leds(&COLOR_BLUE);
-                tal_sw_timer_start(led_ctrl.main_timer, INIT_BLUE_TIME, TAL_TIMER_ONCE);
+                led_timer_arm(INIT_BLUE_TIME);
             } else {
                 // 自检完成
                 TAL_PR_DEBUG("Init complete");
-                
-                // 进入空闲状态
-                led_ctrl.current_state = LED_IDLE;
-                
-                // 执行等待状态或进入空闲
-                if (led_ctrl.has_pending_state) {
-                    // 保存等待状态值
-                    LedState next_state = led_ctrl.pending_state;
-                    uint8_t next_value = led_ctrl.pending_value;
-                    
-                    // 重置等待状态
-                    led_ctrl.has_pending_state = FALSE;
-                    led_ctrl.pending_state = LED_IDLE;  // 清除pending_state
-                    led_ctrl.pending_value = 0;         // 清除pending_value
-                    
-                    // 直接执行新状态
-                    set_led_state(next_state, next_value);
-                } else {
-                    set_all_leds(&COLOR_BLACK);
-                }
+                selftest_complete();
             }
             break;
             
         case LED_CONFIG_SUCCESS:
         case LED_VOLUME:
             // 显示状态超时，进入空闲
-            led_ctrl.current_state = LED_IDLE;
+            led_state_enter(LED_IDLE);
             set_all_leds(&COLOR_BLACK);
             TAL_PR_DEBUG("Display timeout, entering idle state");
             break;
@@ -169,7 +271,7 @@ static void main_timer_cb(TIMER_ID timer_id, VOID_T *arg) {
                 // 当前亮 -> 切换为灭
                 set_all_leds(&COLOR_BLACK);
                 led_ctrl.state_data.blink.is_light_on = FALSE;
-                tal_sw_timer_start(led_ctrl.main_timer, DIALOG_LIGHT_OFF_TIME, TAL_TIMER_ONCE);
+                led_timer_arm(DIALOG_LIGHT_OFF_TIME);
             } else {
                 // 当前灭 -> 切换为亮
                 set_all_leds(&COLOR_BLUE);
@@ -178,11 +280,11 @@ static void main_timer_cb(TIMER_ID timer_id, VOID_T *arg) {
                 
                 // 检查是否达到总闪烁次数
                 if (led_ctrl.state_data.blink.blink_count >= DIALOG_BLINK_COUNT) {
-                    led_ctrl.current_state = LED_IDLE;
+                    led_state_enter(LED_IDLE);
                     set_all_leds(&COLOR_BLACK);
                     TAL_PR_DEBUG("Dialog blinking complete, entering idle state");
                 } else {
-                    tal_sw_timer_start(led_ctrl.main_timer, DIALOG_LIGHT_ON_TIME, TAL_TIMER_ONCE);
+                    led_timer_arm(DIALOG_LIGHT_ON_TIME);
                 }
             }
             break;
@@ -190,6 +292,8 @@ static void main_timer_cb(TIMER_ID timer_id, VOID_T *arg) {
         case LED_CONFIGURING: // 配网中（绿灯呼吸效果）
         case LED_BREATHING:   // 呼吸灯效果（蓝灯呼吸）
         {
+            breath_jitter_sample();
+            
             // 更新呼吸灯索引
             led_ctrl.state_data.breath.index++;
             
@@ -212,9 +316,15 @@ static void main_timer_cb(TIMER_ID timer_id, VOID_T *arg) {
             ws2812_spi_refresh();
             
             // 设置下一次呼吸定时
-            tal_sw_timer_start(led_ctrl.main_timer, BREATH_TIMER_INTERVAL, TAL_TIMER_ONCE);
+            led_timer_arm(BREATH_TIMER_INTERVAL);
             break;
         }
+        
+        case LED_EFFECT: // 逐像素效果：下一帧
+            led_ctrl.state_data.effect.t_ms += LED_EFFECT_INTERVAL;
+            effect_render();
+            led_timer_arm(LED_EFFECT_INTERVAL);
+            break;
             
         default:
             // 其他状态无需处理
@@ -222,10 +332,23 @@ static void main_timer_cb(TIMER_ID timer_id, VOID_T *arg) {
     }
 }
 
+// 主定时器回调
+static void main_timer_cb(VOID *arg) {
+    tal_mutex_lock(led_ctrl.mutex);
+    // 派发后、取得锁前定时器被重新启动或停止（状态切换、挂起）：这次回调已过期，丢弃
+    if (ai_toy_wheel_fired_gen(&led_ctrl.main_timer) != led_ctrl.timer_gen) {
+        led_ctrl.stats.stale_cbs++;
+    } else if (!led_ctrl.suspended) {
+        main_timer_step();
+    }
+    tal_mutex_unlock(led_ctrl.mutex);
+}
+
 // 清理当前状态资源
 static void cleanup_current_state(void) {
     // 停止主定时器
-    tal_sw_timer_stop(led_ctrl.main_timer);
+    led_timer_cancel();
+    led_ctrl.breath_last_us = 0;
     
     // 重置状态数据
     memset(&led_ctrl.state_data, 0, sizeof(led_ctrl.state_data));
@@ -237,33 +360,61 @@ void led_controller_init(void) {
     
     // 清零控制结构体
     memset(&led_ctrl, 0, sizeof(LedController));
+    if (OPRT_OK != tal_mutex_create_init(&led_ctrl.mutex)) {
+        TAL_PR_ERR("LED controller mutex create failed");
+        return;
+    }
     
     // 初始化WS2812驱动
     ws2812_app_init();
     TAL_PR_DEBUG("WS2812 driver initialized");
     
-    // 创建主定时器
-    tal_sw_timer_create(main_timer_cb, NULL, &led_ctrl.main_timer);
+    // 创建主定时器（挂在共享时间轮上，动画步进不允许延后）
+    ai_toy_wheel_init();
+    ai_toy_wheel_timer_init(&led_ctrl.main_timer, main_timer_cb, NULL, 0);
     
     TAL_PR_DEBUG("LED controller initialized");
     
+#if WS2812_BENCH
+    led_controller_bench_run();
+#endif
+#if WS2812_SIM
+    led_sim_run_default();
+#endif
+    
     // // 初始状态：上电自检
     set_led_state(LED_INIT, 0);
 }
 
-// 设置LED状态
-void set_led_state(LedState new_state, uint8_t value) {
+// 设置LED状态（持锁调用）
+static void led_state_set(LedState new_state, uint8_t value) {
     TAL_PR_DEBUG("Setting LED state: %d, value: %d", new_state, value);
     
-    // 上电自检独占处理：自检过程中接收的新状态将被缓存
-    if (led_ctrl.current_state == LED_INIT && new_state != LED_INIT) {
-        led_ctrl.pending_state = new_state;
-        led_ctrl.pending_value = value;
-        led_ctrl.has_pending_state = TRUE;
-        TAL_PR_DEBUG("Init in progress, pending state: %d", new_state);
+    // 无效请求在离开当前状态之前拒绝，当前画面和定时器保持不变
+    if (new_state >= LED_STATE_MAX) {
+        TAL_PR_ERR("Unknown LED state %d", new_state);
+        return;
+    }
+    if (new_state == LED_EFFECT && NULL == led_effect_get((LedEffectId)value)) {
+        TAL_PR_ERR("Unknown LED effect %d", value);
         return;
     }
     
+    // 记录首个状态显示的时刻（相对自检开始）
+    if (new_state != LED_INIT && new_state != LED_IDLE && 0 == led_ctrl.selftest.first_state_ms) {
+        led_ctrl.selftest.first_state_ms = (uint32_t)(tal_system_get_millisecond() - led_ctrl.selftest_start_ms);
+        led_ctrl.selftest.first_state = new_state;
+    }
+    
+    // 上电自检为低优先级叠加层：
+    // 空闲请求不打断自检（自检结束后本就是空闲），其他状态立即结束自检并显示
+    if (led_ctrl.current_state == LED_INIT && new_state != LED_INIT) {
+        if (new_state == LED_IDLE) {
+            return;
+        }
+        selftest_end(new_state);
+    }
+    
     // 如果设置相同状态且参数相同，避免重复操作
     if (led_ctrl.current_state == new_state) {
         // 对于有参数的状态，检查参数是否相同
@@ -271,21 +422,26 @@ void set_led_state(LedState new_state, uint8_t value) {
             // 对于等级显示状态，如果等级相同则重新启动定时器
             if (new_state == LED_CONFIG_SUCCESS) {
                 set_level_leds(&COLOR_GREEN, value);
-                tal_sw_timer_stop(led_ctrl.main_timer);
-                tal_sw_timer_start(led_ctrl.main_timer, CONFIG_SUCCESS_TIMEOUT, TAL_TIMER_ONCE);
+                led_timer_arm(CONFIG_SUCCESS_TIMEOUT);
             } else if (new_state == LED_VOLUME) {
                 set_level_leds(&COLOR_YELLOW, value);
-                tal_sw_timer_stop(led_ctrl.main_timer);
-                tal_sw_timer_start(led_ctrl.main_timer, VOLUME_DISPLAY_TIMEOUT, TAL_TIMER_ONCE);
+                led_timer_arm(VOLUME_DISPLAY_TIMEOUT);
             }
             return;
         } else if (new_state == LED_IDLE) {
             // IDLE状态需要确保所有LED都关闭，不能跳过
             set_all_leds(&COLOR_BLACK);
             return;
+        } else if (new_state == LED_SIGNAL_METER) {
+            // 信号强度表：只刷新等级，无定时器
+            set_signal_meter_leds(value);
+            return;
         } else if (new_state == LED_NET_ERROR) {
             // 网络错误状态重复设置时不需要额外操作
             return;
+        } else if (new_state == LED_EFFECT && value == led_ctrl.state_data.effect.id) {
+            // 同一效果继续播放，不从头开始
+            return;
         }
         // 其他状态如呼吸灯等需要重新初始化
     }
@@ -296,9 +452,11 @@ void set_led_state(LedState new_state, uint8_t value) {
     // 执行新状态
     switch (new_state) {
         case LED_INIT: // 上电自检（红->绿->蓝）
+            memset(&led_ctrl.selftest, 0, sizeof(led_ctrl.selftest));
+            led_ctrl.selftest_start_ms = tal_system_get_millisecond();
             set_all_leds(&COLOR_RED);
             led_ctrl.state_data.init.step = 0;
-            tal_sw_timer_start(led_ctrl.main_timer, INIT_RED_TIME, TAL_TIMER_ONCE);
+            led_timer_arm(INIT_RED_TIME);
             break;
             
         case LED_IDLE: // 空闲状态（所有LED熄灭）
@@ -307,12 +465,13 @@ void set_led_state(LedState new_state, uint8_t value) {
             
         case LED_CONFIGURING: // 配网中（绿灯呼吸效果）
             led_ctrl.state_data.breath.index = 0;
-            tal_sw_timer_start(led_ctrl.main_timer, BREATH_TIMER_INTERVAL, TAL_TIMER_ONCE);
+            led_timer_arm(BREATH_TIMER_INTERVAL);
+            led_ctrl.breath_last_us = AI_TOY_TRACE_NOW_US();
             break;
             
         case LED_CONFIG_SUCCESS: // 配网成功（显示WIFI信号强度）
             set_level_leds(&COLOR_GREEN, value);
-            tal_sw_timer_start(led_ctrl.main_timer, CONFIG_SUCCESS_TIMEOUT, TAL_TIMER_ONCE);
+            led_timer_arm(CONFIG_SUCCESS_TIMEOUT);
             break;
             
         case LED_NET_ERROR: // 网络异常（红灯常亮）
@@ -323,20 +482,377 @@ void set_led_state(LedState new_state, uint8_t value) {
             set_all_leds(&COLOR_BLUE);
             led_ctrl.state_data.blink.is_light_on = TRUE;
             led_ctrl.state_data.blink.blink_count = 0;
-            tal_sw_timer_start(led_ctrl.main_timer, DIALOG_LIGHT_ON_TIME, TAL_TIMER_ONCE);
+            led_timer_arm(DIALOG_LIGHT_ON_TIME);
             break;
             
         case LED_VOLUME: // 音量调节（黄灯等级显示）
             set_level_leds(&COLOR_YELLOW, value);
-            tal_sw_timer_start(led_ctrl.main_timer, VOLUME_DISPLAY_TIMEOUT, TAL_TIMER_ONCE);
+            led_timer_arm(VOLUME_DISPLAY_TIMEOUT);
             break;
             
         case LED_BREATHING: // 呼吸灯效果（蓝灯呼吸）
             led_ctrl.state_data.breath.index = 0;
-            tal_sw_timer_start(led_ctrl.main_timer, BREATH_TIMER_INTERVAL, TAL_TIMER_ONCE);
+            led_timer_arm(BREATH_TIMER_INTERVAL);
+            led_ctrl.breath_last_us = AI_TOY_TRACE_NOW_US();
+            break;
+            
+        case LED_SIGNAL_METER: // 信号强度表（实时等级显示，由采样方刷新）
+            set_signal_meter_leds(value);
+            break;
+            
+        case LED_EFFECT: // 逐像素效果（从黑帧开始）
+            memset(s_fx_r, 0, sizeof(s_fx_r));
+            memset(s_fx_g, 0, sizeof(s_fx_g));
+            memset(s_fx_b, 0, sizeof(s_fx_b));
+            led_effect_ctx_init(&led_ctrl.effect_ctx, (LedEffectId)value, 255);
+            led_ctrl.state_data.effect.id = value;
+            led_ctrl.state_data.effect.t_ms = 0;
+            effect_render();
+            led_timer_arm(LED_EFFECT_INTERVAL);
             break;
+            
+        default:
+            return;
     }
     
     // 更新当前状态
-    led_ctrl.current_state = new_state;
-}
\ No newline at end of file
+    led_state_enter(new_state);
+    
+    // 挂起期间只记录最终画面，动画在唤醒时继续，不唤醒 CPU
+    if (led_ctrl.suspended) {
+        led_timer_cancel();
+    }
+}
+
+// 设置LED状态
+void set_led_state(LedState new_state, uint8_t value) {
+    tal_mutex_lock(led_ctrl.mutex);
+    led_state_set(new_state, value);
+    tal_mutex_unlock(led_ctrl.mutex);
+}
+
+// 立即结束上电自检（快速启动）
+void led_controller_selftest_finish(void) {
+    tal_mutex_lock(led_ctrl.mutex);
+    if (led_ctrl.current_state == LED_INIT) {
+        TAL_PR_DEBUG("Init cut short at step %d", led_ctrl.state_data.init.step);
+        selftest_complete();
+        cleanup_current_state();
+    }
+    tal_mutex_unlock(led_ctrl.mutex);
+}
+
+// 获取上电自检计时
+void led_controller_selftest_stats_get(LedSelftestStats *stats) {
+    if (stats) {
+        *stats = led_ctrl.selftest;
+    }
+}
+
+// 唤醒后按当前状态重新启动动画/超时定时器
+static void resume_state_timer(void) {
+    switch (led_ctrl.current_state) {
+        case LED_INIT:
+            led_timer_arm((0 == led_ctrl.state_data.init.step) ? INIT_RED_TIME :
+                             (1 == led_ctrl.state_data.init.step) ? INIT_GREEN_TIME : INIT_BLUE_TIME);
+            break;
+        case LED_CONFIG_SUCCESS:
+            led_timer_arm(CONFIG_SUCCESS_TIMEOUT);
+            break;
+        case LED_VOLUME:
+            led_timer_arm(VOLUME_DISPLAY_TIMEOUT);
+            break;
+        case LED_DIALOG:
+            led_timer_arm(led_ctrl.state_data.blink.is_light_on ?
+                             DIALOG_LIGHT_ON_TIME : DIALOG_LIGHT_OFF_TIME);
+            break;
+        case LED_CONFIGURING:
+        case LED_BREATHING:
+            led_timer_arm(BREATH_TIMER_INTERVAL);
+            led_ctrl.breath_last_us = AI_TOY_TRACE_NOW_US();
+            break;
+        case LED_EFFECT:
+            led_timer_arm(LED_EFFECT_INTERVAL);
+            break;
+        default:
+            // 静态显示，无定时器
+            break;
+    }
+}
+
+// 低功耗挂起
+void led_controller_suspend(void) {
+    tal_mutex_lock(led_ctrl.mutex);
+    if (led_ctrl.suspended) {
+        tal_mutex_unlock(led_ctrl.mutex);
+        return;
+    }
+    led_timer_cancel();
+    if (OPRT_OK != ws2812_spi_suspend()) {
+        TAL_PR_ERR("LED suspend failed");
+        resume_state_timer();
+        tal_mutex_unlock(led_ctrl.mutex);
+        return;
+    }
+    led_ctrl.suspended = TRUE;
+    TAL_PR_DEBUG("LED suspended in state %d", led_ctrl.current_state);
+    tal_mutex_unlock(led_ctrl.mutex);
+}
+
+// 唤醒并恢复最后一帧
+void led_controller_resume(void) {
+    tal_mutex_lock(led_ctrl.mutex);
+    if (!led_ctrl.suspended) {
+        tal_mutex_unlock(led_ctrl.mutex);
+        return;
+    }
+    SYS_TIME_T start = tal_system_get_millisecond();
+    OPERATE_RET rt = ws2812_spi_resume();
+    uint32_t elapsed = (uint32_t)(tal_system_get_millisecond() - start);
+    if (OPRT_OK != rt) {
+        TAL_PR_ERR("LED resume failed: %d", rt);
+        tal_mutex_unlock(led_ctrl.mutex);
+        return;
+    }
+    led_ctrl.suspended = FALSE;
+
+    led_ctrl.resume.last_ms = elapsed;
+    if (elapsed > led_ctrl.resume.max_ms) {
+        led_ctrl.resume.max_ms = elapsed;
+    }
+    led_ctrl.resume.count++;
+    TAL_PR_DEBUG("LED restored in %u ms (max %u)", elapsed, led_ctrl.resume.max_ms);
+
+    resume_state_timer();
+    tal_mutex_unlock(led_ctrl.mutex);
+}
+
+// 状态定时器切换时间轮手动时钟
+void led_controller_clock_manual(BOOL_T manual) {
+    tal_mutex_lock(led_ctrl.mutex);
+    ai_toy_wheel_timer_manual(&led_ctrl.main_timer, manual);
+    tal_mutex_unlock(led_ctrl.mutex);
+}
+
+// 获取唤醒恢复耗时
+void led_controller_resume_stats_get(LedResumeStats *stats) {
+    if (stats) {
+        *stats = led_ctrl.resume;
+    }
+}
+
+// 获取LED控制器及驱动统计
+void led_controller_stats_get(LedStats *stats) {
+    if (stats) {
+        tal_mutex_lock(led_ctrl.mutex);
+        *stats = led_ctrl.stats;
+        ws2812_spi_stats_get(&stats->drv);
+        tal_mutex_unlock(led_ctrl.mutex);
+    }
+}
+
+// 清零统计
+void led_controller_stats_reset(void) {
+    tal_mutex_lock(led_ctrl.mutex);
+    memset(&led_ctrl.stats, 0, sizeof(led_ctrl.stats));
+    ws2812_spi_stats_reset();
+    tal_mutex_unlock(led_ctrl.mutex);
+}
+
+static uint32_t time_stat_avg(const Ws2812TimeStat *st) {
+    return st->count ? (uint32_t)(st->sum_us / st->count) : 0;
+}
+
+// 日志输出统计
+void led_controller_stats_dump(void) {
+    LedStats st;
+    
+    led_controller_stats_get(&st);
+    TAL_PR_NOTICE("led frames: encoded %u sent %u skipped %u errors %u, pixels changed %u unchanged %u",
+                  st.drv.frames_encoded, st.drv.frames_sent, st.drv.frames_skipped, st.drv.send_errors,
+                  st.drv.pixels_encoded, st.drv.pixels_unchanged);
+    TAL_PR_NOTICE("led encode us min %u avg %u max %u, send us min %u avg %u max %u",
+                  st.drv.encode.min_us, time_stat_avg(&st.drv.encode), st.drv.encode.max_us,
+                  st.drv.send.min_us, time_stat_avg(&st.drv.send), st.drv.send.max_us);
+    TAL_PR_NOTICE("led timer cbs %u stale %u, breath jitter us min %d avg %d max %d over %u steps",
+                  st.timer_cbs, st.stale_cbs, st.jitter_min_us,
+                  st.jitter_count ? (int32_t)(st.jitter_sum_us / st.jitter_count) : 0,
+                  st.jitter_max_us, st.jitter_count);
+    for (int i = 0; i < LED_STATE_MAX; i++) {
+        if (st.transitions[i]) {
+            TAL_PR_NOTICE("led state %d entered %u times", i, st.transitions[i]);
+        }
+    }
+}
+
+// 统计格式化为紧凑 JSON
+int led_controller_stats_json(char *buf, uint32_t size) {
+    LedStats st;
+    int off = 0;
+    
+    if (NULL == buf || 0 == size) {
+        return 0;
+    }
+    led_controller_stats_get(&st);
+    off += snprintf(buf + off, size - off, "{\"frm\":[%u,%u,%u,%u],\"enc\":[%u,%u,%u],\"spi\":[%u,%u,%u],"
+                    "\"jit\":[%d,%d,%d],\"st\":[",
+                    st.drv.frames_encoded, st.drv.frames_sent, st.drv.frames_skipped, st.drv.send_errors,
+                    st.drv.encode.min_us, time_stat_avg(&st.drv.encode), st.drv.encode.max_us,
+                    st.drv.send.min_us, time_stat_avg(&st.drv.send), st.drv.send.max_us,
+                    st.jitter_min_us, st.jitter_count ? (int32_t)(st.jitter_sum_us / st.jitter_count) : 0,
+                    st.jitter_max_us);
+    for (int i = 0; i < LED_STATE_MAX && off < (int)size; i++) {
+        off += snprintf(buf + off, size - off, "%s%u", i ? "," : "", st.transitions[i]);
+    }
+    if (off < (int)size) {
+        off += snprintf(buf + off, size - off, "]}");
+    }
+    return (off < (int)size) ? off : -1;
+}
+
+#if WS2812_BENCH
+// -------------------- 性能基准 --------------------
+
+#define BENCH_ITERS     12000           // 单像素操作每批次数
+#define BENCH_SIM_MS    (60 * 1000)     // 每个状态模拟运行时长
+
+static uint32_t s_bench_bytes;
+static uint32_t s_bench_frames;
+
+// 发送钩子：只计数，不占用 SPI，测得的是纯 CPU 开销
+static OPERATE_RET bench_tx(const UCHAR_T *buf, UINT32_T len) {
+    s_bench_bytes += len;
+    s_bench_frames++;
+    return OPRT_OK;
+}
+
+static void bench_report(const char *name, uint32_t iters, UINT64_T start) {
+    uint32_t us = (uint32_t)(AI_TOY_TRACE_NOW_US() - start);
+    WS2812_BENCH_PRINT("{\"case\":\"%s\",\"iters\":%u,\"us\":%u,\"ns_op\":%u,\"frames\":%u,\"bytes\":%u}",
+                       name, iters, us, (uint32_t)((UINT64_T)us * 1000 / iters), s_bench_frames, s_bench_bytes);
+    s_bench_bytes = 0;
+    s_bench_frames = 0;
+}
+
+// 逐像素效果：每帧渲染加整帧编码的耗时随灯珠数的变化（12~1024），不经驱动
+static void bench_effects(void) {
+    static const uint16_t counts[] = {12, 64, 256, 1024};
+    LedEffectCtx ctx;
+    
+    for (uint32_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        uint16_t n = counts[c];
+        uint32_t batch = 24576 / n;
+        uint8_t *mem = malloc((size_t)n * (3 + 24));  // R/G/B 三个通道 + 编码缓冲
+        if (NULL == mem) {
+            WS2812_BENCH_PRINT("{\"case\":\"effect\",\"leds\":%u,\"err\":\"nomem\"}", n);
+            continue;
+        }
+        LedFrame fb = {mem, mem + n, mem + 2 * n, n};
+        UCHAR_T *enc = mem + 3 * n;
+        
+        for (int id = 0; id < LED_EFFECT_MAX; id++) {
+            const LedEffect *fx = led_effect_get((LedEffectId)id);
+            memset(mem, 0, (size_t)n * 3);
+            led_effect_ctx_init(&ctx, (LedEffectId)id, 255);
+            uint32_t iters = 0;
+            UINT64_T start = AI_TOY_TRACE_NOW_US();
+            do {
+                for (uint32_t i = 0; i < batch; i++, iters++) {
+                    fx->render(&fb, iters * LED_EFFECT_INTERVAL, &ctx);
+                    ws2812_spi_encode_frame(enc, fb.r, fb.g, fb.b, n);
+                }
+            } while (AI_TOY_TRACE_NOW_US() - start < WS2812_BENCH_MIN_US);
+            uint32_t us = (uint32_t)(AI_TOY_TRACE_NOW_US() - start);
+            WS2812_BENCH_PRINT("{\"case\":\"effect\",\"effect\":\"%s\",\"leds\":%u,\"iters\":%u,\"us\":%u,"
+                               "\"ns_frame\":%u,\"ns_led\":%u}",
+                               fx->name, n, iters, us, (uint32_t)((UINT64_T)us * 1000 / iters),
+                               (uint32_t)((UINT64_T)us * 1000 / ((UINT64_T)iters * n)));
+        }
+        free(mem);
+    }
+}
+
+// 运行全部基准；状态模拟使用时间轮手动时钟，一分钟在几毫秒内跑完
+void led_controller_bench_run(void) {
+    UINT64_T start;
+    uint32_t n;
+    LedStats st;
+    
+    ws2812_spi_tx_hook_set(bench_tx);
+    s_bench_bytes = 0;
+    s_bench_frames = 0;
+#ifdef USER_SW_VER
+    WS2812_BENCH_PRINT("{\"case\":\"meta\",\"fw\":\"%s\",\"leds\":%d}", USER_SW_VER, WS2812_LED_COUNT);
+#else
+    WS2812_BENCH_PRINT("{\"case\":\"meta\",\"leds\":%d}", WS2812_LED_COUNT);
+#endif
+    
+    // 单像素，每次颜色都变化（需要重新编码）
+    n = 0;
+    start = AI_TOY_TRACE_NOW_US();
+    do {
+        for (uint32_t i = 0; i < BENCH_ITERS; i++, n++) {
+            ws2812_spi_set_pixel(n % WS2812_LED_COUNT, (UCHAR_T)n, (UCHAR_T)(n >> 4), 0);
+        }
+    } while (AI_TOY_TRACE_NOW_US() - start < WS2812_BENCH_MIN_US);
+    bench_report("set_pixel", n, start);
+    
+    // 单像素，颜色不变（只比较影子帧）
+    n = 0;
+    start = AI_TOY_TRACE_NOW_US();
+    do {
+        for (uint32_t i = 0; i < BENCH_ITERS; i++, n++) {
+            ws2812_spi_set_pixel(n % WS2812_LED_COUNT, 1, 2, 3);
+        }
+    } while (AI_TOY_TRACE_NOW_US() - start < WS2812_BENCH_MIN_US);
+    bench_report("set_pixel_same", n, start);
+    
+    // 整帧同色
+    n = 0;
+    start = AI_TOY_TRACE_NOW_US();
+    do {
+        for (uint32_t i = 0; i < BENCH_ITERS / WS2812_LED_COUNT; i++, n++) {
+            ws2812_spi_set_all((UCHAR_T)n, 0, (UCHAR_T)(n >> 1));
+        }
+    } while (AI_TOY_TRACE_NOW_US() - start < WS2812_BENCH_MIN_US);
+    bench_report("set_all", n, start);
+    
+    // 整帧编码随灯珠数的变化
+    ws2812_spi_bench_encode();
+    
+    // 逐像素效果随灯珠数的变化
+    bench_effects();
+    
+    // 等级显示（含刷新）
+    n = 0;
+    start = AI_TOY_TRACE_NOW_US();
+    do {
+        for (uint32_t i = 0; i < BENCH_ITERS / WS2812_LED_COUNT; i++, n++) {
+            set_level_leds((n & 1) ? &COLOR_GREEN : &COLOR_YELLOW, n % 13);
+        }
+    } while (AI_TOY_TRACE_NOW_US() - start < WS2812_BENCH_MIN_US);
+    bench_report("set_level_leds", n, start);
+    
+    // 每个状态模拟一分钟：定时器回调次数、发送帧数和字节数；
+    // 只有 LED 状态定时器走手动时钟，其他时间轮用户照常按真实时间触发
+    led_controller_clock_manual(TRUE);
+    for (int state = 0; state < LED_STATE_MAX; state++) {
+        led_controller_stats_reset();
+        s_bench_bytes = 0;
+        s_bench_frames = 0;
+        start = AI_TOY_TRACE_NOW_US();
+        set_led_state((LedState)state, (LED_EFFECT == state) ? LED_EFFECT_RAINBOW : 6);
+        ai_toy_wheel_advance(BENCH_SIM_MS);
+        uint32_t us = (uint32_t)(AI_TOY_TRACE_NOW_US() - start);
+        led_controller_stats_get(&st);
+        WS2812_BENCH_PRINT("{\"case\":\"state\",\"state\":%d,\"sim_ms\":%u,\"us\":%u,\"timer_cbs\":%u,"
+                           "\"frames\":%u,\"skipped\":%u,\"bytes\":%u}",
+                           state, BENCH_SIM_MS, us, st.timer_cbs, s_bench_frames, st.drv.frames_skipped, s_bench_bytes);
+        set_led_state(LED_IDLE, 0);
+    }
+    led_controller_clock_manual(FALSE);
+    
+    led_controller_stats_reset();
+    ws2812_spi_tx_hook_set(NULL);
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "led_effect.h"
+#include <string.h>
+
+/**
+ * 每个效果拆成若干“单通道”内核：输入整条通道数组和几个标量，逐像素只做
+ * 整数乘加和比较选择，没有查表、函数调用和分支，编译器可按 SIMD 宽度展开
+ * （同一内核分别用于 R/G/B）。通道之间的差别只在标量参数里。
+ */
+
+#define EFFECT_RNG_SEED     0x2545F491u
+
+static const LedEffect EFFECTS[LED_EFFECT_MAX] = {
+    [LED_EFFECT_RAINBOW] = {"rainbow", led_effect_rainbow, 255, 255, 255},
+    [LED_EFFECT_COMET]   = {"comet",   led_effect_comet,   0,   64,  255},
+    [LED_EFFECT_CHASE]   = {"chase",   led_effect_chase,   255, 160, 0},
+    [LED_EFFECT_SPARKLE] = {"sparkle", led_effect_sparkle, 255, 255, 255},
+};
+
+// 主色按整体亮度缩放
+static inline uint8_t scale8(uint8_t c, uint8_t level) {
+    return (uint8_t)(((uint16_t)c * level) >> 8);
+}
+
+// -------------------- 单通道内核 --------------------
+
+// 三角波色轮：相位 8.8 定点，每像素前进 step，峰值约 254
+static void channel_wheel(uint8_t *restrict dst, uint16_t n, uint32_t phase, uint32_t step, uint8_t level) {
+    for (uint16_t i = 0; i < n; i++) {
+        uint8_t x = (uint8_t)((phase + (uint32_t)i * step) >> 8);
+        uint16_t v = (x < 128) ? (uint16_t)(x * 2) : (uint16_t)((255 - x) * 2);
+        dst[i] = (uint8_t)((v * level) >> 8);
+    }
+}
+
+// 彗星：距头部 d 颗（逆向环绕）的亮度从 255 线性降到 0，inv = 255*256/tail
+static void channel_comet(uint8_t *restrict dst, uint16_t n, int32_t head, int32_t tail, uint32_t inv, uint8_t c) {
+    for (uint16_t i = 0; i < n; i++) {
+        int32_t d = head - (int32_t)i;
+        d += (d < 0) ? n : 0;
+        uint32_t v = (d < tail) ? ((uint32_t)(tail - d) * inv) >> 8 : 0;
+        dst[i] = (uint8_t)((v * c) >> 8);
+    }
+}
+
+// 跑马灯：间隔为编译期常量，取模可化为乘法
+static void channel_chase(uint8_t *restrict dst, uint16_t n, uint16_t offset, uint8_t c) {
+    for (uint16_t i = 0; i < n; i++) {
+        dst[i] = ((uint16_t)(i + offset) % LED_EFFECT_CHASE_SPACING == 0) ? c : 0;
+    }
+}
+
+// 整条通道按系数衰减
+static void channel_fade(uint8_t *restrict dst, uint16_t n, uint16_t fade) {
+    for (uint16_t i = 0; i < n; i++) {
+        dst[i] = (uint8_t)((dst[i] * fade) >> 8);
+    }
+}
+
+static uint32_t effect_rand(LedEffectCtx *ctx) {
+    uint32_t x = ctx->rng ? ctx->rng : EFFECT_RNG_SEED;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    ctx->rng = x;
+    return x;
+}
+
+// -------------------- 效果 --------------------
+
+void led_effect_rainbow(const LedFrame *fb, uint32_t t_ms, LedEffectCtx *ctx) {
+    uint32_t phase = (uint32_t)(((UINT64_T)t_ms << 16) / LED_EFFECT_RAINBOW_CYCLE_MS);
+    uint32_t step = 65536 / fb->count;
+
+    channel_wheel(fb->r, fb->count, phase, step, ctx->level);
+    channel_wheel(fb->g, fb->count, phase + (85 << 8), step, ctx->level);
+    channel_wheel(fb->b, fb->count, phase + (170 << 8), step, ctx->level);
+}
+
+void led_effect_comet(const LedFrame *fb, uint32_t t_ms, LedEffectCtx *ctx) {
+    int32_t head = (int32_t)(((UINT64_T)(t_ms % LED_EFFECT_COMET_CYCLE_MS) * fb->count) / LED_EFFECT_COMET_CYCLE_MS);
+    int32_t tail = MAX(fb->count / LED_EFFECT_COMET_TAIL_DIV, 1);
+    uint32_t inv = (255 * 256) / (uint32_t)tail;
+
+    channel_comet(fb->r, fb->count, head, tail, inv, scale8(ctx->r, ctx->level));
+    channel_comet(fb->g, fb->count, head, tail, inv, scale8(ctx->g, ctx->level));
+    channel_comet(fb->b, fb->count, head, tail, inv, scale8(ctx->b, ctx->level));
+}
+
+void led_effect_chase(const LedFrame *fb, uint32_t t_ms, LedEffectCtx *ctx) {
+    // 偏移递减，亮点沿索引增大方向前进
+    uint16_t step = (uint16_t)((t_ms / LED_EFFECT_CHASE_STEP_MS) % LED_EFFECT_CHASE_SPACING);
+    uint16_t offset = (uint16_t)((LED_EFFECT_CHASE_SPACING - step) % LED_EFFECT_CHASE_SPACING);
+
+    channel_chase(fb->r, fb->count, offset, scale8(ctx->r, ctx->level));
+    channel_chase(fb->g, fb->count, offset, scale8(ctx->g, ctx->level));
+    channel_chase(fb->b, fb->count, offset, scale8(ctx->b, ctx->level));
+}
+
+void led_effect_sparkle(const LedFrame *fb, uint32_t t_ms, LedEffectCtx *ctx) {
+    uint16_t spawn = MAX(fb->count / LED_EFFECT_SPARKLE_DIV, 1);
+
+    (void)t_ms;
+    channel_fade(fb->r, fb->count, LED_EFFECT_SPARKLE_FADE);
+    channel_fade(fb->g, fb->count, LED_EFFECT_SPARKLE_FADE);
+    channel_fade(fb->b, fb->count, LED_EFFECT_SPARKLE_FADE);
+
+    // 新闪点只有几个，逐个写入
+    for (uint16_t k = 0; k < spawn; k++) {
+        uint16_t i = (uint16_t)(effect_rand(ctx) % fb->count);
+        fb->r[i] = scale8(ctx->r, ctx->level);
+        fb->g[i] = scale8(ctx->g, ctx->level);
+        fb->b[i] = scale8(ctx->b, ctx->level);
+    }
+}
+
+// 获取效果描述
+const LedEffect *led_effect_get(LedEffectId id) {
+    if ((unsigned)id >= LED_EFFECT_MAX) {
+        return NULL;
+    }
+    return &EFFECTS[id];
+}
+
+// 按默认主色初始化运行参数
+void led_effect_ctx_init(LedEffectCtx *ctx, LedEffectId id, uint8_t level) {
+    const LedEffect *fx = led_effect_get(id);
+
+    memset(ctx, 0, sizeof(LedEffectCtx));
+    if (fx) {
+        ctx->r = fx->r;
+        ctx->g = fx->g;
+        ctx->b = fx->b;
+    }
+    ctx->level = level;
+    ctx->rng = EFFECT_RNG_SEED;
+}
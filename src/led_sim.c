@@ -0,0 +1,154 @@
+#include "led_sim.h"
+#include "ai_toy_wheel.h"
+#include "ai_toy_trace.h"
+#include "tal_log.h"
+#include <stdio.h>
+#include <string.h>
+
+#if WS2812_SIM
+
+#define LED_SIM_LINE_SIZE   (24 + WS2812_LED_COUNT * 7)
+
+// 当前脚本段的统计
+typedef struct {
+    uint32_t frames;
+    uint32_t last_ms;       // 上一帧虚拟时刻
+    uint32_t min_gap;       // 帧间隔只在不同时刻的帧之间统计
+    uint32_t max_gap;
+    uint32_t same_ms;       // 与上一帧同一时刻发出的帧（同一次定时器步进或状态设置里连发）
+    uint32_t cbs_base;      // 本段开始时的定时器回调数
+    uint32_t bad_bytes;     // 既不是 WS2812_0 也不是 WS2812_1 的编码字节
+} LedSimSeg;
+
+static struct {
+    uint32_t start_ms;      // 仿真开始的虚拟时刻
+    uint32_t frame;
+    LedSimSeg seg;
+} s_sim;
+
+// 将 24 字节编码还原为一个颜色分量字节序列（GRB）
+static uint32_t sim_decode_pixel(const UCHAR_T *buf, uint32_t *bad) {
+    uint32_t grb = 0;
+    
+    for (int bit = 0; bit < 24; bit++) {
+        grb <<= 1;
+        if (buf[bit] == WS2812_1) {
+            grb |= 1;
+        } else if (buf[bit] != WS2812_0) {
+            (*bad)++;
+        }
+    }
+    // GRB -> RGB
+    return ((grb & 0x00FF00) << 8) | ((grb & 0xFF0000) >> 8) | (grb & 0x0000FF);
+}
+
+// 发送钩子：解码并输出一行时间线
+static OPERATE_RET sim_tx(const UCHAR_T *buf, UINT32_T len) {
+    char line[LED_SIM_LINE_SIZE];
+    uint32_t now = ai_toy_wheel_manual_ms() - s_sim.start_ms;
+    int off = snprintf(line, sizeof(line), "%u,%u", now, s_sim.frame);
+    
+    for (uint32_t i = 0; i + 24 <= len && off < (int)sizeof(line); i += 24) {
+        off += snprintf(line + off, sizeof(line) - off, ",%06X", sim_decode_pixel(buf + i, &s_sim.seg.bad_bytes));
+    }
+    TAL_PR_NOTICE("LEDSIM %s", line);
+    
+    if (s_sim.seg.frames) {
+        uint32_t gap = now - s_sim.seg.last_ms;
+        if (0 == gap) {
+            s_sim.seg.same_ms++;
+        } else {
+            if (0 == s_sim.seg.min_gap || gap < s_sim.seg.min_gap) {
+                s_sim.seg.min_gap = gap;
+            }
+            if (gap > s_sim.seg.max_gap) {
+                s_sim.seg.max_gap = gap;
+            }
+        }
+    }
+    s_sim.seg.last_ms = now;
+    s_sim.seg.frames++;
+    s_sim.frame++;
+    return OPRT_OK;
+}
+
+// 本段开始：记下定时器回调数，段内步数按差值计
+static void sim_seg_begin(void) {
+    LedStats st;
+    
+    led_controller_stats_get(&st);
+    memset(&s_sim.seg, 0, sizeof(s_sim.seg));
+    s_sim.seg.cbs_base = st.timer_cbs;
+}
+
+static void sim_seg_report(uint32_t idx, const LedSimStep *step, uint32_t t1) {
+    LedStats st;
+    
+    led_controller_stats_get(&st);
+    TAL_PR_NOTICE("LEDSIM {\"seg\":%u,\"state\":%d,\"value\":%u,\"t0\":%u,\"t1\":%u,\"frames\":%u,"
+                  "\"steps\":%u,\"same_ms\":%u,\"min_gap\":%u,\"max_gap\":%u,\"bad_bytes\":%u}",
+                  idx, step->state, step->value, step->at_ms, t1, s_sim.seg.frames,
+                  st.timer_cbs - s_sim.seg.cbs_base, s_sim.seg.same_ms,
+                  s_sim.seg.min_gap, s_sim.seg.max_gap, s_sim.seg.bad_bytes);
+}
+
+OPERATE_RET led_sim_run(const LedSimStep *script, uint32_t steps, uint32_t duration_ms) {
+    char head[LED_SIM_LINE_SIZE];
+    UINT64_T start_us = AI_TOY_TRACE_NOW_US();
+    
+    if (NULL == script || 0 == steps || script[steps - 1].at_ms > duration_ms) {
+        return OPRT_INVALID_PARM;
+    }
+    
+    int off = snprintf(head, sizeof(head), "t_ms,frame");
+    for (int i = 1; i <= WS2812_LED_COUNT && off < (int)sizeof(head); i++) {
+        off += snprintf(head + off, sizeof(head) - off, ",led%d", i);
+    }
+    TAL_PR_NOTICE("LEDSIM %s", head);
+    
+    memset(&s_sim, 0, sizeof(s_sim));
+    led_controller_clock_manual(TRUE);
+    ws2812_spi_tx_hook_set(sim_tx);
+    s_sim.start_ms = ai_toy_wheel_manual_ms();
+    
+    for (uint32_t i = 0; i < steps; i++) {
+        uint32_t t1 = (i + 1 < steps) ? script[i + 1].at_ms : duration_ms;
+        uint32_t now = ai_toy_wheel_manual_ms() - s_sim.start_ms;
+        
+        sim_seg_begin();
+        if (script[i].at_ms > now) {
+            ai_toy_wheel_advance(script[i].at_ms - now);
+        }
+        set_led_state(script[i].state, script[i].value);
+        now = ai_toy_wheel_manual_ms() - s_sim.start_ms;
+        if (t1 > now) {
+            ai_toy_wheel_advance(t1 - now);
+        }
+        sim_seg_report(i, &script[i], t1);
+    }
+    
+    set_led_state(LED_IDLE, 0);
+    ws2812_spi_tx_hook_set(NULL);
+    led_controller_clock_manual(FALSE);
+    TAL_PR_NOTICE("LEDSIM {\"sim_ms\":%u,\"frames\":%u,\"us\":%u}", duration_ms, s_sim.frame,
+                  (uint32_t)(AI_TOY_TRACE_NOW_US() - start_us));
+    return OPRT_OK;
+}
+
+OPERATE_RET led_sim_run_default(void) {
+    static const LedSimStep script[] = {
+        {0,     LED_INIT,           0},
+        {3500,  LED_CONFIGURING,    0},
+        {9000,  LED_CONFIG_SUCCESS, 8},
+        {12000, LED_DIALOG,         0},
+        {18000, LED_BREATHING,      0},
+        {24000, LED_VOLUME,         5},
+        {25000, LED_VOLUME,         6},
+        {28000, LED_NET_ERROR,      0},
+        {29000, LED_IDLE,           0},
+    };
+    
+    return led_sim_run(script, sizeof(script) / sizeof(script[0]), 30000);
+}
+
+#endif
@@ -39,15 +39,40 @@
 #endif
 
 #include "led_controller.h"
+#include "ai_toy_alert_cache.h"
+#include "ai_toy_trace.h"
+#include "ai_toy_latency.h"
+#include "ai_toy_evq.h"
+#include "ai_toy_netstat.h"
+#include "ai_toy_wheel.h"
+#include "ai_toy_settings.h"
+#include "ai_toy_power.h"
+#include "ai_toy_wake.h"
+#include "ai_toy_evtrace.h"
+#include "ai_toy_boot.h"
+#include "ai_toy_text.h"
+#include "ai_toy_fsm.h"
 
-#define AI_TOY_PARA                     "ai_toy_para"
 #define LONG_KEY_TIME                   400
-#define TOY_IDLE_TIMEOUT               (30 * 1000)      // 30sec
-#define TOY_DEEPSLEEP_TIMEOUT          (10 * 60 * 1000)      // 10min
+#define TOY_IDLE_TIMEOUT               (30 * 1000)      // 30sec, default and cap of the learned listen timeout
+#define TOY_DEEPSLEEP_TIMEOUT          (10 * 60 * 1000)      // 10min, default and cap of the learned lowpower timeout
+#define TOY_CONNECTED_ALERT_DELAY      500              // ms, connected prompt after the LED signal display
+#define TOY_WAKEUP_SETTLE_DELAY        200              // ms, wakeup gpio settle before deep sleep
+#define TOY_IDLE_TIMER_SLACK           (1 * 1000)       // ms, idle timeout may ride along on another wake-up
+#define TOY_DEEPSLEEP_TIMER_SLACK      (5 * 1000)
+
+#ifndef AI_TOY_FAST_BOOT
+#define AI_TOY_FAST_BOOT               0                // 1: end the LED self-test as soon as boot is done
+#endif
+
+// volume reports owed at the end of a settings window
+#define TOY_REPORT_DP_VOLUME           (1 << 0)         // dp 3
+#define TOY_REPORT_DP_VOLUME_CAP       (1 << 1)         // dp 107 echo
 
 //!  video
 #define MAX_INPUT_RINGBUG_SIZE          (128*1024)
 #define MAX_INPUT_BUF_SIZE              (16*1024)
+#define AI_TOY_VFRAME_SLOTS             (MAX_INPUT_RINGBUG_SIZE / MAX_INPUT_BUF_SIZE)
 
 #define AI_TOY_ALERT_PLAY_ID        "ai_toy_alert"
 
@@ -71,6 +96,7 @@ typedef enum {
     AI_TOY_UPLOAD,
     AI_TOY_THINK,
     AI_TOY_SPEAK,
+    AI_TOY_STATE_MAX,
 } ai_toy_state_t;
 
 typedef struct {
@@ -80,14 +106,14 @@ typedef struct {
     BOOL_T                       lp_stat;
     BOOL_T                       vad_active;
     ai_toy_state_t               state;
+    SYS_TIME_T                   state_enter_ms;     // 进入当前状态的时间
     UINT8_T                      volume;             // 音量, 0~100
     UINT8_T                      player_resume_flag: 1;  // 播放器需要恢复
     UINT8_T                      player_reply_flag: 1;   // 播放器需要重播
     UINT8_T                      player_next_flag: 1;    // 播放器需要重新请求播放
-    GW_WIFI_NW_STAT_E            nw_stat;            // 网络状态
     ty_ai_proc_t                 *llm;
-    TIMER_ID                     idle_timer;
-    TIMER_ID                     lowpower_timer;
+    AI_TOY_WHEEL_TIMER_T         idle_timer;
+    AI_TOY_WHEEL_TIMER_T         lowpower_timer;
 } TY_AI_TOY_T;
 
 
@@ -97,7 +123,9 @@ STATIC UINT8_T              s_lang =  TY_AI_DEFAULT_LANG;
 
 
 OPERATE_RET ty_ai_toy_alert(TY_AI_TOY_ALERT_TYPE type, BOOL_T send_eof);
-STATIC OPERATE_RET _report_sysinfo(VOID);
+STATIC OPERATE_RET _report_sysinfo(UINT8_T volume);
+STATIC VOID __ai_toy_alert_cache_prefetch(VOID);
+STATIC VOID __ai_toy_latency_update(ai_toy_state_t from, ai_toy_state_t to);
 
 void ai_toy_led_on(void)
 {
@@ -115,6 +143,46 @@ void ai_toy_led_flash(int time)
 }
 
 
+#if defined(AI_TOY_LATENCY_DPID)
+STATIC VOID __report_latency(VOID)
+{
+    CHAR_T buf[AI_TOY_LATENCY_JSON_MAX];
+    ai_toy_latency_summary_json(buf, sizeof(buf));
+    TY_OBJ_DP_S dp = {
+        .dpid = AI_TOY_LATENCY_DPID,
+        .type = PROP_STR,
+        .value.dp_str = buf,
+    };
+    tuya_report_dp_async(tuya_iot_get_gw_id(), &dp, 1, NULL);
+}
+#endif
+
+/**
+ * @brief feed conversation latency milestones carried by state transitions
+ */
+STATIC VOID __ai_toy_latency_update(ai_toy_state_t from, ai_toy_state_t to)
+{
+    if (AI_TOY_UPLOAD == to) {
+        ai_toy_latency_mark(AI_TOY_LAT_MARK_VAD_END);
+    } else if (AI_TOY_THINK == to && AI_TOY_UPLOAD == from) {
+        ai_toy_latency_mark(AI_TOY_LAT_MARK_UPLOAD_DONE);
+    } else if (AI_TOY_SPEAK == to) {
+        ai_toy_latency_mark(AI_TOY_LAT_MARK_PLAYER_START);
+#if defined(AI_TOY_LATENCY_DPID)
+        // report the aggregate once per full ring of new turns; SPEAK is
+        // entered again without a new turn, e.g. a second TTS segment
+        STATIC UINT32_T s_reported_turns = 0;
+        UINT32_T turns = ai_toy_latency_turns_get();
+        if (turns - s_reported_turns >= AI_TOY_LATENCY_TURNS) {
+            s_reported_turns = turns;
+            __report_latency();
+        }
+#endif
+    } else if (AI_TOY_UPLOAD == from || AI_TOY_THINK == from) {
+        ai_toy_latency_abort();
+    }
+}
+
 int ai_toy_state_update(TY_AI_TOY_T *toy, uint8_t state)
 {
     char *toy_state_str[] = {
@@ -125,23 +193,31 @@ int ai_toy_state_update(TY_AI_TOY_T *toy, uint8_t state)
         "AI_TOY_SPEAK"
     };
 
-    TAL_PR_DEBUG("ai_toy stat change: %s -> %s", toy_state_str[toy->state], toy_state_str[state]);
+    SYS_TIME_T now = tal_system_get_millisecond();
+    TAL_PR_DEBUG("ai_toy stat change: %s -> %s, after %d ms", toy_state_str[toy->state], toy_state_str[state],
+                 (INT_T)(now - toy->state_enter_ms));
+    __ai_toy_latency_update(toy->state, state);
     toy->state = state;
+    toy->state_enter_ms = now;
     //! lcd update
 #ifdef ENABLE_TUYA_UI    
     tuya_ai_display_msg(&state, 1, TY_DISPLAY_TP_CHAT_STAT);
 #endif
 
 
-    // start idle timer, when listen status keep in listen but no vad more than TOY_IDLE_TIMEOUT, changeback to AI_TOY_IDLE
+    // start idle timer, when listen status keep in listen but no vad more than the learned listen timeout
+    // (at most TOY_IDLE_TIMEOUT), changeback to AI_TOY_IDLE
     if (AI_TOY_LISTEN == toy->state) {
-        tal_sw_timer_start(toy->idle_timer, TOY_IDLE_TIMEOUT, TAL_TIMER_ONCE);
+        ai_toy_power_listen_start();
+        ai_toy_wheel_arm(&toy->idle_timer, ai_toy_power_listen_timeout());
     }
 
-    // start deepsleep timer, when status keep in AI_TOY_IDLE more than 
+    // start deepsleep timer, when status keep in AI_TOY_IDLE more than the learned lowpower timeout
+    // (at most TOY_DEEPSLEEP_TIMEOUT)
     if (AI_TOY_IDLE == toy->state) {
+        ai_toy_power_state_set(AI_TOY_PWR_IDLE);
         TAL_PR_DEBUG("lowpower_timer start");
-        tal_sw_timer_start(toy->lowpower_timer, TOY_DEEPSLEEP_TIMEOUT, TAL_TIMER_ONCE);
+        ai_toy_wheel_arm(&toy->lowpower_timer, ai_toy_power_lowpower_timeout());
 
         if (tuya_audio_player_get_status(TUYA_AUDIO_PLAYER_TYPE_MUSIC) == TUYA_PLAYER_STATE_PAUSED &&
             toy->player_resume_flag) {
@@ -152,8 +228,9 @@ int ai_toy_state_update(TY_AI_TOY_T *toy, uint8_t state)
         }
     } else {
         // if status exit AI_TOY_IDLE, stop the deepseelp timer
+        ai_toy_power_state_set(AI_TOY_PWR_ACTIVE);
         TAL_PR_DEBUG("lowpower_timer stop");
-        tal_sw_timer_stop(toy->lowpower_timer);
+        ai_toy_wheel_cancel(&toy->lowpower_timer);
     }
 
     toy->vad_active = false;
@@ -166,6 +243,9 @@ void ai_toy_player_stop(TY_AI_TOY_T *toy)
     if (tuya_speaker_service_tone_is_playing()) {
         tuya_speaker_service_tone_stop();
     }
+#if AI_TOY_ALERT_PCM_CACHE_ENABLE
+    ai_toy_alert_cache_stop();
+#endif
     if (tuya_audio_player_get_status(TUYA_AUDIO_PLAYER_TYPE_MUSIC) == TUYA_PLAYER_STATE_PLAYING) {
         TAL_PR_DEBUG("music is playing, pause");
         tuya_speaker_service_pause(0);
@@ -174,85 +254,255 @@ void ai_toy_player_stop(TY_AI_TOY_T *toy)
 }
 
 
-OPERATE_RET _event_play_status_cb(TUYA_PLAYER_EVENT_INFO_S *event, VOID *user_data)
+// toy worker event record sources, see ai_toy_evq.h
+typedef enum {
+    TOY_SRC_RECORDER,
+    TOY_SRC_PROC,
+    TOY_SRC_PLAYER,
+    TOY_SRC_KEY,
+    TOY_SRC_TIMER,
+    TOY_SRC_NET,                    ///< Wi-Fi status, code = status; live ones only reach the trace, the worker shows replayed ones
+    TOY_SRC_DP,                     ///< volume written from the app, code = dpid, arg = value
+} ai_toy_evt_src_t;
+
+#define TOY_EVT_FLAG_ALERT              (1 << 0)    // player event of an alert tone
+#define TOY_EVT_FLAG_REPLAY             (1 << 1)    // fed back by an event trace replay
+#define TOY_TIMER_IDLE                  0
+#define TOY_TIMER_LOWPOWER              1
+#define TOY_TIMER_WAKE_RESUME           2   // background half of the keep-alive exit
+
+/**
+ * toy state machine
+ *
+ * Every recorder, proc and player event that can change ai_toy_state_t goes
+ * through __ai_toy_fsm_dispatch(), which takes the next state and the actions
+ * from ai_toy_fsm_step(), see ai_toy_fsm.h. Actions run in the order each event
+ * had before the table: flags, LEDs, player stop and interrupt, alert, the
+ * state update, then the audio upload which may fall back to AI_TOY_IDLE.
+ * Events with TOY_ACT_STOP_FIRST (VAD_START) silence the player and interrupt
+ * the LLM before touching the LEDs.
+ */
+STATIC AI_TOY_FSM_MODE_E __ai_toy_mode_class(INT_T mode)
 {
-    if (!event)
-        return OPRT_OK;
-    
-    TY_AI_TOY_T *toy = (TY_AI_TOY_T *)user_data;
-    TAL_PR_DEBUG("player event: %d, src: %d, url: %s", event->event, event->src, event->url);
+    switch (mode) {
+    case AUDIO_RECODER_MODE_KEY_HOLD:
+        return TOY_MODE_KEY_HOLD;
+    case AUDIO_RECODER_MODE_WAKEUP:
+        return TOY_MODE_WAKEUP;
+    case AUDIO_RECODER_MODE_FREE:
+        return TOY_MODE_FREE;
+    default:
+        return TOY_MODE_OTHER;
+    }
+}
+
+STATIC VOID __ai_toy_fsm_leds(UINT32_T act)
+{
+    //! 显示状态更新
+    if (act & TOY_ACT_LED_ON) {
+        ai_toy_led_on();
+    }
+    if (act & TOY_ACT_LED_OFF) {
+        ai_toy_led_off();
+    }
+    if (act & TOY_ACT_LED_FLASH) {
+        ai_toy_led_flash(100);
+    }
+    //! LED灯带控制: 唤醒蓝色呼吸, 说话蓝灯快闪, TTS开始熄灭
+    if (act & TOY_ACT_STRIP_BREATH && ai_toy_netstat_is_provisioned()) {
+        set_led_state(LED_BREATHING, 0);
+    }
+    if (act & TOY_ACT_STRIP_DIALOG) {
+        set_led_state(LED_DIALOG, 0);
+    }
+    if (act & TOY_ACT_STRIP_IDLE && ai_toy_netstat_is_provisioned()) {
+        set_led_state(LED_IDLE, 0);
+    }
+    if (act & TOY_ACT_TRACE) {
+        AI_TOY_TRACE_POINT(AI_TOY_TP_LED);
+    }
+}
+
+STATIC VOID __ai_toy_fsm_stop(TY_AI_TOY_T *toy, UINT32_T act, INT_T mode)
+{
+    //! 播放停止
+    if (act & TOY_ACT_PLAYER_STOP) {
+        ai_toy_player_stop(toy);
+        AI_TOY_TRACE_POINT(AI_TOY_TP_PLAYER_STOP);
+    }
+    #ifdef ENABLE_TUYA_UI   
+    if (act & TOY_ACT_DISPLAY_MODE) {
+        UINT8_T disp_mode = (UINT8_T)mode;
+        tuya_ai_display_msg(&disp_mode, 1, TY_DISPLAY_TP_CHAT_MODE);
+    }
+    #endif
+    //! llm 中止处理
+    if (act & TOY_ACT_INTERRUPT) {
+        ty_ai_proc_event_send(toy->llm, AI_PROC_INTERRUPT_EVENT, NULL, 0);
+        AI_TOY_TRACE_POINT(AI_TOY_TP_LLM_INTERRUPT);
+    }
+}
+
+STATIC VOID __ai_toy_fsm_dispatch(TY_AI_TOY_T *toy, AI_TOY_FSM_EV_E ev, INT_T mode, UCHAR_T *data, UINT_T len, UINT32_T stamp_us)
+{
+    UINT32_T act = 0;
+    UINT8_T next = ai_toy_fsm_step(ev, toy->state, __ai_toy_mode_class(mode), &act);
+
+    if (TOY_ST_NONE == next) {
+        return;
+    }
+    TAL_PR_DEBUG("toy fsm: event %d, state %d, next %d, actions 0x%x", ev, toy->state, next, act);
+
+    if (act & TOY_ACT_TRACE) {
+        AI_TOY_TRACE_BEGIN(stamp_us);
+    }
+    if (act & TOY_ACT_VAD_ACTIVE) {
+        toy->vad_active = true;
+        ai_toy_wheel_cancel(&toy->idle_timer);
+        ai_toy_power_listen_heard();
+    }
+
+    if (act & TOY_ACT_STOP_FIRST) {
+        __ai_toy_fsm_stop(toy, act, mode);
+        __ai_toy_fsm_leds(act);
+    } else {
+        __ai_toy_fsm_leds(act);
+        __ai_toy_fsm_stop(toy, act, mode);
+    }
+    //! 播放提示音
+    if (act & TOY_ACT_ALERT_MODE) {
+        ty_ai_toy_alert(TOY_ALART_TYPE_LONG_KEY_TALK + mode, TRUE);
+    }
+    if (act & TOY_ACT_ALERT_WAKEUP) {
+        ty_ai_toy_alert(TOY_ALART_TYPE_WAKEUP, TRUE);
+        AI_TOY_TRACE_POINT(AI_TOY_TP_ALERT);
+    }
+
+    //! 播放&&TTS同步
+    if (act & TOY_ACT_PLAYER_READY) {
+        toy->player_stat = AI_TOY_PLAYER_REDAY;
+    }
+    if (act & TOY_ACT_PLAYER_STARTED) {
+        toy->player_stat = AI_TOY_PLAYER_START;
+    }
+    if (act & TOY_ACT_PLAYER_STOPPED) {
+        toy->player_stat = AI_TOY_PLAYER_STOP;
+    }
+
+    //! 设备状态更新
+    if (TOY_ST_KEEP != next) {
+        ai_toy_state_update(toy, next);
+        if (act & TOY_ACT_TRACE) {
+            AI_TOY_TRACE_POINT(AI_TOY_TP_STATE_UPDATE);
+        }
+    }
+    if (act & TOY_ACT_TRACE) {
+        AI_TOY_TRACE_END();
+    }
+
+    //! audio upload
+    if (act & (TOY_ACT_UPLOAD | TOY_ACT_UPLOAD_FINISH)) {
+        OPERATE_RET rt = ty_ai_proc_event_send(toy->llm, AI_PROC_AUDIO_EVENT, data, len);
+        if (act & TOY_ACT_UPLOAD_FINISH) {
+            rt |= ty_ai_proc_event_send(toy->llm, AI_PROC_FINSH_EVENT, NULL, 0);
+        }
+        if (OPRT_OK != rt) {
+            ai_toy_state_update(toy, AI_TOY_IDLE);
+            if (rt == OPRT_NETWORK_ERROR) {
+                ty_ai_toy_alert(TOY_ALERT_TYPE_NETWORK_DISCONNECT, TRUE);
+            }
+            ai_toy_led_off();
+        }
+    }
+}
+
+
 
-    if (event->event == TUYA_PLAYER_EVENT_FINISHED ||
-        event->event == TUYA_PLAYER_EVENT_STOPPED) {
-        if (event->url && strstr(event->url, AI_TOY_ALERT_PLAY_ID) != NULL) {
+STATIC VOID __ai_toy_player_handle(TY_AI_TOY_T *toy, INT_T event, INT_T src, BOOL_T is_alert)
+{
+    if (event == TUYA_PLAYER_EVENT_FINISHED ||
+        event == TUYA_PLAYER_EVENT_STOPPED) {
+        if (is_alert) {
             TAL_PR_DEBUG("alert player stop event");
-            return 0;
+            return;
         }
         // 监测player stop状态，重新触发下一轮对话录音
         TAL_PR_DEBUG("toy->state %d", toy->state);
-        if (AI_TOY_SPEAK == toy->state) {
-            audio_recorder_mode_t mode = audio_recorder_mode_get();
-            toy->player_stat = AI_TOY_PLAYER_STOP;
-            ai_toy_state_update(toy, (AUDIO_RECODER_MODE_KEY_HOLD == mode || AUDIO_RECODER_MODE_WAKEUP == mode) ? AI_TOY_IDLE : AI_TOY_LISTEN);
-        }
+        __ai_toy_fsm_dispatch(toy, TOY_EV_PLAYER_END, audio_recorder_mode_get(), NULL, 0, 0);
         // 接收到music finish事件，则请求下一首
-        if (event->src == TUYA_AUDIO_PLAYER_TYPE_MUSIC) {
-            if (event->event == TUYA_PLAYER_EVENT_FINISHED) {
+        if (src == TUYA_AUDIO_PLAYER_TYPE_MUSIC) {
+            if (event == TUYA_PLAYER_EVENT_FINISHED) {
                 // 触发重新请求播放
                 TAL_PR_DEBUG("player next");
                 OPERATE_RET ret = tuya_speaker_service_next();
                 TAL_PR_DEBUG("player next ret: %d", ret);
-                return ret;
+                return;
             }
         } else {
-            // 忽略提示音
-            if (!event->url || !strstr(event->url, AI_TOY_ALERT_PLAY_ID)) {
-                if (toy->player_reply_flag) {
-                    // 触发重复播放
-                    TAL_PR_DEBUG("player reply");
-                    toy->player_reply_flag = 0;
-                    OPERATE_RET ret = tuya_speaker_service_replay();
-                    TAL_PR_DEBUG("player reply ret: %d", ret);
-                    return ret;
-                } else if (tuya_audio_player_get_status(TUYA_AUDIO_PLAYER_TYPE_MUSIC) == TUYA_PLAYER_STATE_PAUSED &&
-                           toy->player_resume_flag) {
-                    TAL_PR_DEBUG("music resume");
-                    if (tuya_speaker_service_resume(0) == OPRT_OK) {
-                        return OPRT_OK;
-                    }
+            if (toy->player_reply_flag) {
+                // 触发重复播放
+                TAL_PR_DEBUG("player reply");
+                toy->player_reply_flag = 0;
+                OPERATE_RET ret = tuya_speaker_service_replay();
+                TAL_PR_DEBUG("player reply ret: %d", ret);
+                return;
+            } else if (tuya_audio_player_get_status(TUYA_AUDIO_PLAYER_TYPE_MUSIC) == TUYA_PLAYER_STATE_PAUSED &&
+                       toy->player_resume_flag) {
+                TAL_PR_DEBUG("music resume");
+                if (tuya_speaker_service_resume(0) == OPRT_OK) {
+                    return;
                 }
             }
         }
         TAL_PR_DEBUG("player stop event");
-    }  else if (event->event == TUYA_PLAYER_EVENT_PAUSED) {
+    }  else if (event == TUYA_PLAYER_EVENT_PAUSED) {
         TAL_PR_DEBUG("player pause event");
-    } else if (event->event == TUYA_PLAYER_EVENT_STARTED) {
+    } else if (event == TUYA_PLAYER_EVENT_STARTED) {
         TAL_PR_DEBUG("player start event %d", toy->player_stat);
         // tone is start and music is playing, pause the music player
-        if (event->src != TUYA_AUDIO_PLAYER_TYPE_MUSIC) {
+        if (src != TUYA_AUDIO_PLAYER_TYPE_MUSIC) {
             if (tuya_audio_player_get_status(TUYA_AUDIO_PLAYER_TYPE_MUSIC) == TUYA_PLAYER_STATE_PLAYING) {
                 TAL_PR_DEBUG("music is playing, pause");
                 tuya_speaker_service_pause(0);
             }
         }
 
-        if (AI_TOY_THINK == toy->state || AI_TOY_UPLOAD == toy->state) {
-            toy->player_stat = AI_TOY_PLAYER_START;
-            ai_toy_state_update(toy, AI_TOY_SPEAK);
-        }
+        __ai_toy_fsm_dispatch(toy, TOY_EV_PLAYER_START, audio_recorder_mode_get(), NULL, 0, 0);
+    }
+}
+
+OPERATE_RET _event_play_status_cb(TUYA_PLAYER_EVENT_INFO_S *event, VOID *user_data)
+{
+    if (!event)
+        return OPRT_OK;
+
+    TAL_PR_DEBUG("player event: %d, src: %d, url: %s", event->event, event->src, event->url);
+
+    // the url does not outlive the callback, classify it here
+    AI_TOY_EVT_T evt = {
+        .src   = TOY_SRC_PLAYER,
+        .code  = (UINT8_T)event->event,
+        .flags = (event->url && strstr(event->url, AI_TOY_ALERT_PLAY_ID) != NULL) ? TOY_EVT_FLAG_ALERT : 0,
+        .arg   = (UINT32_T)event->src,
+    };
+    // a lost end of playback would leave the toy in AI_TOY_SPEAK
+    if (event->event == TUYA_PLAYER_EVENT_FINISHED || event->event == TUYA_PLAYER_EVENT_STOPPED) {
+        ai_toy_evq_post_critical(&evt);
     } else {
-        return 0;
+        ai_toy_evq_post(&evt);
     }
+
+    return OPRT_OK;
 }
 
 STATIC OPERATE_RET _network_status_get(TY_AI_NET_STATUS_E *status)
 {
     if (status) {
-        TY_AI_TOY_T *ctx = s_ai_toy;
+        GW_WIFI_NW_STAT_E nw_stat = ai_toy_netstat_get();
 
-        if (ctx->nw_stat == STAT_UNPROVISION_AP_STA_UNCFG) {
+        if (nw_stat == STAT_UNPROVISION_AP_STA_UNCFG) {
             *status = TY_AI_NET_STATUS_UNCFG;
-        } else if (ctx->nw_stat != STAT_CLOUD_CONN || !ty_ai_chat_is_online()) {
+        } else if (nw_stat != STAT_CLOUD_CONN || !ty_ai_chat_is_online()) {
             *status = TY_AI_NET_STATUS_DISCONNECTED;
         } else {
             *status = TY_AI_NET_STATUS_CONNECTED;
@@ -262,7 +512,62 @@ STATIC OPERATE_RET _network_status_get(TY_AI_NET_STATUS_E *status)
 }
 
 
-STATIC VOID ai_toy_key_process(UINT_T port, PUSH_KEY_TYPE_E type, INT_T cnt) 
+/**
+ * keep-alive exit, staged
+ *
+ * Only what the first second of the interaction needs runs before the key is
+ * handled: the CPU back to full speed, the PA for the wake tone and the LED
+ * ring as the acknowledgement. The radio, LCD, battery monitor and RSSI
+ * sampler come back in a follow-up worker event, which runs after the key
+ * handler has started the recorder; the upload they are needed for is
+ * seconds away.
+ */
+STATIC VOID __ai_toy_wake_background(TY_AI_TOY_T *toy)
+{
+    OPERATE_RET rt;
+
+    rt = tal_wifi_lp_disable();
+    TAL_PR_DEBUG("tal_wifi_lp_disable rt=%d", rt);
+    ai_toy_wake_mark(AI_TOY_WAKE_ST_WIFI);
+
+    // open LCD
+    tkl_disp_set_brightness(NULL, 100);
+
+    // open battery report
+    #if defined(TUYA_AI_TOY_BATTERY_ENABLE) && (TUYA_AI_TOY_BATTERY_ENABLE == 1)
+    tuya_ai_toy_battery_init();
+    #endif
+
+    ai_toy_netstat_lowpower_set(FALSE);
+    ai_toy_wake_mark(AI_TOY_WAKE_ST_PERIPH);
+}
+
+STATIC VOID __ai_toy_wake_critical(TY_AI_TOY_T *toy)
+{
+    OPERATE_RET rt;
+
+    ai_toy_wake_mark(AI_TOY_WAKE_ST_DISPATCH);
+    rt = tal_cpu_lp_disable();
+    TAL_PR_DEBUG("tal_cpu_lp_disable rt=%d", rt);
+    ai_toy_wake_mark(AI_TOY_WAKE_ST_CPU);
+
+    // open PA
+    tkl_gpio_write(toy->cfg.spk_en_pin, TUYA_GPIO_LEVEL_HIGH);
+
+    // bring the ring back with its last frame
+    led_controller_resume();
+    ai_toy_wake_mark(AI_TOY_WAKE_ST_ACK);
+
+    toy->lp_stat = FALSE;
+    ai_toy_power_state_set(AI_TOY_PWR_IDLE);
+
+    AI_TOY_EVT_T evt = {.src = TOY_SRC_TIMER, .code = TOY_TIMER_WAKE_RESUME};
+    if (OPRT_OK != ai_toy_evq_post_critical(&evt)) {
+        __ai_toy_wake_background(toy);
+    }
+}
+
+STATIC VOID __ai_toy_key_handle(UINT_T port, PUSH_KEY_TYPE_E type, INT_T cnt, UINT32_T stamp_us) 
 {
     static char *keystr[] = {
         "NORMAL_KEY",
@@ -273,25 +578,9 @@ STATIC VOID ai_toy_key_process(UINT_T port, PUSH_KEY_TYPE_E type, INT_T cnt)
 
     TAL_PR_DEBUG("key process type: %s", keystr[type]);
 
-    OPERATE_RET rt = OPRT_OK;
     if (s_ai_toy->lp_stat == TRUE) {
-        // exit keep-alive status
-        rt = tal_cpu_lp_disable();
-        rt |= tal_wifi_lp_disable();
-        
-        // close LCD
-        tkl_disp_set_brightness(NULL, 100);
-
-        // close PA
-        tkl_gpio_write(s_ai_toy->cfg.spk_en_pin, TUYA_GPIO_LEVEL_HIGH);
-
-        // close battery report
-        #if defined(TUYA_AI_TOY_BATTERY_ENABLE) && (TUYA_AI_TOY_BATTERY_ENABLE == 1)
-        tuya_ai_toy_battery_init();
-        #endif        
-
-        s_ai_toy->lp_stat = FALSE;
-        TAL_PR_DEBUG("tal_cpu_lp_disable rt=%d", rt);        
+        ai_toy_wake_press(stamp_us);
+        __ai_toy_wake_critical(s_ai_toy);
     }
 
 #if (defined(T5AI_BOARD_EVB) && T5AI_BOARD_EVB == 1) || (defined(T5AI_BOARD_CELLULAR) && (T5AI_BOARD_CELLULAR == 1))
@@ -350,9 +639,7 @@ STATIC VOID ai_toy_key_process(UINT_T port, PUSH_KEY_TYPE_E type, INT_T cnt)
     // }
 #endif
 
-    GW_WIFI_NW_STAT_E cur_nw_stat = 0;
-    get_wf_gw_nw_status(&cur_nw_stat);
-    if (cur_nw_stat == STAT_UNPROVISION_AP_STA_UNCFG) {
+    if (!ai_toy_netstat_is_provisioned()) {
         if(type != RELEASE_KEY)
         {
             ty_ai_toy_alert(TOY_ALERT_TYPE_NETWORK_CFG, TRUE);
@@ -385,6 +672,7 @@ STATIC VOID ai_toy_key_process(UINT_T port, PUSH_KEY_TYPE_E type, INT_T cnt)
         TAL_PR_DEBUG("audio_recorder mode %d", mode); */
         //! 按键唤醒
         audio_recorder_start();
+        ai_toy_wake_mark(AI_TOY_WAKE_ST_RECORDER);
         
     } break;
 
@@ -396,6 +684,7 @@ STATIC VOID ai_toy_key_process(UINT_T port, PUSH_KEY_TYPE_E type, INT_T cnt)
         // } */
         TAL_PR_DEBUG("Reset ctrl data!");
         //tuya_iot_wf_gw_fast_unactive(GWCM_OLD, WF_START_SMART_AP_CONCURRENT);
+        ai_toy_settings_flush();
         extern void daying_trigger_device_reset(void);
         daying_trigger_device_reset();
     } break;
@@ -411,164 +700,161 @@ STATIC VOID ai_toy_key_process(UINT_T port, PUSH_KEY_TYPE_E type, INT_T cnt)
 
 
 
+// key thread: stamp every press, the worker decides whether it woke the device
+STATIC VOID ai_toy_key_process(UINT_T port, PUSH_KEY_TYPE_E type, INT_T cnt)
+{
+    AI_TOY_EVT_T evt = {
+        .src      = TOY_SRC_KEY,
+        .code     = (UINT8_T)type,
+        .arg      = port,
+        .arg2     = (UINT32_T)cnt,
+        .stamp_us = (UINT32_T)AI_TOY_TRACE_NOW_US(),
+    };
+    // a lost press or release leaves the toy listening or asleep
+    ai_toy_evq_post_critical(&evt);
+}
+
+/**
+ * recorder audio staging
+ *
+ * Audio attached to VAD events does not outlive the recorder callback. It is
+ * copied into this PSRAM byte ring and uploaded by the worker. Single
+ * producer (recorder thread), single consumer (worker), positions only grow;
+ * a frame that would wrap skips to the start of the ring so it stays contiguous.
+ * A NULL source stages silence, used by the event trace replay which only
+ * records payload lengths.
+ */
+#define AI_TOY_AUDIO_STAGE_SIZE         (64 * 1024)
+
+typedef struct {
+    UCHAR_T                     *buf;
+    UINT32_T                     wr;
+    UINT32_T                     rd;
+    UINT32_T                     dropped;
+} ai_toy_audio_stage_t;
+
+STATIC ai_toy_audio_stage_t s_audio_stage;
+
+STATIC OPERATE_RET __audio_stage_put(CONST UCHAR_T *data, UINT32_T len, UINT32_T *pos)
+{
+    ai_toy_audio_stage_t *st = &s_audio_stage;
+    UINT32_T off = st->wr % AI_TOY_AUDIO_STAGE_SIZE;
+    UINT32_T start = (off + len > AI_TOY_AUDIO_STAGE_SIZE) ? st->wr + (AI_TOY_AUDIO_STAGE_SIZE - off) : st->wr;
+    UINT32_T rd = __atomic_load_n(&st->rd, __ATOMIC_ACQUIRE);
+
+    if (NULL == st->buf || start + len - rd > AI_TOY_AUDIO_STAGE_SIZE) {
+        st->dropped++;
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+    if (data) {
+        memcpy(st->buf + start % AI_TOY_AUDIO_STAGE_SIZE, data, len);
+    } else {
+        memset(st->buf + start % AI_TOY_AUDIO_STAGE_SIZE, 0, len);
+    }
+    st->wr = start + len;
+    *pos = start;
+    return OPRT_OK;
+}
+
+STATIC VOID __audio_stage_release(UINT32_T pos, UINT32_T len)
+{
+    __atomic_store_n(&s_audio_stage.rd, pos + len, __ATOMIC_RELEASE);
+}
+
 void ai_toy_audio_recoder_cb(audio_recorder_msg_t *msg, void *user_data)
 {
-    int rt = 0;
-    TY_AI_TOY_T *ai_toy = (TY_AI_TOY_T *)user_data;
+    // barge-in traces start here, queueing to the worker is their first step
+    AI_TOY_EVT_T evt = {
+        .src      = TOY_SRC_RECORDER,
+        .code     = (UINT8_T)msg->state,
+        .mode     = (INT8_T)msg->mode,
+        .stamp_us = (UINT32_T)AI_TOY_TRACE_NOW_US(),
+    };
+
+    // a replay owns the recorder input, and the audio stage has a single producer
+    if (ai_toy_evtrace_replaying()) {
+        return;
+    }
+
+    if ((AUDIO_RECODER_VAD_START == msg->state || AUDIO_RECODER_VAD_SPEAK == msg->state ||
+         AUDIO_RECODER_VAD_END == msg->state) && msg->data && msg->datalen > 0) {
+        ai_toy_wake_audio();
+        if (OPRT_OK == __audio_stage_put((CONST UCHAR_T *)msg->data, msg->datalen, &evt.arg)) {
+            evt.arg2 = msg->datalen;
+        }
+    }
+    // a lost end of utterance or recorder stop would leave the toy in AI_TOY_LISTEN
+    if (AUDIO_RECODER_VAD_END == msg->state || AUDIO_RECODER_STOP == msg->state) {
+        ai_toy_evq_post_critical(&evt);
+    } else {
+        ai_toy_evq_post(&evt);
+    }
+}
 
-    switch (msg->state) {
+STATIC VOID __ai_toy_recorder_handle(TY_AI_TOY_T *ai_toy, CONST AI_TOY_EVT_T *evt)
+{
+    AI_TOY_FSM_EV_E ev;
+    UCHAR_T *data = NULL;
 
+    switch (evt->code) {
     case AUDIO_RECODER_MODE_UPDATE:
-        ai_toy_led_off();
-        //! 播放停止
-        ai_toy_player_stop(ai_toy);
-        //! lcd 显示更新
-        #ifdef ENABLE_TUYA_UI   
-        tuya_ai_display_msg(&msg->mode, 1, TY_DISPLAY_TP_CHAT_MODE);
-        #endif
-        //! llm 中止处理
-        ty_ai_proc_event_send(ai_toy->llm, AI_PROC_INTERRUPT_EVENT, NULL, 0);
-        //! player 播放提示音
-        ty_ai_toy_alert(TOY_ALART_TYPE_LONG_KEY_TALK + msg->mode, TRUE);
-        //! 根据模式设置状态
-        ai_toy_state_update(ai_toy, AI_TOY_IDLE);
         TAL_PR_DEBUG("AUDIO_RECODER_MODE_UPDATE");
+        ev = TOY_EV_MODE_UPDATE;
         break;
-
     case AUDIO_RECODER_WAKEUP:  //! 唤醒打断
-        TAL_PR_DEBUG("AUDIO_RECODER_WAKEUP");
     case AUDIO_RECODER_START:   //! 按键打断
-        TAL_PR_DEBUG("AUDIO_RECODER_START");
-        //! 显示状态更新
-        ai_toy_led_on();
-        
-        //! LED灯带控制 - AI唤醒时蓝色呼吸（仅在已配网状态下）
-        {
-            GW_WIFI_NW_STAT_E cur_nw_stat = 0;
-            get_wf_gw_nw_status(&cur_nw_stat);
-            if (cur_nw_stat != STAT_UNPROVISION_AP_STA_UNCFG) {
-                set_led_state(LED_BREATHING, 0);
-            }
-        }
-        
-        //! 播放停止
-        ai_toy_player_stop(ai_toy);
-        //! llm 中止处理
-        ty_ai_proc_event_send(ai_toy->llm, AI_PROC_INTERRUPT_EVENT, NULL, 0);
-        //! 播放提示音
-        ty_ai_toy_alert(TOY_ALART_TYPE_WAKEUP, TRUE);
-        //! 设备状态更新
-        ai_toy_state_update(ai_toy, (AUDIO_RECODER_MODE_KEY_HOLD == msg->mode) ? AI_TOY_IDLE : AI_TOY_LISTEN);
+        TAL_PR_DEBUG("AUDIO_RECODER_%s", (AUDIO_RECODER_WAKEUP == evt->code) ? "WAKEUP" : "START");
+        ev = TOY_EV_WAKEUP;
         break;
-
     case AUDIO_RECODER_STOP:
-        //! 显示状态更新
         TAL_PR_DEBUG("AUDIO_RECODER_STOP");
-        ai_toy_led_off();
-        //! 播放停止
-        ai_toy_player_stop(ai_toy);
-        ai_toy_state_update(ai_toy,  AI_TOY_IDLE);
-        // LED状态会在ai_toy_state_update中恢复网络状态显示
+        ev = TOY_EV_REC_STOP;
         break;
-
     case AUDIO_RECODER_VAD_START:
-        if (AI_TOY_LISTEN != ai_toy->state && //! 支持自由说模式, 说话打断，本地VAD不自打断
-           (AI_TOY_SPEAK  != ai_toy->state || AUDIO_RECODER_MODE_FREE != msg->mode)) {
-            break;
-        }
-        //! TODO: 随意说状态更新
-        TAL_PR_DEBUG("----------AUDIO_RECODER_VAD_START----------");
-        ai_toy->vad_active = true;
-        tal_sw_timer_stop(ai_toy->idle_timer);
-
-        //! 播放停止
-        ai_toy_player_stop(ai_toy);        
-        //! llm 中止处理
-        ty_ai_proc_event_send(ai_toy->llm, AI_PROC_INTERRUPT_EVENT, NULL, 0);
-        
-        
-        //! led show (原LED控制保留)
-        ai_toy_led_flash(100);
-        set_led_state(LED_DIALOG, 0);     // 蓝灯快闪
-        //! audio upload
-        if (OPRT_OK != (rt = ty_ai_proc_event_send(ai_toy->llm, AI_PROC_AUDIO_EVENT, msg->data, msg->datalen))) {
-            ai_toy_state_update(ai_toy,  AI_TOY_IDLE);
-            if (rt == OPRT_NETWORK_ERROR) {
-                ty_ai_toy_alert(TOY_ALERT_TYPE_NETWORK_DISCONNECT, TRUE);
-            }
-            ai_toy_led_off();
-        }
+        ev = TOY_EV_VAD_START;
         break;
-
     case AUDIO_RECODER_VAD_SPEAK:
-        if (AI_TOY_LISTEN != ai_toy->state && //! 支持自由说模式, 说话打断
-           (AI_TOY_SPEAK  != ai_toy->state || AUDIO_RECODER_MODE_FREE != msg->mode)) {
-            break;
-        }
-        if (OPRT_OK != (rt = ty_ai_proc_event_send(ai_toy->llm, AI_PROC_AUDIO_EVENT, msg->data, msg->datalen))) {
-            ai_toy_state_update(ai_toy,  AI_TOY_IDLE);
-            if (rt == OPRT_NETWORK_ERROR) {
-                ty_ai_toy_alert(TOY_ALERT_TYPE_NETWORK_DISCONNECT, TRUE);
-            }
-            ai_toy_led_off();
-        }
+        ev = TOY_EV_VAD_SPEAK;
         break;
-
     case AUDIO_RECODER_VAD_END:
-        if (AI_TOY_LISTEN != ai_toy->state && //! 支持自由说模式, 说话打断
-           (AI_TOY_SPEAK  != ai_toy->state || AUDIO_RECODER_MODE_FREE != msg->mode)) {
-            break;
-        }
-
-        TAL_PR_DEBUG("----------AUDIO_RECODER_VAD_END----------");
-        ai_toy_state_update(ai_toy, AI_TOY_UPLOAD);
-
-        
-        //! led end (原LED控制保留)
-        ai_toy_led_off();
-        rt  = ty_ai_proc_event_send(ai_toy->llm, AI_PROC_AUDIO_EVENT, msg->data, msg->datalen);
-        rt |= ty_ai_proc_event_send(ai_toy->llm, AI_PROC_FINSH_EVENT, NULL, 0);
-        if (OPRT_OK != rt) {
-            ai_toy_state_update(ai_toy,  AI_TOY_IDLE);
-            if (rt == OPRT_NETWORK_ERROR) {
-                ty_ai_toy_alert(TOY_ALERT_TYPE_NETWORK_DISCONNECT, TRUE);
-            }
-        }
-        TAL_PR_DEBUG("----------AUDIO_RECODER_FINSH----------");
+        ev = TOY_EV_VAD_END;
         break;
+    default:
+        return;
+    }
+
+    if (evt->arg2) {
+        data = s_audio_stage.buf + evt->arg % AI_TOY_AUDIO_STAGE_SIZE;
+    }
+    __ai_toy_fsm_dispatch(ai_toy, ev, evt->mode, data, evt->arg2, evt->stamp_us);
+    if (evt->arg2) {
+        __audio_stage_release(evt->arg, evt->arg2);
     }
 }
 
+STATIC AI_TOY_TEXT_STREAM_T s_text_stream;
+
+STATIC VOID __text_stream_line(CONST CHAR_T *line, UINT_T len, VOID *arg)
+{
+    TAL_PR_DEBUG("text stream: %s", line);
+}
+
 STATIC VOID ai_toy_text_stream_dump(int type, UCHAR_T *data, INT_T len)
 {
-    STATIC UCHAR_T buf[128] = {0};
+    AI_TOY_TEXT_STREAM_T *st = &s_text_stream;
+
     switch (type) {
     case AI_PROC_TEXT_START:
-        memset(buf, 0, sizeof(buf));
+        ai_toy_text_stream_start(st);
         TAL_PR_DEBUG("text stream start...");
         break;
     case AI_PROC_TEXT_DATA:
-        while(len > 0) {
-            if (strlen(buf) + len >= sizeof(buf) - 1) {
-                TAL_PR_DEBUG("text stream: %s", buf);
-                memset(buf, 0, sizeof(buf));
-            }
-
-            INT_T ret = MIN(len, sizeof(buf) - 1 - strlen(buf));
-            memcpy(buf + strlen(buf), data, ret);
-            len -= ret;
-            data += ret;
-            if (strlen(buf) >= sizeof(buf) - 1) {
-                TAL_PR_DEBUG("text stream: %s", buf);
-                memset(buf, 0, sizeof(buf));
-            }
+        if (len > 0 && data) {
+            ai_toy_text_stream_put(st, data, len);
         }
         break;
     case AI_PROC_TEXT_STOP:
-        if (strlen(buf) > 0) {
-            TAL_PR_DEBUG("text stream: %s", buf);
-            memset(buf, 0, sizeof(buf));
-        }
+        ai_toy_text_stream_stop(st);
         TAL_PR_DEBUG("text stream stop...");
         break;
     default:
@@ -576,90 +862,176 @@ STATIC VOID ai_toy_text_stream_dump(int type, UCHAR_T *data, INT_T len)
     }
 }
 
-STATIC VOID ai_toy_text_display(int type, UCHAR_T *data, INT_T len)
+/**
+ * AI text display batching
+ *
+ * Streamed text chunks are appended to a pending delta and pushed to the UI
+ * at most AI_TOY_TEXT_DISPLAY_FPS times per second. Only the new text since
+ * the last update is sent, the UI appends it. TEXT_STOP flushes immediately.
+ */
+#ifndef AI_TOY_TEXT_DISPLAY_FPS
+#define AI_TOY_TEXT_DISPLAY_FPS         5
+#endif
+#define AI_TOY_TEXT_DISPLAY_INTERVAL    (1000 / AI_TOY_TEXT_DISPLAY_FPS)
+#define AI_TOY_TEXT_DELTA_SIZE          512
+
+typedef struct {
+    CHAR_T                       delta[AI_TOY_TEXT_DELTA_SIZE];
+    UINT_T                       len;
+    SYS_TIME_T                   last_flush;
+    BOOL_T                       timer_armed;
+    MUTEX_HANDLE                 mutex;
+    TIMER_ID                     timer;
+    UINT_T                       chunks;
+    UINT_T                       updates;
+} ai_toy_text_batch_t;
+
+STATIC ai_toy_text_batch_t s_text_batch;
+
+// caller holds s_text_batch.mutex
+STATIC VOID __text_batch_flush_locked(ai_toy_text_batch_t *tb, BOOL_T force)
 {
-    ai_toy_text_stream_dump(type, data, len);
+    UINT_T cut = force ? tb->len : ai_toy_utf8_complete_len(tb->delta, tb->len);
+    if (0 == cut) {
+        return;
+    }
 
-    static char  ai_text[512];
-    static int   ai_text_len = 0;
-    memcpy(ai_text, data, len);
-    ai_text_len = len;
     #ifdef ENABLE_TUYA_UI   
-    tuya_ai_display_msg(ai_text, ai_text_len, TY_DISPLAY_TP_AI_CHAT);
+    tuya_ai_display_msg((UCHAR_T *)tb->delta, cut, TY_DISPLAY_TP_AI_CHAT);
     #endif
+    tb->updates++;
+    tb->last_flush = tal_system_get_millisecond();
+
+    tb->len -= cut;
+    if (tb->len) {
+        memmove(tb->delta, tb->delta + cut, tb->len);
+    }
 }
 
+STATIC VOID __text_batch_timer_cb(TIMER_ID timer_id, VOID_T *arg)
+{
+    ai_toy_text_batch_t *tb = (ai_toy_text_batch_t *)arg;
 
+    tal_mutex_lock(tb->mutex);
+    tb->timer_armed = FALSE;
+    __text_batch_flush_locked(tb, FALSE);
+    tal_mutex_unlock(tb->mutex);
+}
 
-static int ai_toy_proc_output_cb(ai_proc_msg_t *msg,  void *user_data)
+STATIC OPERATE_RET ai_toy_text_batch_init(VOID)
 {
-    // PR_DEBUG("ai_toy_proc call event %d", msg->event);
+    OPERATE_RET rt = OPRT_OK;
 
-    TY_AI_TOY_T *toy = (TY_AI_TOY_T *)user_data;
+    memset(&s_text_batch, 0, sizeof(s_text_batch));
+    TUYA_CALL_ERR_RETURN(tal_mutex_create_init(&s_text_batch.mutex));
+    TUYA_CALL_ERR_RETURN(tal_sw_timer_create(__text_batch_timer_cb, &s_text_batch, &s_text_batch.timer));
+    return OPRT_OK;
+}
 
-    switch (msg->event) {
+STATIC VOID __text_batch_append(ai_toy_text_batch_t *tb, CONST UCHAR_T *data, UINT_T len)
+{
+    tb->chunks++;
+    while (len > 0) {
+        UINT_T n = MIN(len, sizeof(tb->delta) - tb->len);
+        memcpy(tb->delta + tb->len, data, n);
+        tb->len += n;
+        data += n;
+        len -= n;
+        if (tb->len >= sizeof(tb->delta)) {
+            __text_batch_flush_locked(tb, FALSE);
+            if (tb->len >= sizeof(tb->delta)) {
+                __text_batch_flush_locked(tb, TRUE);
+            }
+        }
+    }
+
+    SYS_TIME_T elapsed = tal_system_get_millisecond() - tb->last_flush;
+    if (elapsed >= AI_TOY_TEXT_DISPLAY_INTERVAL) {
+        __text_batch_flush_locked(tb, FALSE);
+    } else if (tb->len && !tb->timer_armed) {
+        tb->timer_armed = TRUE;
+        tal_sw_timer_start(tb->timer, AI_TOY_TEXT_DISPLAY_INTERVAL - elapsed, TAL_TIMER_ONCE);
+    }
+}
+
+STATIC VOID ai_toy_text_display(int type, UCHAR_T *data, INT_T len)
+{
+    ai_toy_text_batch_t *tb = &s_text_batch;
+
+    ai_toy_text_stream_dump(type, data, len);
+
+    if (len < 0 || (len > 0 && NULL == data)) {
+        return;
+    }
+
+    if (NULL == tb->mutex) {
+        #ifdef ENABLE_TUYA_UI   
+        tuya_ai_display_msg(data, len, TY_DISPLAY_TP_AI_CHAT);
+        #endif
+        return;
+    }
+
+    tal_mutex_lock(tb->mutex);
+    switch (type) {
+    case AI_PROC_TEXT_START:
+        tal_sw_timer_stop(tb->timer);
+        tb->timer_armed = FALSE;
+        tb->len = 0;
+        tb->last_flush = 0;
+        #ifdef ENABLE_TUYA_UI   
+        tuya_ai_display_msg(data, len, TY_DISPLAY_TP_AI_CHAT);
+        #endif
+        break;
+    case AI_PROC_TEXT_DATA:
+        __text_batch_append(tb, data, len);
+        break;
+    case AI_PROC_TEXT_STOP:
+        tal_sw_timer_stop(tb->timer);
+        tb->timer_armed = FALSE;
+        if (len > 0) {
+            __text_batch_append(tb, data, len);
+        }
+        __text_batch_flush_locked(tb, TRUE);
+        TAL_PR_DEBUG("ai text display: %d chunks, %d updates", tb->chunks, tb->updates);
+        tb->chunks = 0;
+        tb->updates = 0;
+        break;
+    default:
+        break;
+    }
+    tal_mutex_unlock(tb->mutex);
+}
+
+
+
+STATIC VOID __ai_toy_proc_handle(TY_AI_TOY_T *toy, INT_T event)
+{
+    switch (event) {
 
     case AI_PROC_UPLOAD_DONE:
         TAL_PR_DEBUG("AI_PROC_UPLOAD_DONE %d", toy->state);
-        if (toy->state == AI_TOY_UPLOAD) {
-            ai_toy_state_update(toy, AI_TOY_THINK);
-        }
+        __ai_toy_fsm_dispatch(toy, TOY_EV_UPLOAD_DONE, audio_recorder_mode_get(), NULL, 0, 0);
         break;
 
     case AI_PROC_ASR_OK:
-        ai_toy_led_on();
-        #ifdef ENABLE_TUYA_UI   
-        tuya_ai_display_msg(msg->data, msg->datalen, TY_DISPLAY_TP_HUMAN_CHAT);
-        #endif
+        ai_toy_latency_mark(AI_TOY_LAT_MARK_ASR_OK);
+        __ai_toy_fsm_dispatch(toy, TOY_EV_ASR_OK, audio_recorder_mode_get(), NULL, 0, 0);
         break;
 
     case AI_PROC_ASR_EMPTY:
-        ai_toy_state_update(toy, (AUDIO_RECODER_MODE_KEY_HOLD == audio_recorder_mode_get()) ? AI_TOY_IDLE : AI_TOY_LISTEN);
-        break;
-
     case AI_PROC_ASR_TIMEOUT:
     case AI_PROC_UPLOAD_FAIL:
     case AI_PROC_TTS_ABORT: //！ TODO:
     case AI_PROC_TTS_TIMEOUT:
-        ai_toy_state_update(toy, (AUDIO_RECODER_MODE_KEY_HOLD == audio_recorder_mode_get()) ? AI_TOY_IDLE : AI_TOY_LISTEN);
+        __ai_toy_fsm_dispatch(toy, TOY_EV_ASR_FAIL, audio_recorder_mode_get(), NULL, 0, 0);
         // ty_ai_toy_alert(TOY_ALERT_TYPE_NETWORK_DISCONNECT, TRUE);
         break;
 
     case AI_PROC_TTS_START:
-        //! 播放&&TTS同步
-        toy->player_stat = AI_TOY_PLAYER_REDAY;
-        
-        //! LED灯带控制 - AI说话时LED熄灭（仅在已配网状态下）
-        {
-            GW_WIFI_NW_STAT_E cur_nw_stat = 0;
-            get_wf_gw_nw_status(&cur_nw_stat);
-            if (cur_nw_stat != STAT_UNPROVISION_AP_STA_UNCFG) {
-                set_led_state(LED_IDLE, 0);
-            }
-        }
-        break;
-
-    case AI_PROC_TTS_DATA:
-        break;
-
-    case AI_PROC_TTS_STOP:
-        break;
-
-    case AI_PROC_ASR_EMOJI:
-        #ifdef ENABLE_TUYA_UI   
-        tuya_ai_display_msg(msg->data, msg->datalen, TY_DISPLAY_TP_EMOJI);
-        #endif
+        ai_toy_latency_mark(AI_TOY_LAT_MARK_TTS_START);
+        __ai_toy_fsm_dispatch(toy, TOY_EV_TTS_START, audio_recorder_mode_get(), NULL, 0, 0);
         break;
 
-    case AI_PROC_TTS_EMOJI:
-        break;
-
-    //! 文本处理显示
-    case AI_PROC_TEXT_START:
-    case AI_PROC_TEXT_DATA:
-    case AI_PROC_TEXT_STOP:
-        ai_toy_text_display(msg->event, msg->data, msg->datalen);
-        break;
 
     //! llm player control
     case AI_PROC_PLAY_CTL_PLAY:
@@ -695,10 +1067,265 @@ static int ai_toy_proc_output_cb(ai_proc_msg_t *msg,  void *user_data)
     default:
         break;
     }
+}
+
+static int ai_toy_proc_output_cb(ai_proc_msg_t *msg,  void *user_data)
+{
+    // PR_DEBUG("ai_toy_proc call event %d", msg->event);
+
+    // payload consumers that do not touch the toy state run inline
+    switch (msg->event) {
+    case AI_PROC_TTS_DATA:
+    case AI_PROC_TTS_STOP:
+    case AI_PROC_TTS_EMOJI:
+        return 0;
+
+    case AI_PROC_ASR_OK:
+        #ifdef ENABLE_TUYA_UI   
+        tuya_ai_display_msg(msg->data, msg->datalen, TY_DISPLAY_TP_HUMAN_CHAT);
+        #endif
+        break;
+
+    case AI_PROC_ASR_EMOJI:
+        #ifdef ENABLE_TUYA_UI   
+        tuya_ai_display_msg(msg->data, msg->datalen, TY_DISPLAY_TP_EMOJI);
+        #endif
+        return 0;
+
+    //! 文本处理显示
+    case AI_PROC_TEXT_START:
+    case AI_PROC_TEXT_DATA:
+    case AI_PROC_TEXT_STOP:
+        ai_toy_text_display(msg->event, msg->data, msg->datalen);
+        return 0;
+
+    default:
+        break;
+    }
+
+    AI_TOY_EVT_T evt = {
+        .src  = TOY_SRC_PROC,
+        .code = (UINT8_T)msg->event,
+    };
+    ai_toy_evq_post(&evt);
 
     return 0;
 }
 
+/**
+ * video frame in-flight queue
+ *
+ * The encoder only guarantees pframe->pbuf for the duration of the put
+ * callback, so the callback copies each I-frame into one of
+ * AI_TOY_VFRAME_SLOTS PSRAM buffers of MAX_INPUT_BUF_SIZE bytes
+ * (MAX_INPUT_RINGBUG_SIZE in total) and returns; a worker thread drains the
+ * filled buffers into the proc layer. When no buffer is free the oldest queued
+ * frame is dropped, frames larger than MAX_INPUT_BUF_SIZE are dropped as they
+ * come. The copy runs outside the critical section: a buffer is owned by
+ * exactly one of the free list, the producer, the queue or the worker.
+ */
+typedef struct {
+    UINT8_T                      idx;           // buffer index
+    UINT_T                       len;
+} ai_toy_vframe_ref_t;
+
+typedef struct {
+    UCHAR_T                     *buf;           // AI_TOY_VFRAME_SLOTS * MAX_INPUT_BUF_SIZE
+    UINT8_T                      free_idx[AI_TOY_VFRAME_SLOTS];
+    UINT8_T                      free_cnt;
+    ai_toy_vframe_ref_t          slot[AI_TOY_VFRAME_SLOTS];
+    UINT8_T                      head;
+    UINT8_T                      tail;
+    UINT8_T                      depth;
+    UINT8_T                      max_depth;
+    UINT_T                       bytes;
+    UINT_T                       enqueued;
+    UINT_T                       dropped;
+    UINT_T                       sent;
+    UINT_T                       send_fail;
+    SEM_HANDLE                   sem;
+    SEM_HANDLE                   done;          // posted by the worker on its way out
+    THREAD_HANDLE                thread;
+    volatile BOOL_T              stopping;
+} ai_toy_vframe_queue_t;
+
+STATIC ai_toy_vframe_queue_t s_vframe_q;
+
+#define VFRAME_BUF(q, idx)              ((q)->buf + (UINT32_T)(idx) * MAX_INPUT_BUF_SIZE)
+
+// caller holds the critical section
+STATIC VOID __vframe_free_put(ai_toy_vframe_queue_t *q, UINT8_T idx)
+{
+    q->free_idx[q->free_cnt++] = idx;
+}
+
+STATIC BOOL_T __vframe_queue_pop(ai_toy_vframe_queue_t *q, ai_toy_vframe_ref_t *ref)
+{
+    BOOL_T got = FALSE;
+
+    TAL_ENTER_CRITICAL();
+    if (q->depth > 0) {
+        *ref = q->slot[q->tail];
+        q->tail = (q->tail + 1) % AI_TOY_VFRAME_SLOTS;
+        q->depth--;
+        q->bytes -= ref->len;
+        got = TRUE;
+    }
+    TAL_EXIT_CRITICAL();
+
+    return got;
+}
+
+STATIC VOID __vframe_queue_release(ai_toy_vframe_queue_t *q, UINT8_T idx)
+{
+    TAL_ENTER_CRITICAL();
+    __vframe_free_put(q, idx);
+    TAL_EXIT_CRITICAL();
+}
+
+/**
+ * @brief take a buffer for a new frame, dropping the oldest queued frame when
+ *        all buffers are in use
+ *
+ * @return BOOL_T FALSE when every buffer is held by the producer or the worker
+ */
+STATIC BOOL_T __vframe_queue_claim(ai_toy_vframe_queue_t *q, UINT8_T *idx)
+{
+    BOOL_T got = TRUE;
+
+    TAL_ENTER_CRITICAL();
+    if (0 == q->free_cnt && q->depth > 0) {
+        q->bytes -= q->slot[q->tail].len;
+        __vframe_free_put(q, q->slot[q->tail].idx);
+        q->tail = (q->tail + 1) % AI_TOY_VFRAME_SLOTS;
+        q->depth--;
+        q->dropped++;
+    }
+    if (q->free_cnt > 0) {
+        *idx = q->free_idx[--q->free_cnt];
+    } else {
+        q->dropped++;
+        got = FALSE;
+    }
+    TAL_EXIT_CRITICAL();
+
+    return got;
+}
+
+STATIC VOID __vframe_queue_push(ai_toy_vframe_queue_t *q, UINT8_T idx, UINT_T len)
+{
+    TAL_ENTER_CRITICAL();
+    q->slot[q->head].idx = idx;
+    q->slot[q->head].len = len;
+    q->head = (q->head + 1) % AI_TOY_VFRAME_SLOTS;
+    q->depth++;
+    q->bytes += len;
+    q->enqueued++;
+    if (q->depth > q->max_depth) {
+        q->max_depth = q->depth;
+    }
+    TAL_EXIT_CRITICAL();
+}
+
+STATIC VOID __vframe_queue_task(VOID_T *arg)
+{
+    ai_toy_vframe_queue_t *q = (ai_toy_vframe_queue_t *)arg;
+    ai_toy_vframe_ref_t ref;
+
+    while (!q->stopping) {
+        tal_semaphore_wait(q->sem, SEM_WAIT_FOREVER);
+        while (!q->stopping && __vframe_queue_pop(q, &ref)) {
+            if (s_ai_toy) {
+                //! video input
+                int rt = ty_ai_proc_event_send(s_ai_toy->llm, AI_PROC_VIDEO_EVENT, (CHAR_T *)VFRAME_BUF(q, ref.idx), ref.len);
+                if (OPRT_OK == rt) {
+                    q->sent++;
+                } else {
+                    q->send_fail++;
+                }
+                TAL_PR_DEBUG("video frame size %d, rt = %d", ref.len, rt);
+            }
+            __vframe_queue_release(q, ref.idx);
+        }
+    }
+    tal_semaphore_post(q->done);
+}
+
+STATIC OPERATE_RET ai_toy_video_queue_init(VOID)
+{
+    OPERATE_RET rt = OPRT_OK;
+
+    if (s_vframe_q.thread) {
+        return OPRT_OK;
+    }
+
+    memset(&s_vframe_q, 0, sizeof(s_vframe_q));
+    s_vframe_q.buf = tkl_system_psram_malloc(AI_TOY_VFRAME_SLOTS * MAX_INPUT_BUF_SIZE);
+    if (NULL == s_vframe_q.buf) {
+        TAL_PR_ERR("video queue malloc failed");
+        return OPRT_MALLOC_FAILED;
+    }
+    for (UINT8_T i = 0; i < AI_TOY_VFRAME_SLOTS; i++) {
+        __vframe_free_put(&s_vframe_q, i);
+    }
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&s_vframe_q.done, 0, 1), __error);
+    TUYA_CALL_ERR_GOTO(tal_semaphore_create_init(&s_vframe_q.sem, 0, AI_TOY_VFRAME_SLOTS), __error);
+
+    THREAD_CFG_T thrd_param = {
+        .stackDepth = 4096,
+        .priority   = THREAD_PRIO_2,
+        .thrdname   = "ai_toy_video",
+    };
+    TUYA_CALL_ERR_GOTO(tal_thread_create_and_start(&s_vframe_q.thread, NULL, NULL, __vframe_queue_task, &s_vframe_q, &thrd_param), __error);
+    return OPRT_OK;
+
+__error:
+    if (s_vframe_q.sem) {
+        tal_semaphore_release(s_vframe_q.sem);
+        s_vframe_q.sem = NULL;
+    }
+    if (s_vframe_q.done) {
+        tal_semaphore_release(s_vframe_q.done);
+        s_vframe_q.done = NULL;
+    }
+    tkl_system_psram_free(s_vframe_q.buf);
+    s_vframe_q.buf = NULL;
+    return rt;
+}
+
+VOID ai_toy_video_queue_dump(VOID)
+{
+    TAL_PR_NOTICE("video queue: depth %d/%d, max %d, bytes %d, enq %d, drop %d, sent %d, fail %d",
+                  s_vframe_q.depth, AI_TOY_VFRAME_SLOTS, s_vframe_q.max_depth, s_vframe_q.bytes,
+                  s_vframe_q.enqueued, s_vframe_q.dropped, s_vframe_q.sent, s_vframe_q.send_fail);
+}
+
+/**
+ * @brief stop the drain thread, queued frames are dropped
+ */
+STATIC VOID ai_toy_video_queue_deinit(VOID)
+{
+    ai_toy_vframe_queue_t *q = &s_vframe_q;
+    SEM_HANDLE sem = q->sem;
+
+    if (NULL == q->thread) {
+        return;
+    }
+    q->stopping = TRUE;
+    tal_semaphore_post(sem);
+    tal_semaphore_wait(q->done, SEM_WAIT_FOREVER);
+
+    // the encoder callback drops every frame once sem is gone
+    TAL_ENTER_CRITICAL();
+    q->sem = NULL;
+    TAL_EXIT_CRITICAL();
+    ai_toy_video_queue_dump();
+    tal_semaphore_release(sem);
+    tal_semaphore_release(q->done);
+    tkl_system_psram_free(q->buf);
+    memset(q, 0, sizeof(ai_toy_vframe_queue_t));
+}
+
 static INT_T ai_toy_h264_cb(TKL_VENC_FRAME_T *pframe)
 {
     if (!s_ai_toy) {
@@ -716,10 +1343,22 @@ static INT_T ai_toy_h264_cb(TKL_VENC_FRAME_T *pframe)
     if (pframe->frametype != TKL_VIDEO_I_FRAME) {
         return 0;
     }
-    //! video input
-    int rt = ty_ai_proc_event_send(s_ai_toy->llm, AI_PROC_VIDEO_EVENT, pframe->pbuf, pframe->buf_size);
 
-    TAL_PR_DEBUG("__h264_cb frame size %d, rt = %d", pframe->buf_size, rt);
+    if (NULL == s_vframe_q.sem || s_vframe_q.stopping || pframe->buf_size > MAX_INPUT_BUF_SIZE) {
+        TAL_ENTER_CRITICAL();
+        s_vframe_q.dropped++;
+        TAL_EXIT_CRITICAL();
+        return 0;
+    }
+
+    //! pbuf is only valid inside this callback: copy it out, never block the encoder
+    UINT8_T idx;
+    if (!__vframe_queue_claim(&s_vframe_q, &idx)) {
+        return 0;
+    }
+    memcpy(VFRAME_BUF(&s_vframe_q, idx), pframe->pbuf, pframe->buf_size);
+    __vframe_queue_push(&s_vframe_q, idx, pframe->buf_size);
+    tal_semaphore_post(s_vframe_q.sem);
 
     return 0;
 }
@@ -737,22 +1376,59 @@ STATIC INT_T _event_ota_fail_cb(VOID_T *data)
 {
     // FIXME: restart system
     TAL_PR_NOTICE("ota fail, restart system...");
+    ai_toy_settings_flush();
     tal_system_reset();
     return 0;
 }
 
 STATIC INT_T _event_reset_cb(VOID_T *data)
 {
-    OPERATE_RET ret = OPRT_OK;
-
-    ret = wd_common_delete(AI_TOY_PARA);
-    TAL_PR_NOTICE("delete key=%s, ret = %d", AI_TOY_PARA, ret);
+    ai_toy_settings_erase();
     return OPRT_OK;
 }
 
+/**
+ * @brief LED strip and status LED for a network status, shared by the live
+ *        callback and replayed network records
+ */
+STATIC VOID __ai_toy_net_leds(GW_WIFI_NW_STAT_E nw_stat)
+{
+    extern uint8_t get_led_count_by_rssi(void);
+
+    switch (nw_stat) {
+    case STAT_UNPROVISION_AP_STA_UNCFG:
+        // LED灯带：配网中 - 绿灯呼吸效果
+        set_led_state(LED_CONFIGURING, 0);
+        // 保留原LED控制
+        tuya_set_led_light_type(s_ai_toy_led, OL_FLASH_LOW, 200, 0xFFFF);
+        break;
+
+    case STAT_STA_DISC:
+        // LED灯带：网络异常 - 红灯长亮
+        //set_led_state(LED_NET_ERROR, 0);
+        // 保留原LED控制
+        tuya_set_led_light_type(s_ai_toy_led, OL_LOW, 200, 0xFFFF);
+        break;
+
+    case STAT_CLOUD_CONN:
+        // LED灯带：连网成功 - 绿灯显示信号强度
+        set_led_state(LED_CONFIG_SUCCESS, get_led_count_by_rssi());
+        // 保留原LED控制
+        tuya_set_led_light_type(s_ai_toy_led, OL_HIGH, 200, 0xFFFF);
+        break;
+
+    default:
+        break;
+    }
+}
+
 STATIC VOID _wf_nw_stat_cb(GW_WIFI_NW_STAT_E nw_stat)
 {
+    AI_TOY_EVT_T trace_evt = {.src = TOY_SRC_NET, .code = (UINT8_T)nw_stat};
+    ai_toy_evtrace_record(&trace_evt);
+
     // get language type: 0: chinese, 1: english
+    UINT8_T lang = s_lang;
     CHAR_T *region = get_gw_region();
     if (0 == strlen(region)) {
         CHAR_T ccode[COUNTRY_CODE_LEN] = {0};
@@ -769,16 +1445,16 @@ STATIC VOID _wf_nw_stat_cb(GW_WIFI_NW_STAT_E nw_stat)
         #endif
         TAL_PR_DEBUG("network status = %d, region %s, language %d", nw_stat, region, s_lang);
     }
-    TY_AI_TOY_T *ctx = s_ai_toy;
-    if (ctx) {
-        ctx->nw_stat = nw_stat;
+    if (lang != s_lang) {
+        __ai_toy_alert_cache_prefetch();
     }
+    ai_toy_netstat_set(nw_stat);
 
     uint8_t net_stat = 0;
 
     STATIC BOOL_T report_flag = FALSE;
-    if (nw_stat == STAT_CLOUD_CONN && !report_flag) {
-        _report_sysinfo();
+    if (nw_stat == STAT_CLOUD_CONN && !report_flag && s_ai_toy) {
+        _report_sysinfo(s_ai_toy->volume);
     }
 
     switch (nw_stat) {
@@ -790,32 +1466,20 @@ STATIC VOID _wf_nw_stat_cb(GW_WIFI_NW_STAT_E nw_stat)
         tuya_ai_display_msg(NULL, 0, TY_DISPLAY_TP_STAT_NETCFG);
         tuya_ai_display_msg(&net_stat, 1, TY_DISPLAY_TP_STAT_NET);
         #endif
-        // LED灯带：配网中 - 绿灯呼吸效果
-        set_led_state(LED_CONFIGURING, 0);
-        // 保留原LED控制
-        tuya_set_led_light_type(s_ai_toy_led, OL_FLASH_LOW, 200, 0xFFFF);
         break;
 
     case STAT_STA_DISC:
         #ifdef ENABLE_TUYA_UI   
         tuya_ai_display_msg(&net_stat, 1, TY_DISPLAY_TP_STAT_NET);
         #endif
-        // LED灯带：网络异常 - 红灯长亮
-        //set_led_state(LED_NET_ERROR, 0);
-        // 保留原LED控制
-        tuya_set_led_light_type(s_ai_toy_led, OL_LOW, 200, 0xFFFF);
         break;
 
     case STAT_CLOUD_CONN:
         net_stat = 1;
         tuya_ai_display_msg(&net_stat, 1, TY_DISPLAY_TP_STAT_NET);
-        // LED灯带：连网成功 - 绿灯显示信号强度
-        extern uint8_t get_led_count_by_rssi(void);
-        set_led_state(LED_CONFIG_SUCCESS, get_led_count_by_rssi());
-        // 保留原LED控制
-        tuya_set_led_light_type(s_ai_toy_led, OL_HIGH, 200, 0xFFFF);
         break;
     }
+    __ai_toy_net_leds(nw_stat);
 }
 
 STATIC INT_T _event_netcfg_err_cb(VOID_T *data)
@@ -828,6 +1492,14 @@ STATIC INT_T _event_netcfg_err_cb(VOID_T *data)
     return 0;
 }
 
+STATIC VOID __ai_toy_connected_alert(VOID *arg)
+{
+    ty_ai_toy_alert(TOY_ALERT_TYPE_NETWORK_CONNECTED, TRUE);
+    #ifdef ENABLE_TUYA_UI   
+    tuya_ai_display_msg(NULL, 0, TY_DISPLAY_TP_STAT_ONLINE);
+    #endif
+}
+
 STATIC INT_T _event_clinet_run(VOID_T *data)
 {
     TAL_PR_NOTICE("connected to server");
@@ -839,64 +1511,30 @@ STATIC INT_T _event_clinet_run(VOID_T *data)
     };
     dev_report_dp_json_async_force(NULL, &dp, 2);
     extern uint8_t get_led_count_by_rssi(void);
-    // set led state by rssi
+    // refresh the cached rssi once, then set led state by it
+    SCHAR_T rssi = ai_toy_netstat_rssi_sample();
     set_led_state(LED_CONFIG_SUCCESS, get_led_count_by_rssi());
-    SCHAR_T rssi;
-    tkl_wifi_station_get_conn_ap_rssi(&rssi);
     TAL_PR_DEBUG("alexwifi rssi %d\r\n", rssi); 
 
-    tal_system_sleep(500);
-    ty_ai_toy_alert(TOY_ALERT_TYPE_NETWORK_CONNECTED, TRUE);
-    #ifdef ENABLE_TUYA_UI   
-    tuya_ai_display_msg(NULL, 0, TY_DISPLAY_TP_STAT_ONLINE);
-    #endif
+    // let the LED show settle before the prompt, without holding the event thread
+    if (OPRT_OK != ai_toy_wheel_defer(TOY_CONNECTED_ALERT_DELAY, __ai_toy_connected_alert, NULL)) {
+        __ai_toy_connected_alert(NULL);
+    }
 
     TAL_PR_DEBUG("lowpower_timer start");
-    tal_sw_timer_start(s_ai_toy->lowpower_timer, TOY_DEEPSLEEP_TIMEOUT, TAL_TIMER_ONCE);
+    ai_toy_wheel_arm(&s_ai_toy->lowpower_timer, ai_toy_power_lowpower_timeout());
     return 0;
 }
 
 STATIC OPERATE_RET __ai_toy_config_load(TY_AI_TOY_T *ai_toy)
 {
-    OPERATE_RET rt = OPRT_OK;
-    BYTE_T *value = NULL;
-    UINT_T len = 0;
-
     // set default volume first
     ai_toy->volume = TY_SPK_DEFAULT_VOL;
 
-    // read volume from kv
-    TUYA_CALL_ERR_RETURN(wd_common_read(AI_TOY_PARA, &value, &len));
-    // parse volume {"volume": 70}
-    TAL_PR_DEBUG("read ai_toy config: %s", value);
-    cJSON *root = ty_cJSON_Parse((CONST CHAR_T *)value);
-    wd_common_free_data(value);
-    if (root == NULL) {
-        TAL_PR_ERR("parse ai_toy config fail");
-        return -1;
-    }
-    cJSON *child = ty_cJSON_GetObjectItem(root, "volume");
-    if (child == NULL) {
-        TAL_PR_ERR("parse volume fail");
-        // default volume
-        // save volume to kv
-        CHAR_T *value = ty_cJSON_Print(root);
-        rt = wd_common_write(AI_TOY_PARA, (CONST BYTE_T *)value, strlen(value));
-        ty_cJSON_FreeBuffer(value);
-        if (rt != OPRT_OK) {
-            TAL_PR_ERR("save volume to kv fail");
-            ty_cJSON_Delete(root);
-            return rt;
-        }
-    }
-    if (child->valueint <= 100 && child->valueint >= 0) {
-        ai_toy->volume = child->valueint;
-    }
-    ty_cJSON_Delete(root);
-    return OPRT_OK;
+    return ai_toy_settings_load(&ai_toy->volume);
 }
 
-STATIC OPERATE_RET _report_sysinfo(VOID)
+STATIC OPERATE_RET _report_sysinfo(UINT8_T volume)
 {
     // report volume dp to cloud
     TAL_PR_DEBUG("report volume dp to cloud");
@@ -904,64 +1542,164 @@ STATIC OPERATE_RET _report_sysinfo(VOID)
     TY_OBJ_DP_S dp = {
         .dpid = 3,
         .type = PROP_VALUE,
-        .value.dp_value = s_ai_toy->volume,
+        .value.dp_value = volume,
     };
     return tuya_report_dp_async(devid, &dp, 1, NULL);
 }
 
+/**
+ * @brief a settings window closed: the volume is in flash, report it once
+ *
+ * Runs on the wheel thread, so only the flushed volume is reported, never
+ * s_ai_toy->volume, which the worker may be changing.
+ */
+STATIC VOID __ai_toy_settings_flushed(UINT8_T volume, UINT32_T report_mask)
+{
+    if (report_mask & TOY_REPORT_DP_VOLUME_CAP) {
+        TY_OBJ_DP_S dp = {
+            .dpid = 107,
+            .type = PROP_VALUE,
+            .value.dp_value = volume,
+            .time_stamp = 0,
+        };
+        dev_report_dp_json_async_force(NULL, &dp, 1);
+    }
+    if (report_mask & TOY_REPORT_DP_VOLUME) {
+        _report_sysinfo(volume);
+    }
+}
+
+#if defined(AI_TOY_EVTRACE_DPID) && AI_TOY_EVTRACE_ENABLE
+#define TOY_EVTRACE_CMD_STOP            0
+#define TOY_EVTRACE_CMD_RECORD          1
+#define TOY_EVTRACE_CMD_DUMP            2   // log the trace as EVTRACE hex lines
+#define TOY_EVTRACE_CMD_REPLAY          3   // recorded timing
+#define TOY_EVTRACE_CMD_REPLAY_FAST     4   // back to back, stresses the worker
+
+/**
+ * @brief put a recorded event back where its callback would have put it
+ *
+ * Every record is posted, flagged TOY_EVT_FLAG_REPLAY. Audio payloads are not
+ * recorded, the staged frame is silence of the same length. While a replay
+ * runs the worker drops the live idle and lowpower fires and takes the
+ * recorded ones, see __ai_toy_evt_handle(). Network records show their LEDs only, volume DP
+ * records show their level only: a replay never plays the network alerts,
+ * changes the real volume or reports either.
+ */
+STATIC VOID __ai_toy_replay_feed(CONST AI_TOY_EVT_T *evt, VOID *arg)
+{
+    AI_TOY_EVT_T e = *evt;
+
+    e.flags |= TOY_EVT_FLAG_REPLAY;
+    switch (e.src) {
+    case TOY_SRC_TIMER:
+        // the live timer posts are critical too
+        ai_toy_evq_post_critical(&e);
+        return;
+    case TOY_SRC_KEY:
+        // the replay stands in for the key callback
+        e.stamp_us = (UINT32_T)AI_TOY_TRACE_NOW_US();
+        break;
+    case TOY_SRC_RECORDER:
+        // the replay stands in for the recorder callback
+        e.stamp_us = (UINT32_T)AI_TOY_TRACE_NOW_US();
+        if (e.arg2 && OPRT_OK != __audio_stage_put(NULL, e.arg2, &e.arg)) {
+            e.arg2 = 0;
+        }
+        break;
+    default:
+        break;
+    }
+    ai_toy_evq_post(&e);
+}
+
+STATIC VOID __ai_toy_replay_done(VOID *arg)
+{
+    AI_TOY_EVQ_STAT_T evq;
+
+    ai_toy_evq_stat_get(&evq);
+    TAL_PR_NOTICE("replay evq: posted %d handled %d full %d (critical %d) reserved %d max depth %d",
+                  evq.posted, evq.handled, evq.full, evq.full_critical, evq.reserved, evq.max_depth);
+    ai_toy_latency_dump();
+    ai_toy_trace_dump();
+}
+
+STATIC VOID __ai_toy_evtrace_cmd(UINT32_T cmd)
+{
+    OPERATE_RET rt = OPRT_OK;
+    AI_TOY_EVTRACE_REPLAY_CFG_T cfg = {
+        .feed = __ai_toy_replay_feed,
+        .done = __ai_toy_replay_done,
+        .speed_pct = (TOY_EVTRACE_CMD_REPLAY == cmd) ? 100 : 0,
+    };
+
+    switch (cmd) {
+    case TOY_EVTRACE_CMD_STOP:
+        ai_toy_evtrace_stop();
+        break;
+    case TOY_EVTRACE_CMD_RECORD:
+        TUYA_CALL_ERR_LOG(ai_toy_evtrace_start());
+        break;
+    case TOY_EVTRACE_CMD_DUMP:
+        ai_toy_evtrace_stop();
+        ai_toy_evtrace_dump();
+        break;
+    case TOY_EVTRACE_CMD_REPLAY:
+    case TOY_EVTRACE_CMD_REPLAY_FAST:
+        TUYA_CALL_ERR_LOG(ai_toy_evtrace_replay(&cfg));
+        break;
+    default:
+        break;
+    }
+}
+#endif
+
 VOID ty_ai_toy_dp_cmd_cb(IN CONST TY_RECV_OBJ_DP_S *dp)
 {
     for (UINT_T index = 0; index < dp->dps_cnt; index++) {
-        // handle dp id = 3
-        if (dp->dps[index].dpid == 3 && dp->dps[index].type == PROP_VALUE) {
+        // volume dps change toy state, the worker applies them
+        if ((dp->dps[index].dpid == 3 || dp->dps[index].dpid == 107) && dp->dps[index].type == PROP_VALUE) {
             TAL_PR_DEBUG("SOC Rev DP Obj Cmd dpid:%d type:%d value:%d", dp->dps[index].dpid, dp->dps[index].type, dp->dps[index].value.dp_value);
-            if (dp->dps[index].value.dp_value <= 100 && dp->dps[index].value.dp_value >= 0 && s_ai_toy->volume != dp->dps[index].value.dp_value) {
-                // update cfg
-                s_ai_toy->volume = dp->dps[index].value.dp_value;
-                CHAR_T buf[32] = {0};
-                snprintf(buf, sizeof(buf), "{\"volume\": %d}", s_ai_toy->volume);
-                wd_common_write(AI_TOY_PARA, (CONST BYTE_T *)buf, strlen(buf));
-                tkl_ao_set_vol(TKL_AUDIO_TYPE_BOARD, TKL_AO_0, NULL, s_ai_toy->volume);
-                #ifdef ENABLE_TUYA_UI   
-                tuya_ai_display_msg(&s_ai_toy->volume, 1, TY_DISPLAY_TP_VOLUME);
-                #endif
-                _report_sysinfo();
-            }
+            AI_TOY_EVT_T evt = {
+                .src  = TOY_SRC_DP,
+                .code = (UINT8_T)dp->dps[index].dpid,
+                .arg  = (UINT32_T)dp->dps[index].value.dp_value,
+            };
+            ai_toy_evq_post(&evt);
         }
-        else if (dp->dps[index].dpid == 107 && dp->dps[index].type == PROP_VALUE) {
-            TAL_PR_DEBUG("SOC Rev DP Obj Cmd dpid:%d type:%d value:%d", dp->dps[index].dpid, dp->dps[index].type, dp->dps[index].value.dp_enum);
-            if (dp->dps[index].value.dp_value <= 100 && dp->dps[index].value.dp_value >= 0 && s_ai_toy->volume != dp->dps[index].value.dp_value) {
-                s_ai_toy->volume = dp->dps[index].value.dp_value;
-                TAL_PR_DEBUG("volume %d", s_ai_toy->volume);
-                
-                // LED灯带显示音量等级 - 只在已配网状态下响应
-                GW_WIFI_NW_STAT_E cur_nw_stat = 0;
-                get_wf_gw_nw_status(&cur_nw_stat);
-                if (cur_nw_stat != STAT_UNPROVISION_AP_STA_UNCFG) {
-                    // 将音量0-100映射到0-12级
-                    uint8_t volume_level = (s_ai_toy->volume * 12) / 100;
-                    if (volume_level > 12) volume_level = 12;
-                    set_led_state(LED_VOLUME, volume_level);
-                }
-                
-                 #ifdef ENABLE_TUYA_UI   
-                tuya_ai_display_msg(&s_ai_toy->volume, 1, TY_DISPLAY_TP_VOLUME);
-                #endif
-                CHAR_T buf[32] = {0};
-                snprintf(buf, sizeof(buf), "{\"volume\": %d}", s_ai_toy->volume);
-                wd_common_write(AI_TOY_PARA, (CONST BYTE_T *)buf, strlen(buf));
-                tkl_ao_set_vol(TKL_AUDIO_TYPE_BOARD, TKL_AO_0, NULL, s_ai_toy->volume);
-                dev_report_dp_json_async_force(NULL, &dp->dps[index], 2);
-                
-                /* TY_OBJ_DP_S volume_cap_dp_info[2];
-                volume_cap_dp_info[1].dpid = dp->dps[index].dpid;
-                volume_cap_dp_info[1].type = PROP_VALUE;
-                volume_cap_dp_info[1].value.dp_enum = s_ai_toy->volume;
-                volume_cap_dp_info[1].time_stamp = 0; 
-                dev_report_dp_json_async_force(NULL, &volume_cap_dp_info, 2);*/
-                _report_sysinfo();
+#if defined(AI_TOY_SIGNAL_METER_DPID)
+        // installer signal meter: live wifi level on the LED ring
+        else if (dp->dps[index].dpid == AI_TOY_SIGNAL_METER_DPID && dp->dps[index].type == PROP_BOOL) {
+            TAL_PR_DEBUG("SOC Rev DP Obj Cmd dpid:%d type:%d value:%d", dp->dps[index].dpid, dp->dps[index].type, dp->dps[index].value.dp_bool);
+            ai_toy_netstat_meter_set(dp->dps[index].value.dp_bool);
+            dev_report_dp_json_async_force(NULL, &dp->dps[index], 1);
+        }
+#endif
+#if defined(AI_TOY_LED_STATS_DPID)
+        // debug: any write logs the LED driver counters and reports them as JSON
+        else if (dp->dps[index].dpid == AI_TOY_LED_STATS_DPID) {
+            CHAR_T buf[LED_STATS_JSON_MAX];
+            led_controller_stats_dump();
+            if (led_controller_stats_json(buf, sizeof(buf)) < 0) {
+                TAL_PR_ERR("led stats json truncated");
+                continue;
             }
+            TY_OBJ_DP_S stats_dp = {
+                .dpid = AI_TOY_LED_STATS_DPID,
+                .type = PROP_STR,
+                .value.dp_str = buf,
+            };
+            tuya_report_dp_async(tuya_iot_get_gw_id(), &stats_dp, 1, NULL);
+        }
+#endif
+#if defined(AI_TOY_EVTRACE_DPID) && AI_TOY_EVTRACE_ENABLE
+        // debug: record, dump or replay the worker event trace
+        else if (dp->dps[index].dpid == AI_TOY_EVTRACE_DPID && dp->dps[index].type == PROP_VALUE) {
+            TAL_PR_DEBUG("SOC Rev DP Obj Cmd dpid:%d type:%d value:%d", dp->dps[index].dpid, dp->dps[index].type, dp->dps[index].value.dp_value);
+            __ai_toy_evtrace_cmd((UINT32_T)dp->dps[index].value.dp_value);
+            dev_report_dp_json_async_force(NULL, &dp->dps[index], 1);
         }
+#endif
     }
 }
 
@@ -1072,6 +1810,8 @@ OPERATE_RET ty_ai_toy_hardware_init(TY_AI_TOY_T *ai_toy, TY_AI_TOY_CFG_T *cfg)
 
 VOID_T tuya_ai_camera_init(VOID_T)
 {
+    TUYA_CALL_ERR_LOG(ai_toy_video_queue_init());
+
     TKL_VENC_CONFIG_T h264_config;
     // DVP:0, UVC:1
     h264_config.enable_h264_pipeline = 0; // dvp
@@ -1103,19 +1843,29 @@ VOID_T tuya_ai_camera_init(VOID_T)
 }
 
 
-STATIC VOID ai_toy_idle_timer(TIMER_ID timer_id, VOID_T *arg)
+STATIC VOID __ai_toy_idle_handle(TY_AI_TOY_T *ctx, UINT32_T gen)
 {
-    TY_AI_TOY_T *ctx = (TY_AI_TOY_T *)arg;
+    // cancelled or re-armed after it fired, or the toy left LISTEN meanwhile
+    if (!ai_toy_wheel_gen_current(&ctx->idle_timer, gen) || AI_TOY_LISTEN != ctx->state || ctx->vad_active) {
+        TAL_PR_DEBUG("stale idle timer, state %d", ctx->state);
+        return;
+    }
     TAL_PR_NOTICE("ai proc ai_toy_idle_timer");
 
     //! 需要重新唤醒
      if (!tuya_speaker_service_is_playing() && !tuya_speaker_service_tone_is_playing()) {
+        ai_toy_power_listen_expired();
         audio_recorder_stop();
     } else {
-        tal_sw_timer_start(ctx->idle_timer, TOY_IDLE_TIMEOUT, TAL_TIMER_ONCE);
+        ai_toy_wheel_arm(&ctx->idle_timer, ai_toy_power_listen_timeout());
     }
 }
 
+STATIC VOID __ai_toy_deepsleep_enter(VOID *arg)
+{
+    tal_cpu_sleep_mode_set(1, TUYA_CPU_DEEP_SLEEP);
+}
+
 static void __set_wakeup_source(uint32_t pin)
 {
     TAL_PR_NOTICE("ai proc ai_toy_lowpower_timer pin %d", pin);
@@ -1130,21 +1880,38 @@ static void __set_wakeup_source(uint32_t pin)
     cfg.wakeup_para.gpio_param.gpio_num = pin;
     cfg.wakeup_para.gpio_param.level = TUYA_GPIO_WAKEUP_RISE;
     tkl_wakeup_source_set(&cfg);
-    tal_system_sleep(200);
 }
 
-STATIC VOID ai_toy_lowpower_timer(TIMER_ID timer_id, VOID_T *arg)
+STATIC VOID __ai_toy_lowpower_handle(TY_AI_TOY_T *ctx, UINT32_T gen, BOOL_T replay)
 {
+    // a wake or a new dialog cancelled the timer after it fired
+    if (!ai_toy_wheel_gen_current(&ctx->lowpower_timer, gen) || AI_TOY_IDLE != ctx->state) {
+        TAL_PR_DEBUG("stale lowpower timer, state %d", ctx->state);
+        return;
+    }
+    // powering down would end the replay, the rest of the trace runs awake
+    if (replay) {
+        TAL_PR_NOTICE("replay: lowpower entry skipped");
+        return;
+    }
 #ifdef TY_AI_DEFAULT_LOWP_MODE    
     OPERATE_RET rt = OPRT_OK;
     TAL_PR_NOTICE("ai proc ai_toy_lowpower_timer"); 
+    ai_toy_settings_flush();
+    ai_toy_power_state_set(AI_TOY_PWR_LOWPOWER);
+    ai_toy_power_dump();
+    ai_toy_wake_dump();
     if (TY_AI_DEFAULT_LOWP_MODE == TUYA_CPU_DEEP_SLEEP) {
 
         // set wakeup source
-        __set_wakeup_source(s_ai_toy->cfg.audio_trigger_pin);
+        __set_wakeup_source(ctx->cfg.audio_trigger_pin);
 
-        // enter deepsleep status
-        tal_cpu_sleep_mode_set(1, TUYA_CPU_DEEP_SLEEP);
+        // enter deepsleep status once the wakeup gpio has settled, the
+        // worker keeps draining events meanwhile
+        if (OPRT_OK != ai_toy_wheel_defer(TOY_WAKEUP_SETTLE_DELAY, __ai_toy_deepsleep_enter, NULL)) {
+            tal_system_sleep(TOY_WAKEUP_SETTLE_DELAY);
+            __ai_toy_deepsleep_enter(NULL);
+        }
     } else if (TY_AI_DEFAULT_LOWP_MODE == TUYA_CPU_SLEEP) {
         // close battery report
         #if defined(TUYA_AI_TOY_BATTERY_ENABLE) && (TUYA_AI_TOY_BATTERY_ENABLE == 1)
@@ -1152,100 +1919,250 @@ STATIC VOID ai_toy_lowpower_timer(TIMER_ID timer_id, VOID_T *arg)
         #endif        
         
         // close PA
-        tkl_gpio_write(s_ai_toy->cfg.spk_en_pin, TUYA_GPIO_LEVEL_LOW);
-        tkl_gpio_write(s_ai_toy->cfg.led_pin, TUYA_GPIO_LEVEL_LOW);
+        tkl_gpio_write(ctx->cfg.spk_en_pin, TUYA_GPIO_LEVEL_LOW);
+        tkl_gpio_write(ctx->cfg.led_pin, TUYA_GPIO_LEVEL_LOW);
 
         // close LCD
         tkl_disp_set_brightness(NULL, 0);
 
         // enter keep-alive status
+        // stop background rssi sampling, it would wake the radio
+        ai_toy_netstat_lowpower_set(TRUE);
+        // blank the ring and power down its SPI, the last frame is kept
+        led_controller_suspend();
         rt = tal_cpu_lp_enable();
         rt |= tal_wifi_lp_enable();
-        s_ai_toy->lp_stat = TRUE;
+        ctx->lp_stat = TRUE;
         TAL_PR_DEBUG("tal_cpu_lp_enable rt=%d", rt);  
     }
 #endif
 }
 
-OPERATE_RET ty_ai_toy_alert(TY_AI_TOY_ALERT_TYPE type, BOOL_T send_eof)
+// arg carries the arm generation, the worker drops the event once it is stale
+STATIC VOID ai_toy_idle_timer(VOID *arg)
 {
-    OPERATE_RET ret = OPRT_OK;
+    TY_AI_TOY_T *toy = (TY_AI_TOY_T *)arg;
+    AI_TOY_EVT_T evt = {.src = TOY_SRC_TIMER, .code = TOY_TIMER_IDLE, .arg = ai_toy_wheel_fired_gen(&toy->idle_timer)};
+    ai_toy_evq_post_critical(&evt);
+}
 
-    TAL_PR_DEBUG("toy alert type=%d", type);
-    CONST CHAR_T *audio_data = NULL;
-    UINT32_T audio_size = 0;
+STATIC VOID ai_toy_lowpower_timer(VOID *arg)
+{
+    TY_AI_TOY_T *toy = (TY_AI_TOY_T *)arg;
+    AI_TOY_EVT_T evt = {.src = TOY_SRC_TIMER, .code = TOY_TIMER_LOWPOWER, .arg = ai_toy_wheel_fired_gen(&toy->lowpower_timer)};
+    ai_toy_evq_post_critical(&evt);
+}
 
-    switch (type) {
-    case TOY_ALERT_TYPE_POWER_ON:
-        audio_data = (s_lang == 0) ? media_src_prologue_zh : media_src_prologue_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_prologue_zh) : sizeof(media_src_prologue_en);     
-        break;
+/**
+ * @brief volume from the app: dp 3 sets it, dp 107 also shows the level on the LED ring;
+ *        a replayed record only shows the level
+ */
+STATIC VOID __ai_toy_dp_handle(TY_AI_TOY_T *toy, UINT8_T dpid, INT_T value, BOOL_T replay)
+{
+    if (value > 100 || value < 0 || (!replay && toy->volume == value)) {
+        return;
+    }
 
-    case TOY_ALERT_TYPE_NOT_ACTIVE:
-        audio_data = (s_lang == 0) ? media_src_network_conn_zh : media_src_network_conn_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_network_conn_zh) : sizeof(media_src_network_conn_en);
-        break;
-        
-    case TOY_ALERT_TYPE_NETWORK_CFG:
-        audio_data = (s_lang == 0) ? media_src_network_config_zh : media_src_network_config_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_network_config_zh) : sizeof(media_src_network_config_en);   
-        break;
+    // LED灯带显示音量等级 - 只在已配网状态下响应
+    if (107 == dpid && ai_toy_netstat_is_provisioned()) {
+        // 将音量0-100映射到0-12级
+        uint8_t volume_level = (value * 12) / 100;
+        if (volume_level > 12) volume_level = 12;
+        set_led_state(LED_VOLUME, volume_level);
+    }
+    if (replay) {
+        TAL_PR_DEBUG("replay: volume %d not applied", value);
+        return;
+    }
 
-    case TOY_ALERT_TYPE_NETWORK_CONNECTED:
-        audio_data = (s_lang == 0) ? media_src_network_conn_success_zh : media_src_network_conn_success_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_network_conn_success_zh) : sizeof(media_src_network_conn_success_en);   
-        break;
+    // update cfg
+    toy->volume = (UINT8_T)value;
+    TAL_PR_DEBUG("volume %d", toy->volume);
 
-    case TOY_ALERT_TYPE_NETWORK_FAIL:
-        audio_data = (s_lang == 0) ? media_src_network_conn_failed_zh : media_src_network_conn_failed_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_network_conn_failed_zh) : sizeof(media_src_network_conn_failed_en);  
-        break;
+    #ifdef ENABLE_TUYA_UI   
+    tuya_ai_display_msg(&toy->volume, 1, TY_DISPLAY_TP_VOLUME);
+    #endif
+    tkl_ao_set_vol(TKL_AUDIO_TYPE_BOARD, TKL_AO_0, NULL, toy->volume);
+    // kv write and report are batched per settings window, dp 107 is echoed too
+    ai_toy_settings_volume_set(toy->volume, (107 == dpid) ? (TOY_REPORT_DP_VOLUME | TOY_REPORT_DP_VOLUME_CAP) : TOY_REPORT_DP_VOLUME);
+}
 
-    case TOY_ALERT_TYPE_NETWORK_DISCONNECT:
-        audio_data = (s_lang == 0) ? media_src_network_reconfigure_zh : media_src_network_reconfigure_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_network_reconfigure_zh) : sizeof(media_src_network_reconfigure_en);
-        break;
-    case TOY_ALERT_TYPE_BATTERY_LOW:
-        audio_data = (s_lang == 0) ? media_src_low_battery_zh : media_src_low_battery_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_low_battery_zh) : sizeof(media_src_low_battery_en);
-        break;
+/**
+ * @brief a replayed timer fire in place of the live one: cancel the armed
+ *        timer so it cannot fire again after the replay, and hand out the
+ *        generation the cancel made current
+ */
+STATIC UINT32_T __ai_toy_replay_timer_gen(AI_TOY_WHEEL_TIMER_T *timer)
+{
+    ai_toy_wheel_cancel(timer);
+    return timer->gen;
+}
+
+/**
+ * @brief toy worker, the only thread that reads or writes TY_AI_TOY_T state
+ */
+STATIC VOID __ai_toy_evt_handle(CONST AI_TOY_EVT_T *evt, VOID *arg)
+{
+    TY_AI_TOY_T *toy = (TY_AI_TOY_T *)arg;
+    BOOL_T replay = (evt->flags & TOY_EVT_FLAG_REPLAY) ? TRUE : FALSE;
+    UINT32_T gen = evt->arg;
 
-    case TOY_ALERT_TYPE_PLEASE_AGAIN:
-        audio_data = (s_lang == 0) ? media_src_please_again_zh : media_src_please_again_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_please_again_zh) : sizeof(media_src_please_again_en);
+    switch (evt->src) {
+    case TOY_SRC_RECORDER:
+        __ai_toy_recorder_handle(toy, evt);
         break;
-        
-    case TOY_ALART_TYPE_WAKEUP:
-        audio_data = (s_lang == 0) ? media_src_ai_zh : media_src_ai_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_ai_zh) : sizeof(media_src_ai_en);
+    case TOY_SRC_PROC:
+        __ai_toy_proc_handle(toy, evt->code);
         break;
-
-    case TOY_ALART_TYPE_LONG_KEY_TALK:
-        audio_data = (s_lang == 0) ? media_src_long_press_zh : media_src_long_press_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_long_press_zh) : sizeof(media_src_long_press_en);    
+    case TOY_SRC_PLAYER:
+        __ai_toy_player_handle(toy, evt->code, (INT_T)evt->arg, (evt->flags & TOY_EVT_FLAG_ALERT) ? TRUE : FALSE);
         break;
-
-    case TOY_ALART_TYPE_KEY_TALK:
-        audio_data = (s_lang == 0) ? media_src_press_talk_zh : media_src_press_talk_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_press_talk_zh) : sizeof(media_src_press_talk_en); 
+    case TOY_SRC_KEY:
+        __ai_toy_key_handle(evt->arg, (PUSH_KEY_TYPE_E)evt->code, (INT_T)evt->arg2, evt->stamp_us);
         break;
-
-    case TOY_ALART_TYPE_WAKEUP_TALK:
-        audio_data = (s_lang == 0) ? media_src_wakeup_chat_zh : media_src_wakeup_chat_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_wakeup_chat_zh) : sizeof(media_src_wakeup_chat_en); 
+    case TOY_SRC_TIMER:
+        // a replay owns the idle and lowpower timers: live fires are dropped,
+        // a recorded one stands in for the armed timer and takes its generation.
+        // The wake resume is posted again by the replayed wake, only the live one runs.
+        if (TOY_TIMER_WAKE_RESUME == evt->code) {
+            if (replay) {
+                break;
+            }
+        } else if (replay) {
+            gen = __ai_toy_replay_timer_gen((TOY_TIMER_IDLE == evt->code) ? &toy->idle_timer : &toy->lowpower_timer);
+        } else if (ai_toy_evtrace_replaying()) {
+            TAL_PR_DEBUG("replay: live timer %d dropped", evt->code);
+            break;
+        }
+        if (TOY_TIMER_IDLE == evt->code) {
+            __ai_toy_idle_handle(toy, gen);
+        } else if (TOY_TIMER_WAKE_RESUME == evt->code) {
+            __ai_toy_wake_background(toy);
+        } else {
+            __ai_toy_lowpower_handle(toy, gen, replay);
+        }
         break;
-        
-    case TOY_ALART_TYPE_RANDOM_TALK:
-        audio_data = (s_lang == 0) ? media_src_free_chat_zh : media_src_free_chat_en;
-        audio_size = (s_lang == 0) ? sizeof(media_src_free_chat_zh) : sizeof(media_src_free_chat_en); 
+    case TOY_SRC_NET:
+        // live records never reach the queue
+        if (replay) {
+            __ai_toy_net_leds((GW_WIFI_NW_STAT_E)evt->code);
+        }
+        break;
+    case TOY_SRC_DP:
+        __ai_toy_dp_handle(toy, evt->code, (INT_T)evt->arg, replay);
         break;
     default:
+        break;
+    }
+}
+
+/**
+ * alert asset table
+ *
+ * One row per alert type, one column per language. Every row is generated
+ * from AI_TOY_LANG_LIST, which pastes the language suffix onto the row's
+ * media_src base name, so each row has every language column by construction.
+ * Adding a language is a one-line change to AI_TOY_LANG_LIST plus the new
+ * media_src_*_xx blobs; a missing blob is a build error. Rows are positional:
+ * each AI_TOY_ALERT_LIST entry gets its index from a generated enum and is
+ * checked against its alert type at build time, so a duplicate, missing or
+ * reordered entry does not compile.
+ */
+#define AI_TOY_LANG_LIST(X, base) \
+    X(AI_TOY_LANG_ZH,   base, zh) \
+    X(AI_TOY_LANG_EN,   base, en)
+
+// column index, matches s_lang: 0 for CN, TY_AI_DEFAULT_LANG (english) otherwise
+#define AI_TOY_LANG_ENUM(lang, base, sfx)   lang,
+enum {
+    AI_TOY_LANG_LIST(AI_TOY_LANG_ENUM, )
+    AI_TOY_LANG_CNT
+};
+
+// last value of TY_AI_TOY_ALERT_TYPE in tuya_ai_toy.h
+#define AI_TOY_ALERT_TYPE_LAST          TOY_ALART_TYPE_RANDOM_TALK
+
+typedef struct {
+    CONST CHAR_T                *data;
+    UINT32_T                     size;
+} ai_toy_alert_asset_t;
+
+#define AI_TOY_ALERT_ASSET(name)        { (CONST CHAR_T *)(name), sizeof(name) }
+#define AI_TOY_ALERT_LANG(lang, base, sfx)  [lang] = AI_TOY_ALERT_ASSET(base##_##sfx),
+
+#define AI_TOY_ALERT_LIST(X) \
+    X(TOY_ALERT_TYPE_POWER_ON,              media_src_prologue) \
+    X(TOY_ALERT_TYPE_NOT_ACTIVE,            media_src_network_conn) \
+    X(TOY_ALERT_TYPE_NETWORK_CFG,           media_src_network_config) \
+    X(TOY_ALERT_TYPE_NETWORK_CONNECTED,     media_src_network_conn_success) \
+    X(TOY_ALERT_TYPE_NETWORK_FAIL,          media_src_network_conn_failed) \
+    X(TOY_ALERT_TYPE_NETWORK_DISCONNECT,    media_src_network_reconfigure) \
+    X(TOY_ALERT_TYPE_BATTERY_LOW,           media_src_low_battery) \
+    X(TOY_ALERT_TYPE_PLEASE_AGAIN,          media_src_please_again) \
+    X(TOY_ALART_TYPE_WAKEUP,                media_src_ai) \
+    X(TOY_ALART_TYPE_LONG_KEY_TALK,         media_src_long_press) \
+    X(TOY_ALART_TYPE_KEY_TALK,              media_src_press_talk) \
+    X(TOY_ALART_TYPE_WAKEUP_TALK,           media_src_wakeup_chat) \
+    X(TOY_ALART_TYPE_RANDOM_TALK,           media_src_free_chat)
+
+// position of each entry in AI_TOY_ALERT_LIST, a duplicate entry redeclares its enumerator
+#define AI_TOY_ALERT_IDX(type, base)    AI_TOY_ALERT_IDX_##type,
+enum {
+    AI_TOY_ALERT_LIST(AI_TOY_ALERT_IDX)
+    AI_TOY_ALERT_CNT
+};
+
+#define AI_TOY_ALERT_AT(type, base) \
+    _Static_assert((INT_T)(type) == AI_TOY_ALERT_IDX_##type, "AI_TOY_ALERT_LIST: " #type " is not at its own index");
+AI_TOY_ALERT_LIST(AI_TOY_ALERT_AT)
+_Static_assert(AI_TOY_ALERT_CNT == AI_TOY_ALERT_TYPE_LAST + 1,
+               "AI_TOY_ALERT_LIST must end at the last alert type");
+
+#define AI_TOY_ALERT_ROW(type, base)    { AI_TOY_LANG_LIST(AI_TOY_ALERT_LANG, base) },
+
+STATIC CONST ai_toy_alert_asset_t s_alert_assets[AI_TOY_ALERT_CNT][AI_TOY_LANG_CNT] = {
+    AI_TOY_ALERT_LIST(AI_TOY_ALERT_ROW)
+};
+
+STATIC CONST ai_toy_alert_asset_t *__alert_asset_get(TY_AI_TOY_ALERT_TYPE type, UINT8_T lang)
+{
+    if ((UINT_T)type >= AI_TOY_ALERT_CNT) {
+        return NULL;
+    }
+    // unknown languages fall back to english, matching s_lang semantics
+    if (lang >= AI_TOY_LANG_CNT) {
+        lang = AI_TOY_LANG_EN;
+    }
+    if (NULL == s_alert_assets[type][lang].data || 0 == s_alert_assets[type][lang].size) {
+        TAL_PR_ERR("alert %d has no asset for lang %d", type, lang);
+        return NULL;
+    }
+    return &s_alert_assets[type][lang];
+}
+
+OPERATE_RET ty_ai_toy_alert(TY_AI_TOY_ALERT_TYPE type, BOOL_T send_eof)
+{
+    TAL_PR_DEBUG("toy alert type=%d", type);
+
+    CONST ai_toy_alert_asset_t *asset = __alert_asset_get(type, s_lang);
+    if (NULL == asset) {
         return OPRT_INVALID_PARM;
     }
 
-    tuya_speaker_service_tone_play_data(AI_TOY_ALERT_PLAY_ID, TUYA_AI_CHAT_AUDIO_FORMAT_MP3, audio_data, audio_size);
+#if AI_TOY_ALERT_PCM_CACHE_ENABLE
+    // hot tones (wakeup and mode change) play pre-decoded PCM, a miss fills the cache in background
+    if (TOY_ALART_TYPE_WAKEUP == type || (type >= TOY_ALART_TYPE_LONG_KEY_TALK && type <= TOY_ALART_TYPE_RANDOM_TALK)) {
+        if (OPRT_OK == ai_toy_alert_cache_play(asset->data, asset->size)) {
+            return OPRT_OK;
+        }
+    }
+    // a cached alert still on the AO gives way to the speaker service
+    ai_toy_alert_cache_stop();
+#endif
+
+    tuya_speaker_service_tone_play_data(AI_TOY_ALERT_PLAY_ID, TUYA_AI_CHAT_AUDIO_FORMAT_MP3, asset->data, asset->size);
 
-    return ret;
+    return OPRT_OK;
 }
 
 
@@ -1258,6 +2175,7 @@ OPERATE_RET ty_ai_toy_create(TY_AI_TOY_T **ai_toy)
     toy = tkl_system_psram_malloc(sizeof(TY_AI_TOY_T));
     if (toy == NULL) {
         TAL_PR_ERR("ai_toy malloc failed");
+        rt = OPRT_MALLOC_FAILED;
         goto __error;
     }
     memset(toy, 0, sizeof(TY_AI_TOY_T));
@@ -1271,11 +2189,29 @@ OPERATE_RET ty_ai_toy_create(TY_AI_TOY_T **ai_toy)
     toy->llm = ty_ai_proc_create(&cfg);
     if (toy->llm  == NULL) {
         TAL_PR_ERR("toy->llm  malloc failed");
+        rt = OPRT_MALLOC_FAILED;
         goto __error;
     }
 
-    TUYA_CALL_ERR_GOTO(tal_sw_timer_create(ai_toy_idle_timer, toy, &toy->idle_timer), __error);
-    TUYA_CALL_ERR_GOTO(tal_sw_timer_create(ai_toy_lowpower_timer, toy, &toy->lowpower_timer), __error);
+    TUYA_CALL_ERR_GOTO(ai_toy_wheel_init(), __error);
+    TUYA_CALL_ERR_GOTO(ai_toy_settings_init(__ai_toy_settings_flushed), __error);
+    TUYA_CALL_ERR_GOTO(ai_toy_power_init(TOY_IDLE_TIMEOUT, TOY_DEEPSLEEP_TIMEOUT), __error);
+    TUYA_CALL_ERR_GOTO(ai_toy_wake_init(), __error);
+    ai_toy_wheel_timer_init(&toy->idle_timer, ai_toy_idle_timer, toy, TOY_IDLE_TIMER_SLACK);
+    ai_toy_wheel_timer_init(&toy->lowpower_timer, ai_toy_lowpower_timer, toy, TOY_DEEPSLEEP_TIMER_SLACK);
+    ai_toy_text_stream_init(&s_text_stream, __text_stream_line, NULL);
+    TUYA_CALL_ERR_LOG(ai_toy_text_batch_init());
+
+    s_audio_stage.buf = tkl_system_psram_malloc(AI_TOY_AUDIO_STAGE_SIZE);
+    if (NULL == s_audio_stage.buf) {
+        TAL_PR_ERR("audio stage malloc failed");
+        rt = OPRT_MALLOC_FAILED;
+        goto __error;
+    }
+    TUYA_CALL_ERR_GOTO(ai_toy_evq_init(__ai_toy_evt_handle, toy), __error);
+#if AI_TOY_EVTRACE_ENABLE
+    ai_toy_evq_tap_set(ai_toy_evtrace_record);
+#endif
 
     __ai_toy_config_load(toy);
 
@@ -1290,12 +2226,13 @@ __error:
             ty_ai_proc_destroy(toy->llm);
         }
 
-        if (toy->idle_timer) {
-            tal_sw_timer_delete(toy->idle_timer);
-        }
-
-        if (toy->lowpower_timer){
-            tal_sw_timer_delete(toy->lowpower_timer);
+        // nothing may fire into the context once it is freed, and a pending volume goes to flash now
+        ai_toy_wheel_cancel(&toy->idle_timer);
+        ai_toy_wheel_cancel(&toy->lowpower_timer);
+        ai_toy_settings_flush();
+        if (s_audio_stage.buf) {
+            tkl_system_psram_free(s_audio_stage.buf);
+            s_audio_stage.buf = NULL;
         }
         tkl_system_psram_free(toy);
     }
@@ -1326,10 +2263,26 @@ OPERATE_RET ty_ai_toy_destroy(VOID)
 
     TY_AI_TOY_T *ctx = s_ai_toy;
 
-    //! TODO: thread realse
+    // nothing may fire into the context once it is freed
+    ai_toy_wheel_cancel_sync(&ctx->idle_timer);
+    ai_toy_wheel_cancel_sync(&ctx->lowpower_timer);
+
+    // the worker handles what is queued and exits, then the threads it feeds
+    ai_toy_evq_deinit();
+    ai_toy_video_queue_deinit();
+#if AI_TOY_ALERT_PCM_CACHE_ENABLE
+    ai_toy_alert_cache_deinit();
+#endif
+
+    // a pending volume goes to flash now
+    ai_toy_settings_flush();
 
-    tkl_system_psram_free(ctx);
     s_ai_toy = NULL;
+    tkl_system_psram_free(ctx);
+    if (s_audio_stage.buf) {
+        tkl_system_psram_free(s_audio_stage.buf);
+        s_audio_stage.buf = NULL;
+    }
 
     TUYA_CALL_ERR_LOG(tkl_ai_uninit());
 
@@ -1344,15 +2297,8 @@ UINT8_T tuya_ai_get_lang()
 }
 
 
-OPERATE_RET ty_ai_toy_start(TY_AI_TOY_T *ai_toy)
+STATIC VOID __ai_toy_start_events(TY_AI_TOY_T *ctx)
 {
-    OPERATE_RET rt = OPRT_OK;
-    if (NULL == ai_toy) {
-        return OPRT_RESOURCE_NOT_READY;
-    }
-
-    TY_AI_TOY_T *ctx = ai_toy;
-
     ctx->ops.network_status_get   = _network_status_get;
 
 #if defined(TUYA_UPLOAD_DEBUG) && (TUYA_UPLOAD_DEBUG == 1)
@@ -1368,35 +2314,181 @@ OPERATE_RET ty_ai_toy_start(TY_AI_TOY_T *ai_toy)
     ty_subscribe_event(EVENT_OTA_FAILED_NOTIFY,  "ai_toy", _event_ota_fail_cb, SUBSCRIBE_TYPE_NORMAL);
     // ty_subscribe_event(EVENT_NETCFG_ERROR,       "ai_toy", _event_netcfg_err_cb, SUBSCRIBE_TYPE_NORMAL);
     ty_subscribe_event(EVENT_AI_CLIENT_RUN,     "ai_toy", _event_clinet_run, SUBSCRIBE_TYPE_NORMAL);
+}
+
+STATIC OPERATE_RET __ai_toy_start_speaker(TY_AI_TOY_T *ctx)
+{
+    OPERATE_RET rt = OPRT_OK;
 
     TUYA_SPEAKER_SERVICE_CONFIG_S player_cfg = {0};
-    TUYA_CALL_ERR_GOTO(tuya_speaker_service_init(&player_cfg), __error);
-    TUYA_CALL_ERR_GOTO(tuya_audio_player_set_event_callback(_event_play_status_cb, ai_toy), __error);
+    TUYA_CALL_ERR_RETURN(tuya_speaker_service_init(&player_cfg));
+    TUYA_CALL_ERR_RETURN(tuya_audio_player_set_event_callback(_event_play_status_cb, ctx));
+    return OPRT_OK;
+}
 
+STATIC VOID __ai_toy_start_network(VOID)
+{
+    TUYA_CALL_ERR_LOG(ai_toy_netstat_init());
     tuya_iot_reg_get_wf_nw_stat_cb(_wf_nw_stat_cb);
 
     // tuya_ai_display_msg(&ai_toy->volume, 1, TY_DISPLAY_TP_VOLUME);
+}
 
+STATIC OPERATE_RET __ai_toy_start_monitor(VOID)
+{
 #if defined(ENABLE_APP_AI_MONITOR) && (ENABLE_APP_AI_MONITOR == 1)
+    OPERATE_RET rt = OPRT_OK;
+
     // start ai monitor
     ai_monitor_config_t monitor_cfg = AI_MONITOR_CFG_DEFAULT;
     TUYA_CALL_ERR_RETURN(tuya_ai_monitor_init(&monitor_cfg));
     TUYA_CALL_ERR_RETURN(tuya_ai_monitor_start());
 #endif
+    return OPRT_OK;
+}
+
+#if AI_TOY_ALERT_PCM_CACHE_ENABLE
+// player event source of a cached alert, not one of the speaker service players
+#define AI_TOY_ALERT_CACHE_SRC          (-1)
+
+STATIC VOID __alert_cache_evt_post(INT_T event)
+{
+    AI_TOY_EVT_T evt = {
+        .src   = TOY_SRC_PLAYER,
+        .code  = (UINT8_T)event,
+        .flags = TOY_EVT_FLAG_ALERT,
+        .arg   = (UINT32_T)AI_TOY_ALERT_CACHE_SRC,
+    };
+    ai_toy_evq_post(&evt);
+}
+
+// what the speaker service does before a tone: no other tone on the AO, music paused
+STATIC VOID __alert_cache_out_begin(VOID)
+{
+    if (tuya_speaker_service_tone_is_playing()) {
+        tuya_speaker_service_tone_stop();
+    }
+    if (tuya_audio_player_get_status(TUYA_AUDIO_PLAYER_TYPE_MUSIC) == TUYA_PLAYER_STATE_PLAYING) {
+        TAL_PR_DEBUG("music is playing, pause");
+        tuya_speaker_service_pause(0);
+    }
+    __alert_cache_evt_post(TUYA_PLAYER_EVENT_STARTED);
+}
+
+STATIC VOID __alert_cache_out_end(BOOL_T aborted)
+{
+    __alert_cache_evt_post(aborted ? TUYA_PLAYER_EVENT_STOPPED : TUYA_PLAYER_EVENT_FINISHED);
+}
+
+STATIC CONST AI_TOY_ALERT_CACHE_OUT_T s_alert_cache_out = {
+    .begin = __alert_cache_out_begin,
+    .end   = __alert_cache_out_end,
+};
+#endif
+
+/**
+ * @brief decode the wakeup tone of the current language ahead of its first use
+ *
+ * Called once the cache is up and again whenever the network callback picks
+ * another language; before the cache is up it does nothing, an asset already
+ * cached is not decoded twice.
+ */
+STATIC VOID __ai_toy_alert_cache_prefetch(VOID)
+{
+#if AI_TOY_ALERT_PCM_CACHE_ENABLE
+    CONST ai_toy_alert_asset_t *wakeup = __alert_asset_get(TOY_ALART_TYPE_WAKEUP, s_lang);
+    if (wakeup) {
+        ai_toy_alert_cache_prefetch(wakeup->data, wakeup->size);
+    }
+#endif
+}
+
+STATIC VOID __ai_toy_start_alert_cache(VOID)
+{
+#if AI_TOY_ALERT_PCM_CACHE_ENABLE
+    if (OPRT_OK == ai_toy_alert_cache_init(AI_TOY_ALERT_PCM_CACHE_BUDGET, AI_TOY_ALERT_PCM_DECODER, &s_alert_cache_out)) {
+        __ai_toy_alert_cache_prefetch();
+    }
+#endif
+}
+
+/**
+ * boot graph
+ *
+ * ty_ai_toy_init brings the toy up through this table instead of running
+ * create, hardware init and start back to back: stages whose dependencies
+ * are met run side by side (hardware, event subscriptions and the monitor
+ * all only need the context, for instance). Dependencies may only point at
+ * earlier rows.
+ */
+typedef enum {
+    TOY_BOOT_CREATE,
+    TOY_BOOT_HARDWARE,
+    TOY_BOOT_EVENTS,
+    TOY_BOOT_MONITOR,
+    TOY_BOOT_SPEAKER,
+    TOY_BOOT_NETWORK,
+    TOY_BOOT_PROC,
+    TOY_BOOT_ALERT_CACHE,
+    TOY_BOOT_MAX
+} ai_toy_boot_stage_t;
+
+STATIC OPERATE_RET __boot_create(VOID *arg)
+{
+    return ty_ai_toy_create(&s_ai_toy);
+}
+
+STATIC OPERATE_RET __boot_hardware(VOID *arg)
+{
+    return ty_ai_toy_hardware_init(s_ai_toy, (TY_AI_TOY_CFG_T *)arg);
+}
 
-    ty_ai_proc_start(ctx->llm);
+STATIC OPERATE_RET __boot_events(VOID *arg)
+{
+    __ai_toy_start_events(s_ai_toy);
+    return OPRT_OK;
+}
+
+STATIC OPERATE_RET __boot_monitor(VOID *arg)
+{
+    return __ai_toy_start_monitor();
+}
 
-    TAL_PR_NOTICE("ty_ai_toy_start success");
+STATIC OPERATE_RET __boot_speaker(VOID *arg)
+{
+    return __ai_toy_start_speaker(s_ai_toy);
+}
 
+STATIC OPERATE_RET __boot_network(VOID *arg)
+{
+    __ai_toy_start_network();
     return OPRT_OK;
+}
 
-__error:
+STATIC OPERATE_RET __boot_proc(VOID *arg)
+{
+    ty_ai_proc_start(s_ai_toy->llm);
+    return OPRT_OK;
+}
 
-    TAL_PR_ERR("ty_ai_toy_start failed");
-    ty_ai_toy_destroy();
-    return rt;
+STATIC OPERATE_RET __boot_alert_cache(VOID *arg)
+{
+    __ai_toy_start_alert_cache();
+    return OPRT_OK;
 }
 
+STATIC CONST AI_TOY_BOOT_STAGE_T s_ai_toy_boot[TOY_BOOT_MAX] = {
+    [TOY_BOOT_CREATE]      = {"create",      __boot_create,      0,                                                        TRUE},
+    [TOY_BOOT_HARDWARE]    = {"hardware",    __boot_hardware,    AI_TOY_BOOT_DEP(TOY_BOOT_CREATE),                         TRUE},
+    [TOY_BOOT_EVENTS]      = {"events",      __boot_events,      AI_TOY_BOOT_DEP(TOY_BOOT_CREATE),                         TRUE},
+    [TOY_BOOT_MONITOR]     = {"monitor",     __boot_monitor,     AI_TOY_BOOT_DEP(TOY_BOOT_CREATE),                         FALSE},
+    [TOY_BOOT_SPEAKER]     = {"speaker",     __boot_speaker,     AI_TOY_BOOT_DEP(TOY_BOOT_HARDWARE),                       TRUE},
+    [TOY_BOOT_NETWORK]     = {"network",     __boot_network,     AI_TOY_BOOT_DEP(TOY_BOOT_EVENTS) | AI_TOY_BOOT_DEP(TOY_BOOT_SPEAKER), FALSE},
+    // the proc layer reads ctx->ops and plays TTS through the speaker
+    [TOY_BOOT_PROC]        = {"proc",        __boot_proc,        AI_TOY_BOOT_DEP(TOY_BOOT_EVENTS) | AI_TOY_BOOT_DEP(TOY_BOOT_SPEAKER), TRUE},
+    // plays through the speaker; the network callback prefetches again once it picks the language
+    [TOY_BOOT_ALERT_CACHE] = {"alert_cache", __boot_alert_cache, AI_TOY_BOOT_DEP(TOY_BOOT_SPEAKER),                        FALSE},
+};
 
 OPERATE_RET ty_ai_toy_init(TY_AI_TOY_CFG_T *cfg)
 {
@@ -1412,8 +2504,6 @@ OPERATE_RET ty_ai_toy_init(TY_AI_TOY_CFG_T *cfg)
     TAL_PR_NOTICE("ai_toy_init");
     //! TODO:
     tal_wifi_lp_disable();
-    TUYA_CALL_ERR_GOTO(ty_ai_toy_create(&s_ai_toy), __error);
-    TUYA_CALL_ERR_GOTO(ty_ai_toy_hardware_init(s_ai_toy, cfg), __error);
     
 /*************************大鹰应用程序初始化************************************/
     // LED灯带初始状态由其他文件实现，无需在此文件中初始化
@@ -1427,8 +2517,17 @@ OPERATE_RET ty_ai_toy_init(TY_AI_TOY_CFG_T *cfg)
     // TAL_PR_DEBUG("daying app success alex add\n\n\n");
 /*******************************************************************************/
 
-    // start ai toy
-    TUYA_CALL_ERR_LOG(ty_ai_toy_start(s_ai_toy));
+    rt = ai_toy_boot_run(s_ai_toy_boot, TOY_BOOT_MAX, cfg);
+    ai_toy_boot_dump();
+    if (OPRT_OK != rt) {
+        goto __error;
+    }
+
+#if AI_TOY_FAST_BOOT
+    // ready to listen, do not keep the LED ring in its self-test
+    led_controller_selftest_finish();
+#endif
+    TAL_PR_NOTICE("ty_ai_toy_init success");
 
     return OPRT_OK;
 
@@ -1440,33 +2539,23 @@ __error:
 
 
 /**
- * @brief 获取当前Wi-Fi信号强度并计算LED显示数量
- * @return uint8_t 需点亮的LED数量：0=获取失败, 1-12=信号强度对应数量
- * @note 信号强度范围映射：
+ * @brief 根据缓存的Wi-Fi信号等级计算LED显示数量（不访问Wi-Fi协议栈）
+ * @return uint8_t 需点亮的LED数量：0=尚无有效采样, 1-12=信号强度对应数量
+ * @note 等级由后台采样经EWMA滤波和滞回得到，映射关系不变：
  *      [-128, -90] → 1个LED (最小显示)
- *      [-89, -30]  → 按比例计算LED数
+ *      [-89, -30]  → 按比例计算LED数，每5dB一级
  *      [-30, 0]    → 12个LED (最大显示)
  */
 uint8_t get_led_count_by_rssi(void) {
-    SCHAR_T rssi = -128;  // 初始化为最小值(极限弱信号)
-    OPERATE_RET ret = gw_get_rssi(&rssi);  // 获取实际信号值
+    uint8_t level = ai_toy_netstat_rssi_level_get();
     
-    // 错误检查：确保获取成功
-    if (OPRT_OK != ret) {
-        TAL_PR_ERR("Failed to get signal strength:%d", ret);
+    // 错误检查：确保已有有效采样
+    if (0 == level) {
+        TAL_PR_ERR("No valid signal strength sample");
         return 0;  // 返回0表示错误状态
     }
     
-    TAL_PR_NOTICE("Current signal strength:%ddBm", rssi);
-    
-    /* 信号强度映射逻辑 (线形转换)：
-     *  优秀信号[-30dBm以上] → 12个LED
-     *  有效范围[-90~-30] → 映射公式: (rssi + 90) / 5 + 1
-     *  微弱信号[-90dBm以下] → 维持1个LED显示
-     */
-    if (rssi >= -30) return 12;      // 强信号：满格显示
-    if (rssi <= -90) return 1;       // 弱信号：最小显示
-    
-    // 核心转换公式（整数运算）
-    return (uint8_t)((rssi + 90) / 5) + 1;
+    TAL_PR_NOTICE("Current signal strength:%ddBm, filtered %ddBm, level %d",
+                  ai_toy_netstat_rssi_get(), ai_toy_netstat_rssi_filtered_get(), level);
+    return level;
 }
@@ -5,10 +5,110 @@
 #include "tal_thread.h"
 #include "tal_system.h"
 #include "tkl_spi.h"
+#include "ai_toy_trace.h"
+#include <string.h>
 
 static UCHAR_T *s_buffer = NULL;
 static TUYA_SPI_NUM_E s_spi_port;
 
+// RGB 影子帧（R/G/B 分通道存放）：挂起期间释放 SPI 编码缓冲区，只保留每灯3字节用于唤醒恢复；
+// 分通道便于整帧比较和逐通道处理
+static UCHAR_T s_shadow_r[WS2812_LED_COUNT];
+static UCHAR_T s_shadow_g[WS2812_LED_COUNT];
+static UCHAR_T s_shadow_b[WS2812_LED_COUNT];
+static BOOL_T s_suspended = FALSE;
+
+// 编码查找表：一个颜色字节对应 8 个 SPI 字节（高位在前）
+static UCHAR_T s_bit_lut[256][8];
+static BOOL_T s_bit_lut_ready = FALSE;
+
+static UINT32_T s_encode_pending_us = 0;  // 本帧累计编码耗时
+static Ws2812Stats s_stats;
+static WS2812_SPI_TX_HOOK s_tx_hook = NULL;
+
+static const TUYA_SPI_BASE_CFG_T s_spi_cfg = {
+    .spi_dma_flags = TRUE,
+    .role = TUYA_SPI_ROLE_MASTER,
+    .mode = TUYA_SPI_MODE0,
+    .type = TUYA_SPI_SOFT_TYPE,
+    .databits = TUYA_SPI_DATA_BIT8,
+    .freq_hz = WS2812_SPI_FREQ
+};
+
+static void ws2812_bit_lut_init(void) {
+    if (s_bit_lut_ready) {
+        return;
+    }
+    for (int v = 0; v < 256; v++) {
+        for (int bit = 0; bit < 8; bit++) {
+            s_bit_lut[v][bit] = ((v << bit) & 0x80) ? WS2812_1 : WS2812_0;
+        }
+    }
+    s_bit_lut_ready = TRUE;
+}
+
+/**
+ * @brief 将一个像素编码为 24 字节（GRB，每位一个字节），每个分量查表拷贝 8 字节
+ */
+static void ws2812_encode_grb(UCHAR_T *dst, UCHAR_T red, UCHAR_T green, UCHAR_T blue) {
+    memcpy(dst, s_bit_lut[green], 8);
+    memcpy(dst + 8, s_bit_lut[red], 8);
+    memcpy(dst + 16, s_bit_lut[blue], 8);
+}
+
+/**
+ * @brief 分通道帧整帧编码
+ */
+VOID_T ws2812_spi_encode_frame(UCHAR_T *dst, const UCHAR_T *red, const UCHAR_T *green, const UCHAR_T *blue,
+                               UINT16_T count) {
+    ws2812_bit_lut_init();
+    for (UINT16_T i = 0; i < count; i++) {
+        ws2812_encode_grb(dst + (size_t)i * 24, red[i], green[i], blue[i]);
+    }
+}
+
+/**
+ * @brief 将一个像素编码到 SPI 缓冲区
+ */
+static void ws2812_spi_encode(UINT16_T index, UCHAR_T red, UCHAR_T green, UCHAR_T blue) {
+    ws2812_encode_grb(s_buffer + (size_t)index * 24, red, green, blue);
+}
+
+// 发送：设置了发送钩子时交给钩子（基准/仿真），否则走 SPI
+static OPERATE_RET ws2812_spi_tx(const UCHAR_T *buf, size_t len) {
+    if (s_tx_hook) {
+        return s_tx_hook(buf, (UINT32_T)len);
+    }
+    return tkl_spi_send(s_spi_port, (VOID_T *)buf, len);
+}
+
+static void ws2812_time_add(Ws2812TimeStat *st, UINT32_T us) {
+    if (0 == st->count || us < st->min_us) {
+        st->min_us = us;
+    }
+    if (us > st->max_us) {
+        st->max_us = us;
+    }
+    st->sum_us += us;
+    st->count++;
+}
+
+// 更新影子帧，颜色有变化时重新编码
+static void ws2812_spi_put(UINT16_T index, UCHAR_T red, UCHAR_T green, UCHAR_T blue) {
+    if (s_shadow_r[index] == red && s_shadow_g[index] == green && s_shadow_b[index] == blue) {
+        s_stats.pixels_unchanged++;
+        return;
+    }
+    s_shadow_r[index] = red;
+    s_shadow_g[index] = green;
+    s_shadow_b[index] = blue;
+    s_stats.pixels_encoded++;
+    // 挂起期间只更新影子帧，唤醒时统一编码
+    if (s_buffer) {
+        ws2812_spi_encode(index, red, green, blue);
+    }
+}
+
 /**
  * @brief 初始化驱动并分配缓冲区
  */
@@ -18,21 +118,18 @@ OPERATE_RET ws2812_spi_init(TUYA_SPI_NUM_E port) {
     }
 
     size_t buf_len = (size_t)WS2812_LED_COUNT * 24;  // 每灯24字节编码
+    ws2812_bit_lut_init();
     s_buffer = malloc(buf_len);
     if (!s_buffer) {
         return OPRT_MALLOC_FAILED;
     }
-    TUYA_SPI_BASE_CFG_T cfg = {
-    .spi_dma_flags = TRUE,
-    .role = TUYA_SPI_ROLE_MASTER,
-    .mode = TUYA_SPI_MODE0,
-    .type = TUYA_SPI_SOFT_TYPE,
-    .databits = TUYA_SPI_DATA_BIT8,
-    .freq_hz = WS2812_SPI_FREQ
-    };
-    
+    // 缓冲区与影子帧同为全黑，逐像素比较从一致的状态开始
+    memset(s_buffer, WS2812_0, buf_len);
+    memset(s_shadow_r, 0, sizeof(s_shadow_r));
+    memset(s_shadow_g, 0, sizeof(s_shadow_g));
+    memset(s_shadow_b, 0, sizeof(s_shadow_b));
 
-    OPERATE_RET rt = tkl_spi_init(port, &cfg);
+    OPERATE_RET rt = tkl_spi_init(port, &s_spi_cfg);
     if (rt != OPRT_OK) {
         free(s_buffer);
         s_buffer = NULL;
@@ -47,15 +144,13 @@ OPERATE_RET ws2812_spi_init(TUYA_SPI_NUM_E port) {
  * @brief 设置单个像素的 GRB 数据到缓冲区
  */
 OPERATE_RET ws2812_spi_set_pixel(UINT16_T index, UCHAR_T red, UCHAR_T green, UCHAR_T blue) {
-    if (index >= WS2812_LED_COUNT || s_buffer == NULL) {
+    if (index >= WS2812_LED_COUNT || (s_buffer == NULL && !s_suspended)) {
         return OPRT_INVALID_PARM;
     }
 
-    uint32_t color = ((uint32_t)green << 16) | ((uint32_t)red << 8) | blue;
-    size_t base = (size_t)index * 24;
-    for (int bit = 0; bit < 24; bit++) {
-        s_buffer[base + bit] = ((color << bit) & 0x800000) ? WS2812_1 : WS2812_0;
-    }
+    UINT64_T start = AI_TOY_TRACE_NOW_US();
+    ws2812_spi_put(index, red, green, blue);
+    s_encode_pending_us += (UINT32_T)(AI_TOY_TRACE_NOW_US() - start);
     return OPRT_OK;
 }
 
@@ -63,15 +158,27 @@ OPERATE_RET ws2812_spi_set_pixel(UINT16_T index, UCHAR_T red, UCHAR_T green, UCH
  * @brief 刷新发送像素数据
  */
 OPERATE_RET ws2812_spi_refresh(VOID_T) {
+    if (s_suspended) {
+        // 挂起期间不发送，唤醒时发送最后一帧
+        s_stats.frames_skipped++;
+        return OPRT_OK;
+    }
     if (s_buffer == NULL) {
         return OPRT_RESOURCE_NOT_READY;
     }
+    s_stats.frames_encoded++;
+    ws2812_time_add(&s_stats.encode, s_encode_pending_us);
+    s_encode_pending_us = 0;
 
     size_t len = (size_t)WS2812_LED_COUNT * 24;
-    OPERATE_RET rt = tkl_spi_send(s_spi_port, s_buffer, len);
+    UINT64_T start = AI_TOY_TRACE_NOW_US();
+    OPERATE_RET rt = ws2812_spi_tx(s_buffer, len);
     if (rt != OPRT_OK) {
+        s_stats.send_errors++;
         return rt;
     }
+    ws2812_time_add(&s_stats.send, (UINT32_T)(AI_TOY_TRACE_NOW_US() - start));
+    s_stats.frames_sent++;
 
     //tal_system_sleep(1);  // 确保数据发送完成
     return OPRT_OK;
@@ -85,22 +192,152 @@ OPERATE_RET ws2812_spi_deinit(VOID_T) {
         free(s_buffer);
         s_buffer = NULL;
     }
+    s_suspended = FALSE;
     return tkl_spi_deinit(s_spi_port);
 }
 
+/**
+ * @brief 低功耗挂起：熄灭灯带，关闭 SPI 并释放编码缓冲区，保留影子帧
+ */
+OPERATE_RET ws2812_spi_suspend(VOID_T) {
+    if (s_suspended) {
+        return OPRT_OK;
+    }
+    if (s_buffer == NULL) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+
+    // 发送全黑帧，灯珠只剩静态电流
+    memset(s_buffer, WS2812_0, (size_t)WS2812_LED_COUNT * 24);
+    ws2812_spi_tx(s_buffer, (size_t)WS2812_LED_COUNT * 24);
+
+    tkl_spi_deinit(s_spi_port);
+    free(s_buffer);
+    s_buffer = NULL;
+    s_suspended = TRUE;
+    return OPRT_OK;
+}
+
+/**
+ * @brief 唤醒：重新初始化 SPI，由影子帧重建编码并发送一帧恢复显示
+ */
+OPERATE_RET ws2812_spi_resume(VOID_T) {
+    if (!s_suspended) {
+        return OPRT_OK;
+    }
+
+    s_buffer = malloc((size_t)WS2812_LED_COUNT * 24);
+    if (!s_buffer) {
+        return OPRT_MALLOC_FAILED;
+    }
+    OPERATE_RET rt = tkl_spi_init(s_spi_port, &s_spi_cfg);
+    if (rt != OPRT_OK) {
+        free(s_buffer);
+        s_buffer = NULL;
+        return rt;
+    }
+    s_suspended = FALSE;
+
+    // 挂起时灯带已熄灭，由影子帧整帧重编码后发送
+    UINT64_T start = AI_TOY_TRACE_NOW_US();
+    ws2812_spi_encode_frame(s_buffer, s_shadow_r, s_shadow_g, s_shadow_b, WS2812_LED_COUNT);
+    s_encode_pending_us += (UINT32_T)(AI_TOY_TRACE_NOW_US() - start);
+    return ws2812_spi_refresh();
+}
+
+BOOL_T ws2812_spi_is_suspended(VOID_T) {
+    return s_suspended;
+}
+
+VOID_T ws2812_spi_stats_get(Ws2812Stats *stats) {
+    if (stats) {
+        *stats = s_stats;
+    }
+}
+
+VOID_T ws2812_spi_stats_reset(VOID_T) {
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+VOID_T ws2812_spi_tx_hook_set(WS2812_SPI_TX_HOOK hook) {
+    s_tx_hook = hook;
+}
+
 /**
  * @brief 设置所有 LED 为相同的颜色
  */
 OPERATE_RET ws2812_spi_set_all(UCHAR_T red, UCHAR_T green, UCHAR_T blue) {
-    if (s_buffer == NULL) {
+    if (s_buffer == NULL && !s_suspended) {
         return OPRT_RESOURCE_NOT_READY;
     }
+    UINT64_T start = AI_TOY_TRACE_NOW_US();
     for (UINT16_T i = 0; i < WS2812_LED_COUNT; i++) {
-        ws2812_spi_set_pixel(i, red, green, blue);
+        ws2812_spi_put(i, red, green, blue);
+    }
+    s_encode_pending_us += (UINT32_T)(AI_TOY_TRACE_NOW_US() - start);
+    return OPRT_OK;
+}
+
+/**
+ * @brief 整帧设置（R/G/B 分通道数组，各 WS2812_LED_COUNT 个）
+ */
+OPERATE_RET ws2812_spi_set_frame(const UCHAR_T *red, const UCHAR_T *green, const UCHAR_T *blue) {
+    if (NULL == red || NULL == green || NULL == blue) {
+        return OPRT_INVALID_PARM;
     }
+    if (s_buffer == NULL && !s_suspended) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    UINT64_T start = AI_TOY_TRACE_NOW_US();
+    // 整帧未变（静态画面或动画停顿）只需三次整块比较
+    if (0 == memcmp(s_shadow_r, red, WS2812_LED_COUNT) && 0 == memcmp(s_shadow_g, green, WS2812_LED_COUNT) &&
+        0 == memcmp(s_shadow_b, blue, WS2812_LED_COUNT)) {
+        s_stats.pixels_unchanged += WS2812_LED_COUNT;
+    } else {
+        for (UINT16_T i = 0; i < WS2812_LED_COUNT; i++) {
+            ws2812_spi_put(i, red[i], green[i], blue[i]);
+        }
+    }
+    s_encode_pending_us += (UINT32_T)(AI_TOY_TRACE_NOW_US() - start);
     return OPRT_OK;
 }
 
+#if WS2812_BENCH
+// -------------------- 编码基准 --------------------
+
+/**
+ * @brief 整帧编码耗时随灯珠数的变化（12~1024），不依赖 SPI
+ */
+VOID_T ws2812_spi_bench_encode(VOID_T) {
+    static const UINT16_T counts[] = {12, 64, 256, 1024};
+
+    for (UINT32_T c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        UINT16_T n = counts[c];
+        UINT32_T batch = 24576 / n;
+        UINT32_T iters = 0;
+        UCHAR_T *buf = malloc((size_t)n * 24);
+        ws2812_bit_lut_init();
+        if (NULL == buf) {
+            WS2812_BENCH_PRINT("{\"case\":\"encode\",\"leds\":%u,\"err\":\"nomem\"}", n);
+            continue;
+        }
+        UINT64_T start = AI_TOY_TRACE_NOW_US();
+        do {
+            for (UINT32_T i = 0; i < batch; i++, iters++) {
+                for (UINT16_T p = 0; p < n; p++) {
+                    ws2812_encode_grb(buf + (size_t)p * 24, (UCHAR_T)iters, (UCHAR_T)p, (UCHAR_T)(iters + p));
+                }
+            }
+        } while (AI_TOY_TRACE_NOW_US() - start < WS2812_BENCH_MIN_US);
+        UINT32_T us = (UINT32_T)(AI_TOY_TRACE_NOW_US() - start);
+        WS2812_BENCH_PRINT("{\"case\":\"encode\",\"leds\":%u,\"iters\":%u,\"us\":%u,\"ns_frame\":%u,\"ns_led\":%u}",
+                           n, iters, us, (UINT32_T)((UINT64_T)us * 1000 / iters),
+                           (UINT32_T)((UINT64_T)us * 1000 / ((UINT64_T)iters * n)));
+        free(buf);
+    }
+}
+#endif
+
 // -------------------- 呼吸灯测试 --------------------
 
 #define W2812_TEST 0
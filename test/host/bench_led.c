@@ -0,0 +1,13 @@
+/**
+ * LED pipeline benchmark: built with WS2812_BENCH=1, led_controller_init()
+ * runs led_controller_bench_run() against the SPI stub before the self-test.
+ *
+ * Results are the "LEDBENCH {json}" log lines, see "make bench".
+ */
+#include "led_controller.h"
+
+int main(int argc, char *argv[])
+{
+    led_controller_init();
+    return 0;
+}
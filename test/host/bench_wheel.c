@@ -0,0 +1,113 @@
+/**
+ * ai_toy_wheel cost per operation against the number of armed timers, on the
+ * manual clock. Arm and cancel should stay flat from 16 to 4096 timers.
+ *
+ * One JSON line per case on stdout, see "make bench".
+ */
+#include "ai_toy_wheel.h"
+#include "tal_system.h"
+#include <string.h>
+
+#ifndef WS2812_BENCH_MIN_US
+#define WS2812_BENCH_MIN_US             (1000 * 1000)
+#endif
+
+#define TIMERS_MAX                      4096
+#define BATCH                           1024
+
+STATIC AI_TOY_WHEEL_TIMER_T s_timer[TIMERS_MAX];
+STATIC UINT32_T s_rand = 0x5eed;
+STATIC UINT32_T s_fired;
+
+STATIC UINT32_T __rand(VOID)
+{
+    s_rand ^= s_rand << 13;
+    s_rand ^= s_rand >> 17;
+    s_rand ^= s_rand << 5;
+    return s_rand;
+}
+
+STATIC VOID __fire_cb(VOID *arg)
+{
+    s_fired++;
+}
+
+STATIC VOID __report(CONST CHAR_T *name, UINT_T n, UINT32_T ops, UINT64_T start)
+{
+    UINT32_T us = (UINT32_T)(AI_TOY_TRACE_NOW_US() - start);
+
+    printf("{\"case\":\"%s\",\"timers\":%u,\"ops\":%u,\"us\":%u,\"ns_op\":%u}\n", name, n, ops, us,
+           (UINT32_T)((UINT64_T)us * 1000 / ops));
+}
+
+// n timers armed up to a minute out, the way the toy and LED timers sit
+STATIC VOID __setup(UINT_T n)
+{
+    for (UINT_T i = 0; i < TIMERS_MAX; i++) {
+        ai_toy_wheel_cancel(&s_timer[i]);
+    }
+    for (UINT_T i = 0; i < n; i++) {
+        ai_toy_wheel_arm(&s_timer[i], 100 + __rand() % 60000);
+    }
+}
+
+STATIC VOID __bench(UINT_T n)
+{
+    UINT64_T start;
+    UINT32_T ops;
+
+    // re-arm of a pending timer
+    __setup(n);
+    ops = 0;
+    start = AI_TOY_TRACE_NOW_US();
+    do {
+        for (UINT_T i = 0; i < BATCH; i++, ops++) {
+            ai_toy_wheel_arm(&s_timer[__rand() % n], 100 + __rand() % 60000);
+        }
+    } while (AI_TOY_TRACE_NOW_US() - start < WS2812_BENCH_MIN_US);
+    __report("wheel_arm", n, ops, start);
+
+    // cancel and arm again, the LED state change pattern
+    ops = 0;
+    start = AI_TOY_TRACE_NOW_US();
+    do {
+        for (UINT_T i = 0; i < BATCH; i++, ops++) {
+            AI_TOY_WHEEL_TIMER_T *t = &s_timer[__rand() % n];
+            ai_toy_wheel_cancel(t);
+            ai_toy_wheel_arm(t, 100 + __rand() % 60000);
+        }
+    } while (AI_TOY_TRACE_NOW_US() - start < WS2812_BENCH_MIN_US);
+    __report("wheel_cancel_arm", n, ops, start);
+
+    // every timer fires once within two seconds of manual time, cost per fired timer
+    __setup(0);
+    ops = 0;
+    start = AI_TOY_TRACE_NOW_US();
+    do {
+        s_fired = 0;
+        for (UINT_T i = 0; i < n; i++) {
+            ai_toy_wheel_arm(&s_timer[i], __rand() % 2000);
+        }
+        ai_toy_wheel_advance(2000);
+        ops += s_fired;
+    } while (AI_TOY_TRACE_NOW_US() - start < WS2812_BENCH_MIN_US);
+    __report("wheel_fire", n, ops, start);
+}
+
+int main(int argc, char *argv[])
+{
+    STATIC CONST UINT_T counts[] = { 16, 256, 4096 };
+
+    ai_toy_wheel_init();
+    for (UINT_T i = 0; i < TIMERS_MAX; i++) {
+        ai_toy_wheel_timer_init(&s_timer[i], __fire_cb, NULL, 0);
+        ai_toy_wheel_timer_manual(&s_timer[i], TRUE);
+    }
+#ifdef USER_SW_VER
+    printf("{\"case\":\"meta\",\"bench\":\"wheel\",\"fw\":\"%s\"}\n", USER_SW_VER);
+#endif
+    for (UINT_T c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        __bench(counts[c]);
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+/**
+ * minimal host test helpers
+ *
+ * Each test binary prints one JSON result line and exits nonzero when any
+ * check failed, so results can be collected and diffed across commits.
+ */
+#ifndef __HOST_TEST_H__
+#define __HOST_TEST_H__
+
+#include <stdio.h>
+
+static unsigned s_host_checks;
+static unsigned s_host_failed;
+
+#define HOST_CHECK(cond, fmt, ...) do { \
+    s_host_checks++; \
+    if (!(cond)) { \
+        s_host_failed++; \
+        if (s_host_failed <= 20) { \
+            fprintf(stderr, "%s:%d: %s: " fmt "\n", __FILE__, __LINE__, #cond, ##__VA_ARGS__); \
+        } \
+    } \
+} while (0)
+
+static inline int host_test_result(const char *name)
+{
+    printf("{\"test\":\"%s\",\"checks\":%u,\"failed\":%u}\n", name, s_host_checks, s_host_failed);
+    return s_host_failed ? 1 : 0;
+}
+
+#endif /* __HOST_TEST_H__ */
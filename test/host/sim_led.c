@@ -0,0 +1,14 @@
+/**
+ * LED simulator: built with WS2812_SIM=1, led_controller_init() runs the
+ * built-in script of led_sim_run_default() on the manual clock.
+ *
+ * The "LEDSIM" log lines are the CSV timeline and one JSON summary per
+ * script step, see "make sim".
+ */
+#include "led_controller.h"
+
+int main(int argc, char *argv[])
+{
+    led_controller_init();
+    return 0;
+}
@@ -0,0 +1,151 @@
+/**
+ * host KV table and cJSON subset for the settings tests
+ */
+#include "tuya_ws_db.h"
+#include "ty_cJSON.h"
+#include <string.h>
+
+#define HOST_KV_KEYS                    8
+#define HOST_KV_VALUE_MAX               256
+
+typedef struct {
+    CHAR_T      key[32];
+    BYTE_T      value[HOST_KV_VALUE_MAX];
+    UINT_T      len;
+    BOOL_T      used;
+} host_kv_entry_t;
+
+HOST_KV_STAT_T g_host_kv;
+STATIC host_kv_entry_t s_kv[HOST_KV_KEYS];
+
+STATIC host_kv_entry_t *__kv_find(CONST CHAR_T *key, BOOL_T create)
+{
+    host_kv_entry_t *free_e = NULL;
+
+    for (UINT_T i = 0; i < HOST_KV_KEYS; i++) {
+        if (s_kv[i].used && 0 == strcmp(s_kv[i].key, key)) {
+            return &s_kv[i];
+        }
+        if (!s_kv[i].used && NULL == free_e) {
+            free_e = &s_kv[i];
+        }
+    }
+    if (create && free_e) {
+        memset(free_e, 0, sizeof(*free_e));
+        snprintf(free_e->key, sizeof(free_e->key), "%s", key);
+        free_e->used = TRUE;
+        return free_e;
+    }
+    return NULL;
+}
+
+VOID host_kv_reset(VOID)
+{
+    memset(s_kv, 0, sizeof(s_kv));
+    memset(&g_host_kv, 0, sizeof(g_host_kv));
+}
+
+VOID host_kv_put(CONST CHAR_T *key, CONST VOID *value, UINT_T len)
+{
+    host_kv_entry_t *e = __kv_find(key, TRUE);
+
+    if (e && len <= HOST_KV_VALUE_MAX) {
+        memcpy(e->value, value, len);
+        e->len = len;
+    }
+}
+
+CONST BYTE_T *host_kv_get(CONST CHAR_T *key, UINT_T *len)
+{
+    host_kv_entry_t *e = __kv_find(key, FALSE);
+
+    if (NULL == e) {
+        return NULL;
+    }
+    *len = e->len;
+    return e->value;
+}
+
+OPERATE_RET wd_common_read(CONST CHAR_T *key, BYTE_T **value, UINT_T *len)
+{
+    host_kv_entry_t *e;
+
+    g_host_kv.reads++;
+    if (g_host_kv.fail_read) {
+        g_host_kv.fail_read--;
+        return OPRT_COM_ERROR;
+    }
+    e = __kv_find(key, FALSE);
+    if (NULL == e) {
+        return OPRT_NOT_FOUND;
+    }
+    *value = malloc(e->len ? e->len : 1);
+    memcpy(*value, e->value, e->len);
+    *len = e->len;
+    return OPRT_OK;
+}
+
+OPERATE_RET wd_common_write(CONST CHAR_T *key, CONST BYTE_T *value, CONST UINT_T len)
+{
+    g_host_kv.writes++;
+    if (g_host_kv.fail_write) {
+        g_host_kv.fail_write--;
+        return OPRT_COM_ERROR;
+    }
+    if (len > HOST_KV_VALUE_MAX || NULL == __kv_find(key, TRUE)) {
+        return OPRT_EXCEED_UPPER_LIMIT;
+    }
+    host_kv_put(key, value, len);
+    return OPRT_OK;
+}
+
+OPERATE_RET wd_common_free_data(BYTE_T *data)
+{
+    free(data);
+    return OPRT_OK;
+}
+
+OPERATE_RET wd_common_delete(CONST CHAR_T *key)
+{
+    host_kv_entry_t *e = __kv_find(key, FALSE);
+
+    g_host_kv.deletes++;
+    if (e) {
+        e->used = FALSE;
+    }
+    return OPRT_OK;
+}
+
+cJSON *ty_cJSON_Parse(CONST CHAR_T *value)
+{
+    cJSON *root;
+
+    if (NULL == value || '{' != value[0] || NULL == strchr(value, '}')) {
+        return NULL;
+    }
+    root = calloc(2, sizeof(cJSON));
+    root->text = strdup(value);
+    return root;
+}
+
+// the item lives in the slot after the object, valid until the next lookup
+cJSON *ty_cJSON_GetObjectItem(cJSON *object, CONST CHAR_T *name)
+{
+    CHAR_T pat[40];
+    CHAR_T *p;
+
+    snprintf(pat, sizeof(pat), "\"%s\"", name);
+    p = strstr(object->text, pat);
+    if (NULL == p || 1 != sscanf(p + strlen(pat), " : %d", &object[1].valueint)) {
+        return NULL;
+    }
+    return &object[1];
+}
+
+VOID ty_cJSON_Delete(cJSON *c)
+{
+    if (c) {
+        free(c->text);
+        free(c);
+    }
+}
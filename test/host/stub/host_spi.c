@@ -0,0 +1,37 @@
+/**
+ * host SPI: counts and keeps the last frame, see tkl_spi.h
+ */
+#include "tkl_spi.h"
+#include <string.h>
+
+HOST_SPI_STAT_T g_host_spi;
+
+OPERATE_RET tkl_spi_init(TUYA_SPI_NUM_E port, CONST TUYA_SPI_BASE_CFG_T *cfg)
+{
+    if (g_host_spi.fail_init) {
+        g_host_spi.fail_init--;
+        return OPRT_COM_ERROR;
+    }
+    g_host_spi.inits++;
+    g_host_spi.open = TRUE;
+    return OPRT_OK;
+}
+
+OPERATE_RET tkl_spi_send(TUYA_SPI_NUM_E port, VOID_T *data, UINT32_T size)
+{
+    if (!g_host_spi.open) {
+        return OPRT_RESOURCE_NOT_READY;
+    }
+    g_host_spi.sends++;
+    g_host_spi.bytes += size;
+    g_host_spi.last_len = MIN(size, HOST_SPI_FRAME_MAX);
+    memcpy(g_host_spi.last, data, g_host_spi.last_len);
+    return OPRT_OK;
+}
+
+OPERATE_RET tkl_spi_deinit(TUYA_SPI_NUM_E port)
+{
+    g_host_spi.deinits++;
+    g_host_spi.open = FALSE;
+    return OPRT_OK;
+}
@@ -0,0 +1,103 @@
+/**
+ * host implementations of the stubbed SDK calls
+ */
+#include "tal_mutex.h"
+#include "tal_system.h"
+#include "tal_sw_timer.h"
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+UINT32_T g_host_sw_timer_starts;
+UINT32_T g_host_sw_timer_last_ms;
+
+OPERATE_RET tal_mutex_create_init(MUTEX_HANDLE *handle)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutex_t *m = malloc(sizeof(pthread_mutex_t));
+
+    if (NULL == m) {
+        return OPRT_MALLOC_FAILED;
+    }
+    // a double lock or a foreign unlock fails loudly instead of hanging
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK);
+    pthread_mutex_init(m, &attr);
+    pthread_mutexattr_destroy(&attr);
+    *handle = m;
+    return OPRT_OK;
+}
+
+OPERATE_RET tal_mutex_lock(MUTEX_HANDLE handle)
+{
+    if (pthread_mutex_lock(handle)) {
+        fprintf(stderr, "tal_mutex_lock: relock\n");
+        abort();
+    }
+    return OPRT_OK;
+}
+
+OPERATE_RET tal_mutex_unlock(MUTEX_HANDLE handle)
+{
+    if (pthread_mutex_unlock(handle)) {
+        fprintf(stderr, "tal_mutex_unlock: not owner\n");
+        abort();
+    }
+    return OPRT_OK;
+}
+
+OPERATE_RET tal_mutex_release(MUTEX_HANDLE handle)
+{
+    pthread_mutex_destroy(handle);
+    free(handle);
+    return OPRT_OK;
+}
+
+SYS_TIME_T tal_system_get_millisecond(VOID)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (SYS_TIME_T)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+UINT64_T host_now_us(VOID)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64_T)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+VOID tal_system_sleep(UINT32_T ms)
+{
+    usleep(ms * 1000);
+}
+
+OPERATE_RET tal_sw_timer_create(TAL_TIMER_CB cb, VOID_T *arg, TIMER_ID *timer_id)
+{
+    *timer_id = (TIMER_ID)cb;
+    return OPRT_OK;
+}
+
+OPERATE_RET tal_sw_timer_delete(TIMER_ID timer_id)
+{
+    return OPRT_OK;
+}
+
+OPERATE_RET tal_sw_timer_start(TIMER_ID timer_id, UINT32_T ms, INT_T mode)
+{
+    g_host_sw_timer_starts++;
+    g_host_sw_timer_last_ms = ms;
+    return OPRT_OK;
+}
+
+OPERATE_RET tal_sw_timer_stop(TIMER_ID timer_id)
+{
+    return OPRT_OK;
+}
+
+BOOL_T tal_sw_timer_is_running(TIMER_ID timer_id)
+{
+    return FALSE;
+}
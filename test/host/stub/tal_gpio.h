@@ -0,0 +1,9 @@
+/**
+ * host stub of the SDK GPIO, the LED modules only need the header
+ */
+#ifndef __TAL_GPIO_H__
+#define __TAL_GPIO_H__
+
+#include "tuya_cloud_types.h"
+
+#endif /* __TAL_GPIO_H__ */
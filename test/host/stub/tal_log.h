@@ -0,0 +1,13 @@
+/**
+ * host stub of the SDK log, everything goes to stderr
+ */
+#ifndef __TAL_LOG_H__
+#define __TAL_LOG_H__
+
+#include <stdio.h>
+
+#define TAL_PR_ERR(fmt, ...)        fprintf(stderr, "[E] " fmt "\n", ##__VA_ARGS__)
+#define TAL_PR_NOTICE(fmt, ...)     fprintf(stderr, "[N] " fmt "\n", ##__VA_ARGS__)
+#define TAL_PR_DEBUG(fmt, ...)      do { if (0) fprintf(stderr, fmt "\n", ##__VA_ARGS__); } while (0)
+
+#endif /* __TAL_LOG_H__ */
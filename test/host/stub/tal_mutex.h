@@ -0,0 +1,14 @@
+/**
+ * host stub of the SDK mutex, pthread error-checking mutexes in host_stub.c
+ */
+#ifndef __TAL_MUTEX_H__
+#define __TAL_MUTEX_H__
+
+#include "tuya_cloud_types.h"
+
+OPERATE_RET tal_mutex_create_init(MUTEX_HANDLE *handle);
+OPERATE_RET tal_mutex_lock(MUTEX_HANDLE handle);
+OPERATE_RET tal_mutex_unlock(MUTEX_HANDLE handle);
+OPERATE_RET tal_mutex_release(MUTEX_HANDLE handle);
+
+#endif /* __TAL_MUTEX_H__ */
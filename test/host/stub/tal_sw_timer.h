@@ -0,0 +1,26 @@
+/**
+ * host stub of the SDK software timer
+ *
+ * Timers never fire on the host, tests drive time through the manual clock
+ * of the modules. The last start is kept for tests that check aiming.
+ */
+#ifndef __TAL_SW_TIMER_H__
+#define __TAL_SW_TIMER_H__
+
+#include "tuya_cloud_types.h"
+
+typedef VOID (*TAL_TIMER_CB)(TIMER_ID timer_id, VOID_T *arg);
+
+#define TAL_TIMER_ONCE              0
+#define TAL_TIMER_CYCLE             1
+
+OPERATE_RET tal_sw_timer_create(TAL_TIMER_CB cb, VOID_T *arg, TIMER_ID *timer_id);
+OPERATE_RET tal_sw_timer_delete(TIMER_ID timer_id);
+OPERATE_RET tal_sw_timer_start(TIMER_ID timer_id, UINT32_T ms, INT_T mode);
+OPERATE_RET tal_sw_timer_stop(TIMER_ID timer_id);
+BOOL_T tal_sw_timer_is_running(TIMER_ID timer_id);
+
+extern UINT32_T g_host_sw_timer_starts;
+extern UINT32_T g_host_sw_timer_last_ms;
+
+#endif /* __TAL_SW_TIMER_H__ */
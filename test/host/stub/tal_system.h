@@ -0,0 +1,21 @@
+/**
+ * host stub of the SDK system calls, monotonic clock in host_stub.c
+ *
+ * Also gives ai_toy_trace.h a microsecond clock, the millisecond fallback
+ * reads 0 for anything the host does in under a millisecond.
+ */
+#ifndef __TAL_SYSTEM_H__
+#define __TAL_SYSTEM_H__
+
+#include "tuya_cloud_types.h"
+
+SYS_TIME_T tal_system_get_millisecond(VOID);
+VOID tal_system_sleep(UINT32_T ms);
+UINT64_T host_now_us(VOID);
+
+#define AI_TOY_TRACE_NOW_US()       host_now_us()
+
+#define TAL_ENTER_CRITICAL()        do { } while (0)
+#define TAL_EXIT_CRITICAL()         do { } while (0)
+
+#endif /* __TAL_SYSTEM_H__ */
@@ -0,0 +1,9 @@
+/**
+ * host stub of the SDK thread API, the LED driver only needs the header
+ */
+#ifndef __TAL_THREAD_H__
+#define __TAL_THREAD_H__
+
+#include "tuya_cloud_types.h"
+
+#endif /* __TAL_THREAD_H__ */
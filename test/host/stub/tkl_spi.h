@@ -0,0 +1,56 @@
+/**
+ * host stub of the SDK SPI driver, implemented in host_spi.c
+ *
+ * Nothing leaves the host: sends are counted and the last frame is kept, so
+ * tests can check what reached the strip without the tx hook.
+ */
+#ifndef __TKL_SPI_H__
+#define __TKL_SPI_H__
+
+#include "tuya_cloud_types.h"
+
+typedef enum {
+    TUYA_SPI_ROLE_MASTER,
+} TUYA_SPI_ROLE_E;
+
+typedef enum {
+    TUYA_SPI_MODE0,
+} TUYA_SPI_MODE_E;
+
+typedef enum {
+    TUYA_SPI_SOFT_TYPE,
+} TUYA_SPI_TYPE_E;
+
+typedef enum {
+    TUYA_SPI_DATA_BIT8,
+} TUYA_SPI_DATABITS_E;
+
+typedef struct {
+    UINT8_T                     spi_dma_flags;
+    TUYA_SPI_ROLE_E             role;
+    TUYA_SPI_MODE_E             mode;
+    TUYA_SPI_TYPE_E             type;
+    TUYA_SPI_DATABITS_E         databits;
+    UINT32_T                    freq_hz;
+} TUYA_SPI_BASE_CFG_T;
+
+#define HOST_SPI_FRAME_MAX          (1024 * 24)
+
+typedef struct {
+    UINT32_T                    inits;
+    UINT32_T                    deinits;
+    UINT32_T                    sends;
+    UINT32_T                    bytes;
+    BOOL_T                      open;
+    UINT32_T                    fail_init;  ///< fail the next n inits
+    UINT32_T                    last_len;
+    UCHAR_T                     last[HOST_SPI_FRAME_MAX];
+} HOST_SPI_STAT_T;
+
+extern HOST_SPI_STAT_T g_host_spi;
+
+OPERATE_RET tkl_spi_init(TUYA_SPI_NUM_E port, CONST TUYA_SPI_BASE_CFG_T *cfg);
+OPERATE_RET tkl_spi_send(TUYA_SPI_NUM_E port, VOID_T *data, UINT32_T size);
+OPERATE_RET tkl_spi_deinit(TUYA_SPI_NUM_E port);
+
+#endif /* __TKL_SPI_H__ */
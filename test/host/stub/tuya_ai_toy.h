@@ -0,0 +1,18 @@
+/**
+ * host stub of tuya_ai_toy.h, the toy states only
+ */
+#ifndef __TUYA_AI_TOY_H__
+#define __TUYA_AI_TOY_H__
+
+#include "tuya_cloud_types.h"
+
+typedef enum {
+    AI_TOY_IDLE,
+    AI_TOY_LISTEN,
+    AI_TOY_UPLOAD,
+    AI_TOY_THINK,
+    AI_TOY_SPEAK,
+    AI_TOY_STATE_MAX
+} ai_toy_state_t;
+
+#endif /* __TUYA_AI_TOY_H__ */
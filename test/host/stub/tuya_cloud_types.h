@@ -0,0 +1,76 @@
+/**
+ * host stub of the SDK base types, only what the host-built modules use
+ */
+#ifndef __TUYA_CLOUD_TYPES_H__
+#define __TUYA_CLOUD_TYPES_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+typedef uint8_t                 UINT8_T;
+typedef uint16_t                UINT16_T;
+typedef uint32_t                UINT32_T;
+typedef uint64_t                UINT64_T;
+typedef int8_t                  INT8_T;
+typedef int16_t                 INT16_T;
+typedef int32_t                 INT32_T;
+typedef int64_t                 INT64_T;
+typedef int                     INT_T;
+typedef unsigned int            UINT_T;
+typedef unsigned int            UINT;
+typedef unsigned char           UCHAR_T;
+typedef unsigned char           BYTE_T;
+typedef char                    CHAR_T;
+typedef signed char             SCHAR_T;
+typedef int16_t                 SHORT_T;
+typedef uint16_t                USHORT_T;
+typedef float                   FLOAT_T;
+typedef size_t                  SIZE_T;
+typedef uint64_t                SYS_TIME_T;
+typedef int                     BOOL_T;
+typedef void                    VOID;
+typedef void                    VOID_T;
+typedef int                     OPERATE_RET;
+
+typedef void                   *MUTEX_HANDLE;
+typedef void                   *TIMER_ID;
+
+typedef enum {
+    TUYA_SPI_NUM_0,
+} TUYA_SPI_NUM_E;
+
+#define CONST                   const
+#define STATIC                  static
+#define IN
+#define OUT
+#define TRUE                    1
+#define FALSE                   0
+
+#ifndef MAX
+#define MAX(a, b)               ((a) > (b) ? (a) : (b))
+#endif
+#ifndef MIN
+#define MIN(a, b)               ((a) < (b) ? (a) : (b))
+#endif
+
+#define OPRT_OK                     0
+#define OPRT_INVALID_PARM           -1
+#define OPRT_MALLOC_FAILED          -2
+#define OPRT_RESOURCE_NOT_READY     -3
+#define OPRT_EXCEED_UPPER_LIMIT     -4
+#define OPRT_COM_ERROR              -5
+#define OPRT_NOT_FOUND              -9
+#define OPRT_CRC                    -10
+#define OPRT_CJSON_PARSE_ERR        -11
+#define OPRT_NETWORK_ERROR          -12
+#define OPRT_CRC32_FAILED           -13
+#define OPRT_NOT_SUPPORTED          -14
+
+#define TUYA_CALL_ERR_RETURN(func)  do { rt = (func); if (OPRT_OK != rt) return rt; } while (0)
+#define TUYA_CALL_ERR_GOTO(func, l) do { rt = (func); if (OPRT_OK != rt) goto l; } while (0)
+#define TUYA_CALL_ERR_LOG(func)     do { rt = (func); if (OPRT_OK != rt) printf("call err %d\n", rt); } while (0)
+
+#endif /* __TUYA_CLOUD_TYPES_H__ */
@@ -0,0 +1,7 @@
+/**
+ * host stub of the generated build configuration, empty on the host
+ */
+#ifndef __TUYA_IOT_CONFIG_H__
+#define __TUYA_IOT_CONFIG_H__
+
+#endif /* __TUYA_IOT_CONFIG_H__ */
@@ -0,0 +1,42 @@
+/**
+ * host stub of the SDK KV store, an in-memory table in host_kv.c
+ *
+ * Tests inject failures through the counters: each nonzero count fails
+ * that many of the next calls.
+ */
+#ifndef __TUYA_WS_DB_H__
+#define __TUYA_WS_DB_H__
+
+#include "tuya_cloud_types.h"
+
+OPERATE_RET wd_common_read(CONST CHAR_T *key, BYTE_T **value, UINT_T *len);
+OPERATE_RET wd_common_write(CONST CHAR_T *key, CONST BYTE_T *value, CONST UINT_T len);
+OPERATE_RET wd_common_free_data(BYTE_T *data);
+OPERATE_RET wd_common_delete(CONST CHAR_T *key);
+
+typedef struct {
+    UINT32_T    reads;
+    UINT32_T    writes;
+    UINT32_T    deletes;
+    UINT32_T    fail_read;      ///< next reads that fail
+    UINT32_T    fail_write;     ///< next writes that fail
+} HOST_KV_STAT_T;
+
+extern HOST_KV_STAT_T g_host_kv;
+
+/**
+ * @brief clear the table and the counters
+ */
+VOID host_kv_reset(VOID);
+
+/**
+ * @brief store raw bytes as if an older or newer firmware wrote them
+ */
+VOID host_kv_put(CONST CHAR_T *key, CONST VOID *value, UINT_T len);
+
+/**
+ * @brief stored bytes of key, NULL when absent
+ */
+CONST BYTE_T *host_kv_get(CONST CHAR_T *key, UINT_T *len);
+
+#endif /* __TUYA_WS_DB_H__ */
@@ -0,0 +1,18 @@
+/**
+ * host stub of the SDK cJSON, only flat objects of integers, see host_kv.c
+ */
+#ifndef __TY_CJSON_H__
+#define __TY_CJSON_H__
+
+#include "tuya_cloud_types.h"
+
+typedef struct ty_cJSON {
+    CHAR_T     *text;           ///< object: the copied source, item: NULL
+    INT_T       valueint;
+} cJSON;
+
+cJSON *ty_cJSON_Parse(CONST CHAR_T *value);
+cJSON *ty_cJSON_GetObjectItem(cJSON *object, CONST CHAR_T *name);
+VOID ty_cJSON_Delete(cJSON *c);
+
+#endif /* __TY_CJSON_H__ */
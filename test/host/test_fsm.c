@@ -0,0 +1,180 @@
+/**
+ * ai_toy_fsm: every (event, state, mode) cell against the guards of the
+ * callbacks the table replaced, then a conversation trace replayed through
+ * the table.
+ *
+ * usage: test_fsm [trace]     default data/fsm_conversation.trace
+ */
+#include "ai_toy_fsm.h"
+#include "tuya_ai_toy.h"
+#include "host_test.h"
+#include <string.h>
+
+STATIC CONST CHAR_T *s_ev_name[TOY_EV_MAX] = {
+    "MODE_UPDATE", "WAKEUP", "REC_STOP", "VAD_START", "VAD_SPEAK", "VAD_END",
+    "UPLOAD_DONE", "ASR_OK", "ASR_FAIL", "TTS_START", "PLAYER_START", "PLAYER_END",
+};
+STATIC CONST CHAR_T *s_mode_name[TOY_MODE_MAX] = { "key_hold", "wakeup", "free", "other" };
+STATIC CONST CHAR_T *s_st_name[AI_TOY_STATE_MAX] = { "IDLE", "LISTEN", "UPLOAD", "THINK", "SPEAK" };
+
+/**
+ * baseline: the recorder, proc and player callbacks before the table,
+ * written out as plain guards. TOY_ST_NONE is a cell the old code ignored.
+ */
+STATIC UINT8_T __baseline(AI_TOY_FSM_EV_E ev, UINT8_T st, AI_TOY_FSM_MODE_E mode, UINT32_T *act)
+{
+    // the old VAD guard: LISTEN, or SPEAK in free mode (barge-in)
+    BOOL_T vad_ok = (AI_TOY_LISTEN == st) || (AI_TOY_SPEAK == st && TOY_MODE_FREE == mode);
+    UINT8_T talk_again = (TOY_MODE_KEY_HOLD == mode) ? AI_TOY_IDLE : AI_TOY_LISTEN;
+
+    *act = 0;
+    switch (ev) {
+    case TOY_EV_MODE_UPDATE:
+        *act = TOY_ACT_LED_OFF | TOY_ACT_PLAYER_STOP | TOY_ACT_DISPLAY_MODE | TOY_ACT_INTERRUPT | TOY_ACT_ALERT_MODE;
+        return AI_TOY_IDLE;
+    case TOY_EV_WAKEUP:
+        *act = TOY_ACT_TRACE | TOY_ACT_LED_ON | TOY_ACT_STRIP_BREATH | TOY_ACT_PLAYER_STOP |
+               TOY_ACT_INTERRUPT | TOY_ACT_ALERT_WAKEUP;
+        return talk_again;
+    case TOY_EV_REC_STOP:
+        *act = TOY_ACT_LED_OFF | TOY_ACT_PLAYER_STOP;
+        return AI_TOY_IDLE;
+    case TOY_EV_VAD_START:
+        if (!vad_ok) {
+            return TOY_ST_NONE;
+        }
+        // vad_active and idle timer first, player stop and interrupt before the LEDs
+        *act = TOY_ACT_TRACE | TOY_ACT_VAD_ACTIVE | TOY_ACT_STOP_FIRST | TOY_ACT_PLAYER_STOP |
+               TOY_ACT_INTERRUPT | TOY_ACT_LED_FLASH | TOY_ACT_STRIP_DIALOG | TOY_ACT_UPLOAD;
+        return TOY_ST_KEEP;
+    case TOY_EV_VAD_SPEAK:
+        if (!vad_ok) {
+            return TOY_ST_NONE;
+        }
+        *act = TOY_ACT_UPLOAD;
+        return TOY_ST_KEEP;
+    case TOY_EV_VAD_END:
+        if (!vad_ok) {
+            return TOY_ST_NONE;
+        }
+        *act = TOY_ACT_LED_OFF | TOY_ACT_UPLOAD_FINISH;
+        return AI_TOY_UPLOAD;
+    case TOY_EV_UPLOAD_DONE:
+        return (AI_TOY_UPLOAD == st) ? AI_TOY_THINK : TOY_ST_NONE;
+    case TOY_EV_ASR_OK:
+        *act = TOY_ACT_LED_ON;
+        return TOY_ST_KEEP;
+    case TOY_EV_ASR_FAIL:
+        return talk_again;
+    case TOY_EV_TTS_START:
+        *act = TOY_ACT_PLAYER_READY | TOY_ACT_STRIP_IDLE;
+        return TOY_ST_KEEP;
+    case TOY_EV_PLAYER_START:
+        if (AI_TOY_THINK != st && AI_TOY_UPLOAD != st) {
+            return TOY_ST_NONE;
+        }
+        *act = TOY_ACT_PLAYER_STARTED;
+        return AI_TOY_SPEAK;
+    case TOY_EV_PLAYER_END:
+        if (AI_TOY_SPEAK != st) {
+            return TOY_ST_NONE;
+        }
+        *act = TOY_ACT_PLAYER_STOPPED;
+        return (TOY_MODE_KEY_HOLD == mode || TOY_MODE_WAKEUP == mode) ? AI_TOY_IDLE : AI_TOY_LISTEN;
+    default:
+        return TOY_ST_NONE;
+    }
+}
+
+STATIC UINT_T __exhaustive(VOID)
+{
+    UINT_T cells = 0;
+
+    for (INT_T ev = 0; ev < TOY_EV_MAX; ev++) {
+        for (INT_T st = 0; st < AI_TOY_STATE_MAX; st++) {
+            for (INT_T mode = 0; mode < TOY_MODE_MAX; mode++) {
+                UINT32_T act = 0;
+                UINT32_T want_act = 0;
+                UINT8_T next = ai_toy_fsm_step(ev, st, mode, &act);
+                UINT8_T want = __baseline(ev, st, mode, &want_act);
+
+                HOST_CHECK(next == want && act == want_act, "%s in %s/%s: next %d actions 0x%x, baseline %d 0x%x",
+                           s_ev_name[ev], s_st_name[st], s_mode_name[mode], next, act, want, want_act);
+                cells++;
+            }
+        }
+    }
+
+    // out of range input is rejected, not looked up
+    UINT32_T act = 1;
+    HOST_CHECK(TOY_ST_NONE == ai_toy_fsm_step(TOY_EV_MAX, AI_TOY_IDLE, TOY_MODE_FREE, &act) && 0 == act, "event range");
+    HOST_CHECK(TOY_ST_NONE == ai_toy_fsm_step(TOY_EV_WAKEUP, AI_TOY_STATE_MAX, TOY_MODE_FREE, &act), "state range");
+    HOST_CHECK(TOY_ST_NONE == ai_toy_fsm_step(TOY_EV_WAKEUP, AI_TOY_IDLE, TOY_MODE_MAX, &act), "mode range");
+    return cells;
+}
+
+STATIC INT_T __lookup(CONST CHAR_T *name, CONST CHAR_T **tab, INT_T n)
+{
+    for (INT_T i = 0; i < n; i++) {
+        if (0 == strcmp(name, tab[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * trace lines: "<event> <mode> <state after>", '#' starts a comment. The
+ * toy starts in IDLE; a rejected event leaves the state alone, as on the device.
+ */
+STATIC UINT_T __replay(CONST CHAR_T *path)
+{
+    FILE *fp = fopen(path, "r");
+    CHAR_T line[128];
+    UINT8_T state = AI_TOY_IDLE;
+    UINT_T steps = 0;
+    UINT_T lineno = 0;
+
+    HOST_CHECK(NULL != fp, "open %s", path);
+    if (NULL == fp) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        CHAR_T ev_s[32], mode_s[32], st_s[32];
+        lineno++;
+        if ('#' == line[0] || 3 != sscanf(line, "%31s %31s %31s", ev_s, mode_s, st_s)) {
+            continue;
+        }
+        INT_T ev = __lookup(ev_s, s_ev_name, TOY_EV_MAX);
+        INT_T mode = __lookup(mode_s, s_mode_name, TOY_MODE_MAX);
+        INT_T want = __lookup(st_s, s_st_name, AI_TOY_STATE_MAX);
+        HOST_CHECK(ev >= 0 && mode >= 0 && want >= 0, "%s:%u: bad line", path, lineno);
+        if (ev < 0 || mode < 0 || want < 0) {
+            continue;
+        }
+
+        UINT32_T act = 0;
+        UINT32_T base_act = 0;
+        UINT8_T base = __baseline(ev, state, mode, &base_act);
+        UINT8_T next = ai_toy_fsm_step(ev, state, mode, &act);
+        HOST_CHECK(next == base && act == base_act, "%s:%u: %s in %s differs from baseline", path, lineno, ev_s, s_st_name[state]);
+        if (TOY_ST_NONE != next && TOY_ST_KEEP != next) {
+            state = next;
+        }
+        HOST_CHECK(state == want, "%s:%u: %s/%s ends in %s, trace has %s", path, lineno, ev_s, mode_s, s_st_name[state], st_s);
+        steps++;
+    }
+    fclose(fp);
+    return steps;
+}
+
+int main(int argc, char *argv[])
+{
+    UINT_T cells = __exhaustive();
+    UINT_T steps = __replay((argc > 1) ? argv[1] : "data/fsm_conversation.trace");
+
+    HOST_CHECK(cells == TOY_EV_MAX * AI_TOY_STATE_MAX * TOY_MODE_MAX, "cells %u", cells);
+    HOST_CHECK(steps > 0, "empty trace");
+    fprintf(stderr, "fsm: %u cells, %u trace steps\n", cells, steps);
+    return host_test_result("fsm");
+}
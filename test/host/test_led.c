@@ -0,0 +1,343 @@
+/**
+ * led_controller on the manual clock: every frame the strip gets is decoded
+ * back to RGB and checked against the state timing (self-test, dialog blink
+ * count, breath period, level display timeouts, effects), then low-power
+ * suspend/resume through the SPI stub and the stats surface.
+ */
+#include "led_controller.h"
+#include "ai_toy_wheel.h"
+#include "tkl_spi.h"
+#include "host_test.h"
+#include <string.h>
+
+#define FRAMES_MAX                      1024
+
+#define RGB_BLACK                       0x000000
+#define RGB_RED                         0xFF0000
+#define RGB_GREEN                       0x00FF00
+#define RGB_BLUE                        0x0000FF
+#define RGB_YELLOW                      0xFFFF00
+
+typedef struct {
+    UINT32_T    ms;
+    UINT32_T    rgb[WS2812_LED_COUNT];
+} frame_t;
+
+STATIC frame_t s_frame[FRAMES_MAX];
+STATIC UINT_T s_frames;
+STATIC UINT32_T s_bad_bytes;
+STATIC UINT32_T s_stale_cbs;
+
+STATIC VOID __decode(frame_t *f, CONST UCHAR_T *buf, UINT32_T len)
+{
+    for (UINT_T i = 0; i < WS2812_LED_COUNT && (i + 1) * 24 <= len; i++) {
+        UINT32_T grb = 0;
+        for (UINT_T bit = 0; bit < 24; bit++) {
+            grb <<= 1;
+            if (WS2812_1 == buf[i * 24 + bit]) {
+                grb |= 1;
+            } else if (WS2812_0 != buf[i * 24 + bit]) {
+                s_bad_bytes++;
+            }
+        }
+        f->rgb[i] = ((grb & 0x00FF00) << 8) | ((grb & 0xFF0000) >> 8) | (grb & 0x0000FF);
+    }
+}
+
+STATIC OPERATE_RET __tx(CONST UCHAR_T *buf, UINT32_T len)
+{
+    if (s_frames < FRAMES_MAX) {
+        s_frame[s_frames].ms = ai_toy_wheel_manual_ms();
+        __decode(&s_frame[s_frames], buf, len);
+        s_frames++;
+    }
+    return OPRT_OK;
+}
+
+STATIC BOOL_T __all(CONST frame_t *f, UINT32_T rgb)
+{
+    for (UINT_T i = 0; i < WS2812_LED_COUNT; i++) {
+        if (f->rgb[i] != rgb) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+// level display: LED_LIGHT_ORDER lights led9 down to led1, then led12 down to led10
+STATIC BOOL_T __level(CONST frame_t *f, UINT32_T rgb, UINT8_T level)
+{
+    STATIC CONST UINT8_T order[13] = { 0, 9, 8, 7, 6, 5, 4, 3, 2, 1, 12, 11, 10 };
+    UINT32_T want[WS2812_LED_COUNT] = { 0 };
+
+    for (UINT_T i = 1; i <= level; i++) {
+        want[order[i] - 1] = rgb;
+    }
+    return 0 == memcmp(f->rgb, want, sizeof(want));
+}
+
+STATIC VOID __begin(VOID)
+{
+    LedStats st;
+
+    // nothing in a single thread can re-arm between dispatch and callback
+    led_controller_stats_get(&st);
+    s_stale_cbs += st.stale_cbs;
+    s_frames = 0;
+    led_controller_stats_reset();
+}
+
+STATIC VOID __selftest(VOID)
+{
+    LedStats st;
+    UINT32_T t0 = ai_toy_wheel_manual_ms();
+
+    __begin();
+    set_led_state(LED_INIT, 0);
+    ai_toy_wheel_advance(LED_SELFTEST_TOTAL_TIME + 100);
+    led_controller_stats_get(&st);
+
+    HOST_CHECK(4 == s_frames, "self-test frames %u", s_frames);
+    if (4 == s_frames) {
+        HOST_CHECK(__all(&s_frame[0], RGB_RED) && t0 == s_frame[0].ms, "self-test red");
+        HOST_CHECK(__all(&s_frame[1], RGB_GREEN) && t0 + INIT_RED_TIME == s_frame[1].ms, "self-test green");
+        HOST_CHECK(__all(&s_frame[2], RGB_BLUE) && t0 + INIT_RED_TIME + INIT_GREEN_TIME == s_frame[2].ms, "self-test blue");
+        HOST_CHECK(__all(&s_frame[3], RGB_BLACK) && t0 + LED_SELFTEST_TOTAL_TIME == s_frame[3].ms, "self-test end at %u",
+                   s_frame[3].ms - t0);
+    }
+    HOST_CHECK(3 == st.timer_cbs && 1 == st.transitions[LED_INIT] && 1 == st.transitions[LED_IDLE], "self-test cbs %u",
+               st.timer_cbs);
+
+    // an idle request does not cut the self-test short, any other state does
+    LedSelftestStats ts;
+    __begin();
+    set_led_state(LED_INIT, 0);
+    set_led_state(LED_IDLE, 0);
+    led_controller_selftest_stats_get(&ts);
+    HOST_CHECK(1 == s_frames && 0 == ts.run_ms && 0 == ts.preempted_by, "idle ended the self-test");
+    set_led_state(LED_NET_ERROR, 0);
+    led_controller_selftest_stats_get(&ts);
+    HOST_CHECK(LED_NET_ERROR == ts.preempted_by && 0 == ts.steps_done && 2 == s_frames && __all(&s_frame[1], RGB_RED),
+               "self-test preempted by %d", ts.preempted_by);
+    set_led_state(LED_IDLE, 0);
+}
+
+STATIC VOID __dialog(VOID)
+{
+    LedStats st;
+    UINT32_T t0 = ai_toy_wheel_manual_ms();
+    UINT_T blinks = 0;
+
+    __begin();
+    set_led_state(LED_DIALOG, 0);
+    ai_toy_wheel_advance(DIALOG_TOTAL_TIME + 500);
+    led_controller_stats_get(&st);
+
+    // a blink is a blue frame that stays up; the last one gives way to idle at once
+    for (UINT_T i = 0; i < s_frames; i++) {
+        if (__all(&s_frame[i], RGB_BLUE) && i + 1 < s_frames && s_frame[i + 1].ms > s_frame[i].ms) {
+            HOST_CHECK(DIALOG_LIGHT_ON_TIME == s_frame[i + 1].ms - s_frame[i].ms, "blink %u lit %u ms", blinks,
+                       s_frame[i + 1].ms - s_frame[i].ms);
+            blinks++;
+        }
+    }
+    HOST_CHECK(DIALOG_BLINK_COUNT == blinks, "dialog blinks %u", blinks);
+    HOST_CHECK(s_frames && __all(&s_frame[s_frames - 1], RGB_BLACK) && t0 + DIALOG_TOTAL_TIME == s_frame[s_frames - 1].ms,
+               "dialog ends at %u", s_frames ? s_frame[s_frames - 1].ms - t0 : 0);
+    HOST_CHECK(2 * DIALOG_BLINK_COUNT == st.timer_cbs && 1 == st.transitions[LED_IDLE], "dialog cbs %u", st.timer_cbs);
+}
+
+STATIC VOID __breath(VOID)
+{
+    LedStats st;
+    UINT32_T t0 = ai_toy_wheel_manual_ms();
+    UINT32_T peak = 0;
+    UINT_T gaps = 0;
+
+    __begin();
+    set_led_state(LED_BREATHING, 0);
+    ai_toy_wheel_advance(2 * BREATH_TABLE_SIZE * BREATH_TIMER_INTERVAL);
+    led_controller_stats_get(&st);
+
+    HOST_CHECK(2 * BREATH_TABLE_SIZE == s_frames && 2 * BREATH_TABLE_SIZE == st.timer_cbs, "breath frames %u, cbs %u",
+               s_frames, st.timer_cbs);
+    for (UINT_T i = 0; i < s_frames && i < 2 * BREATH_TABLE_SIZE; i++) {
+        gaps += (s_frame[i].ms != t0 + (i + 1) * BREATH_TIMER_INTERVAL);
+        if (s_frame[i].rgb[0] > peak) {
+            peak = s_frame[i].rgb[0];
+        }
+        if (i >= BREATH_TABLE_SIZE) {
+            HOST_CHECK(0 == memcmp(s_frame[i].rgb, s_frame[i - BREATH_TABLE_SIZE].rgb, sizeof(s_frame[i].rgb)),
+                       "breath period broken at step %u", i);
+        }
+    }
+    HOST_CHECK(0 == gaps, "breath: %u late or dropped steps", gaps);
+    HOST_CHECK(0xFF == peak && __all(&s_frame[0], s_frame[0].rgb[0]), "breath peak 0x%06x", peak);
+    set_led_state(LED_IDLE, 0);
+}
+
+STATIC VOID __levels(VOID)
+{
+    UINT32_T t0 = ai_toy_wheel_manual_ms();
+
+    __begin();
+    set_led_state(LED_VOLUME, 5);
+    HOST_CHECK(1 == s_frames && __level(&s_frame[0], RGB_YELLOW, 5), "volume 5");
+
+    // a new level restarts the timeout
+    ai_toy_wheel_advance(1000);
+    set_led_state(LED_VOLUME, 6);
+    ai_toy_wheel_advance(VOLUME_DISPLAY_TIMEOUT - 500);
+    HOST_CHECK(2 == s_frames && __level(&s_frame[1], RGB_YELLOW, 6), "volume 6, %u frames", s_frames);
+    ai_toy_wheel_advance(500);
+    HOST_CHECK(3 == s_frames && __all(&s_frame[2], RGB_BLACK) && t0 + 1000 + VOLUME_DISPLAY_TIMEOUT == s_frame[2].ms,
+               "volume timeout, %u frames", s_frames);
+
+    __begin();
+    set_led_state(LED_CONFIG_SUCCESS, 8);
+    ai_toy_wheel_advance(CONFIG_SUCCESS_TIMEOUT);
+    HOST_CHECK(2 == s_frames && __level(&s_frame[0], RGB_GREEN, 8) && __all(&s_frame[1], RGB_BLACK), "config success");
+
+    // the signal meter colours by level and has no timeout
+    __begin();
+    set_led_state(LED_SIGNAL_METER, 2);
+    set_led_state(LED_SIGNAL_METER, 5);
+    set_led_state(LED_SIGNAL_METER, 12);
+    ai_toy_wheel_advance(10000);
+    HOST_CHECK(3 == s_frames && __level(&s_frame[0], RGB_RED, 2) && __level(&s_frame[1], RGB_YELLOW, 5) &&
+               __level(&s_frame[2], RGB_GREEN, 12), "signal meter, %u frames", s_frames);
+    set_led_state(LED_IDLE, 0);
+}
+
+STATIC VOID __effect(VOID)
+{
+    LedStats st;
+
+    __begin();
+    set_led_state(LED_EFFECT, LED_EFFECT_RAINBOW);
+    ai_toy_wheel_advance(10 * LED_EFFECT_INTERVAL);
+    // the same effect keeps playing instead of starting over
+    set_led_state(LED_EFFECT, LED_EFFECT_RAINBOW);
+    led_controller_stats_get(&st);
+    HOST_CHECK(11 == s_frames && 10 == st.timer_cbs && 1 == st.transitions[LED_EFFECT], "effect frames %u, cbs %u",
+               s_frames, st.timer_cbs);
+
+    ai_toy_wheel_advance(10 * LED_EFFECT_INTERVAL);
+    led_controller_stats_get(&st);
+    HOST_CHECK(21 == s_frames && 20 == st.timer_cbs, "effect after re-set: frames %u, cbs %u", s_frames, st.timer_cbs);
+
+    // an unknown effect or state is rejected before the running one is left
+    set_led_state(LED_EFFECT, 0xFF);
+    set_led_state(LED_STATE_MAX, 0);
+    ai_toy_wheel_advance(10 * LED_EFFECT_INTERVAL);
+    led_controller_stats_get(&st);
+    HOST_CHECK(31 == s_frames && 30 == st.timer_cbs && 1 == st.transitions[LED_EFFECT] && 0 == st.transitions[LED_IDLE],
+               "after invalid requests: frames %u, cbs %u", s_frames, st.timer_cbs);
+
+    // nor does it end the self-test
+    LedSelftestStats ts;
+    __begin();
+    set_led_state(LED_INIT, 0);
+    set_led_state(LED_EFFECT, 0xFF);
+    set_led_state(LED_STATE_MAX, 0);
+    ai_toy_wheel_advance(LED_SELFTEST_TOTAL_TIME + 100);
+    led_controller_selftest_stats_get(&ts);
+    led_controller_stats_get(&st);
+    HOST_CHECK(4 == s_frames && 3 == st.timer_cbs && LED_INIT == ts.preempted_by && 0 == ts.first_state_ms,
+               "self-test after invalid requests: frames %u, preempted by %d", s_frames, ts.preempted_by);
+    set_led_state(LED_IDLE, 0);
+}
+
+STATIC VOID __suspend(VOID)
+{
+    LedStats st0, st1;
+    LedResumeStats rs;
+    frame_t f;
+
+    // through the SPI stub, the path the device takes
+    ws2812_spi_tx_hook_set(NULL);
+    set_led_state(LED_BREATHING, 0);
+    ai_toy_wheel_advance(10 * BREATH_TIMER_INTERVAL);
+
+    HOST_SPI_STAT_T spi = g_host_spi;
+    led_controller_suspend();
+    led_controller_stats_get(&st0);
+    __decode(&f, g_host_spi.last, g_host_spi.last_len);
+    HOST_CHECK(!g_host_spi.open && spi.deinits + 1 == g_host_spi.deinits && spi.sends + 1 == g_host_spi.sends, "suspend spi");
+    HOST_CHECK(__all(&f, RGB_BLACK) && ws2812_spi_is_suspended(), "suspend blanks the strip");
+
+    // no animation steps and no sends while suspended, a new state only updates the shadow frame
+    ai_toy_wheel_advance(1000);
+    set_led_state(LED_VOLUME, 3);
+    ai_toy_wheel_advance(VOLUME_DISPLAY_TIMEOUT + 1000);
+    led_controller_stats_get(&st1);
+    HOST_CHECK(spi.sends + 1 == g_host_spi.sends && st0.timer_cbs == st1.timer_cbs, "suspended: %u sends, %u cbs",
+               g_host_spi.sends - spi.sends, st1.timer_cbs - st0.timer_cbs);
+    HOST_CHECK(st1.drv.frames_skipped > st0.drv.frames_skipped, "suspended refresh not skipped");
+
+    // a failed SPI init keeps it suspended, the next resume restores the last frame in one send
+    g_host_spi.fail_init = 1;
+    led_controller_resume();
+    HOST_CHECK(ws2812_spi_is_suspended() && spi.sends + 1 == g_host_spi.sends, "failed resume");
+    led_controller_resume();
+    led_controller_resume_stats_get(&rs);
+    __decode(&f, g_host_spi.last, g_host_spi.last_len);
+    HOST_CHECK(!ws2812_spi_is_suspended() && g_host_spi.open && spi.sends + 2 == g_host_spi.sends, "resume spi");
+    HOST_CHECK(__level(&f, RGB_YELLOW, 3) && 1 == rs.count, "resume restored the last frame");
+
+    // the state timer runs again from the resume
+    ai_toy_wheel_advance(VOLUME_DISPLAY_TIMEOUT);
+    __decode(&f, g_host_spi.last, g_host_spi.last_len);
+    HOST_CHECK(__all(&f, RGB_BLACK) && spi.sends + 3 == g_host_spi.sends, "timeout after resume");
+
+    ws2812_spi_tx_hook_set(__tx);
+}
+
+STATIC VOID __stats(VOID)
+{
+    LedStats st;
+    CHAR_T buf[LED_STATS_JSON_MAX];
+
+    __begin();
+    set_led_state(LED_DIALOG, 0);
+    ai_toy_wheel_advance(DIALOG_TOTAL_TIME);
+    set_led_state(LED_NET_ERROR, 0);
+    set_led_state(LED_IDLE, 0);
+    led_controller_stats_get(&st);
+    HOST_CHECK(1 == st.transitions[LED_DIALOG] && 1 == st.transitions[LED_NET_ERROR] && 2 == st.transitions[LED_IDLE],
+               "transitions %u/%u/%u", st.transitions[LED_DIALOG], st.transitions[LED_NET_ERROR], st.transitions[LED_IDLE]);
+    HOST_CHECK(st.drv.frames_sent == s_frames && st.drv.frames_encoded == s_frames && 0 == st.drv.send_errors,
+               "driver frames %u, captured %u", st.drv.frames_sent, s_frames);
+    HOST_CHECK(st.drv.pixels_encoded + st.drv.pixels_unchanged >= WS2812_LED_COUNT * s_frames, "pixel counts");
+
+    INT_T n = led_controller_stats_json(buf, sizeof(buf));
+    HOST_CHECK(n > 0 && n < (INT_T)sizeof(buf) && 0 == strncmp(buf, "{\"frm\":[", 8) && '}' == buf[n - 1], "stats json %d", n);
+    HOST_CHECK(-1 == led_controller_stats_json(buf, 16), "short buffer not reported");
+
+    led_controller_stats_reset();
+    led_controller_stats_get(&st);
+    HOST_CHECK(0 == st.timer_cbs && 0 == st.drv.frames_sent && 0 == st.transitions[LED_IDLE], "stats reset");
+}
+
+int main(int argc, char *argv[])
+{
+    LedStats st;
+
+    led_controller_init();
+    ws2812_spi_tx_hook_set(__tx);
+    led_controller_clock_manual(TRUE);
+
+    __selftest();
+    __dialog();
+    __breath();
+    __levels();
+    __effect();
+    __suspend();
+    __stats();
+
+    led_controller_stats_get(&st);
+    HOST_CHECK(0 == s_stale_cbs + st.stale_cbs, "stale callbacks %u", s_stale_cbs + st.stale_cbs);
+    HOST_CHECK(0 == s_bad_bytes, "%u bytes are neither WS2812_0 nor WS2812_1", s_bad_bytes);
+
+    return host_test_result("led");
+}
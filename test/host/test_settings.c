@@ -0,0 +1,248 @@
+/**
+ * ai_toy_settings against the in-memory KV stub: first boot, write-behind
+ * windows, erase, failing writes with retry and give-up, corrupt, legacy
+ * JSON and newer-firmware records.
+ *
+ * Windows are closed with ai_toy_settings_flush(), the flush timer never
+ * fires on the host.
+ */
+#include "ai_toy_settings.h"
+#include "ai_toy_wheel.h"
+#include "tuya_ws_db.h"
+#include "host_test.h"
+#include <string.h>
+
+#define VOLUME_DEFAULT                  70
+
+STATIC UINT32_T s_flushes;
+STATIC UINT8_T s_flush_volume;
+STATIC UINT32_T s_flush_mask;
+
+STATIC VOID __flush_cb(UINT8_T volume, UINT32_T report_mask)
+{
+    s_flushes++;
+    s_flush_volume = volume;
+    s_flush_mask = report_mask;
+}
+
+STATIC UINT32_T __crc32(CONST UINT8_T *buf, UINT32_T len)
+{
+    UINT32_T crc = 0xFFFFFFFF;
+
+    while (len--) {
+        crc ^= *buf++;
+        for (UINT8_T i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// header, payload, CRC-32, as a firmware with a payload of size bytes writes it
+STATIC VOID __put_record(CONST UINT8_T *payload, UINT8_T size, BOOL_T corrupt)
+{
+    UINT8_T rec[64] = { 0x41, 0x54, 1, size };
+    UINT32_T crc;
+
+    memcpy(rec + 4, payload, size);
+    crc = __crc32(rec, 4 + size);
+    memcpy(rec + 4 + size, &crc, sizeof(crc));
+    if (corrupt) {
+        rec[4] ^= 0x01;
+    }
+    host_kv_put(AI_TOY_SETTINGS_KEY, rec, 4 + size + sizeof(crc));
+}
+
+// what the next boot would load, VOLUME_DEFAULT when nothing valid is stored
+STATIC UINT8_T __reboot_volume(VOID)
+{
+    UINT8_T volume = VOLUME_DEFAULT;
+    HOST_KV_STAT_T kv = g_host_kv;
+
+    ai_toy_settings_load(&volume);
+    g_host_kv = kv;
+    return volume;
+}
+
+STATIC VOID __first_boot(VOID)
+{
+    UINT8_T volume = VOLUME_DEFAULT;
+
+    host_kv_reset();
+    HOST_CHECK(OPRT_OK != ai_toy_settings_load(&volume) && VOLUME_DEFAULT == volume, "first boot load");
+
+    // the default itself must reach flash, nothing is stored yet
+    s_flushes = 0;
+    ai_toy_settings_volume_set(VOLUME_DEFAULT, 1);
+    ai_toy_settings_flush();
+    HOST_CHECK(1 == g_host_kv.writes, "first boot: %u writes", g_host_kv.writes);
+    HOST_CHECK(1 == s_flushes && VOLUME_DEFAULT == s_flush_volume && 1 == s_flush_mask, "first boot flush cb");
+
+    // same value again: one callback, no write
+    ai_toy_settings_volume_set(VOLUME_DEFAULT, 2);
+    ai_toy_settings_flush();
+    HOST_CHECK(1 == g_host_kv.writes && 2 == s_flushes && 2 == s_flush_mask, "unchanged volume: %u writes", g_host_kv.writes);
+
+    // a drag inside one window costs one write of the last value
+    for (UINT8_T v = 30; v <= 45; v++) {
+        ai_toy_settings_volume_set(v, 1 << (v & 1));
+    }
+    ai_toy_settings_flush();
+    HOST_CHECK(2 == g_host_kv.writes && 3 == s_flushes && 45 == s_flush_volume && 3 == s_flush_mask, "drag: %u writes",
+               g_host_kv.writes);
+    HOST_CHECK(45 == __reboot_volume(), "drag persisted");
+
+    // nothing pending: flush is a no-op
+    ai_toy_settings_flush();
+    HOST_CHECK(3 == s_flushes, "idle flush called back");
+}
+
+STATIC VOID __read_fail(VOID)
+{
+    UINT8_T volume = VOLUME_DEFAULT;
+
+    host_kv_reset();
+    __put_record((UINT8_T[]){ 20 }, 1, FALSE);
+    g_host_kv.fail_read = 1;
+    HOST_CHECK(OPRT_OK != ai_toy_settings_load(&volume) && VOLUME_DEFAULT == volume, "read fail load");
+
+    // the stored 20 is unknown, so the default is written over it
+    ai_toy_settings_volume_set(VOLUME_DEFAULT, 0);
+    ai_toy_settings_flush();
+    HOST_CHECK(1 == g_host_kv.writes && VOLUME_DEFAULT == __reboot_volume(), "read fail: %u writes", g_host_kv.writes);
+}
+
+STATIC VOID __erase(VOID)
+{
+    UINT8_T volume = VOLUME_DEFAULT;
+
+    host_kv_reset();
+    __put_record((UINT8_T[]){ 55 }, 1, FALSE);
+    HOST_CHECK(OPRT_OK == ai_toy_settings_load(&volume) && 55 == volume, "load 55");
+
+    ai_toy_settings_volume_set(60, 0);
+    HOST_CHECK(OPRT_OK == ai_toy_settings_erase(), "erase");
+    ai_toy_settings_flush();
+    HOST_CHECK(0 == g_host_kv.writes && VOLUME_DEFAULT == __reboot_volume(), "erase dropped the pending write");
+
+    // the value matches the last one saved, but the record is gone
+    ai_toy_settings_volume_set(55, 0);
+    ai_toy_settings_flush();
+    HOST_CHECK(1 == g_host_kv.writes && 55 == __reboot_volume(), "after erase: %u writes", g_host_kv.writes);
+}
+
+STATIC VOID __write_fail(VOID)
+{
+    UINT8_T volume = VOLUME_DEFAULT;
+    AI_TOY_SETTINGS_STAT_T st0, st1;
+
+    host_kv_reset();
+    __put_record((UINT8_T[]){ 50 }, 1, FALSE);
+    ai_toy_settings_load(&volume);
+    ai_toy_settings_stat_get(&st0);
+
+    // two failures, the third attempt lands; the callback waits for it
+    s_flushes = 0;
+    g_host_kv.fail_write = 2;
+    ai_toy_settings_volume_set(10, 0);
+    ai_toy_settings_flush();
+    ai_toy_settings_flush();
+    HOST_CHECK(0 == s_flushes, "callback before the write landed");
+    ai_toy_settings_flush();
+    ai_toy_settings_stat_get(&st1);
+    HOST_CHECK(1 == s_flushes && 3 == g_host_kv.writes && 2 == st1.flash_fails - st0.flash_fails, "retry: %u writes",
+               g_host_kv.writes);
+    HOST_CHECK(10 == __reboot_volume(), "retry persisted");
+
+    // every retry fails: give up, call back, and keep knowing what is stored
+    g_host_kv.fail_write = AI_TOY_SETTINGS_RETRY_MAX + 1;
+    ai_toy_settings_volume_set(11, 0);
+    for (UINT_T i = 0; i <= AI_TOY_SETTINGS_RETRY_MAX; i++) {
+        ai_toy_settings_flush();
+    }
+    ai_toy_settings_stat_get(&st1);
+    HOST_CHECK(2 == s_flushes && 1 == st1.gave_up - st0.gave_up, "give up: %u callbacks", s_flushes);
+    HOST_CHECK(10 == __reboot_volume(), "give up left the old record");
+
+    UINT32_T writes = g_host_kv.writes;
+    ai_toy_settings_volume_set(10, 0);
+    ai_toy_settings_flush();
+    HOST_CHECK(writes == g_host_kv.writes, "back to the stored value wrote again");
+}
+
+STATIC VOID __records(VOID)
+{
+    UINT8_T volume;
+    UINT_T len = 0;
+    CONST BYTE_T *rec;
+
+    // corrupt: defaults, and the first flush replaces it
+    host_kv_reset();
+    __put_record((UINT8_T[]){ 20 }, 1, TRUE);
+    volume = VOLUME_DEFAULT;
+    HOST_CHECK(OPRT_CRC32_FAILED == ai_toy_settings_load(&volume) && VOLUME_DEFAULT == volume, "corrupt load");
+    ai_toy_settings_volume_set(VOLUME_DEFAULT, 0);
+    ai_toy_settings_flush();
+    HOST_CHECK(1 == g_host_kv.writes && VOLUME_DEFAULT == __reboot_volume(), "corrupt replaced");
+
+    // out of range value: defaults, not trusted as stored
+    host_kv_reset();
+    __put_record((UINT8_T[]){ 150 }, 1, FALSE);
+    volume = VOLUME_DEFAULT;
+    ai_toy_settings_load(&volume);
+    ai_toy_settings_volume_set(VOLUME_DEFAULT, 0);
+    ai_toy_settings_flush();
+    HOST_CHECK(VOLUME_DEFAULT == volume && 1 == g_host_kv.writes, "out of range: volume %u, %u writes", volume, g_host_kv.writes);
+
+    // newer firmware, longer payload: the known field is read, the tail ignored
+    host_kv_reset();
+    __put_record((UINT8_T[]){ 33, 0xAA, 0xBB }, 3, FALSE);
+    volume = VOLUME_DEFAULT;
+    HOST_CHECK(OPRT_OK == ai_toy_settings_load(&volume) && 33 == volume, "newer record: %u", volume);
+    ai_toy_settings_volume_set(33, 0);
+    ai_toy_settings_flush();
+    HOST_CHECK(0 == g_host_kv.writes, "newer record rewritten");
+
+    // older firmware, empty payload: defaults
+    host_kv_reset();
+    __put_record(NULL, 0, FALSE);
+    volume = VOLUME_DEFAULT;
+    HOST_CHECK(OPRT_OK == ai_toy_settings_load(&volume) && VOLUME_DEFAULT == volume, "older record: %u", volume);
+
+    // legacy JSON is migrated in place to the binary record
+    host_kv_reset();
+    host_kv_put(AI_TOY_SETTINGS_KEY, "{\"volume\": 42}", 14);
+    volume = VOLUME_DEFAULT;
+    HOST_CHECK(OPRT_OK == ai_toy_settings_load(&volume) && 42 == volume, "json load: %u", volume);
+    rec = host_kv_get(AI_TOY_SETTINGS_KEY, &len);
+    HOST_CHECK(1 == g_host_kv.writes && rec && len > 4 && 0x41 == rec[0] && 0x54 == rec[1], "json migrated");
+    HOST_CHECK(42 == __reboot_volume(), "json migrated value");
+    ai_toy_settings_volume_set(42, 0);
+    ai_toy_settings_flush();
+    HOST_CHECK(1 == g_host_kv.writes, "migrated record rewritten");
+
+    // legacy JSON whose migration write fails: the next flush retries it
+    host_kv_reset();
+    host_kv_put(AI_TOY_SETTINGS_KEY, "{\"volume\": 42}", 14);
+    g_host_kv.fail_write = 1;
+    volume = VOLUME_DEFAULT;
+    ai_toy_settings_load(&volume);
+    ai_toy_settings_volume_set(42, 0);
+    ai_toy_settings_flush();
+    rec = host_kv_get(AI_TOY_SETTINGS_KEY, &len);
+    HOST_CHECK(2 == g_host_kv.writes && rec && 0x41 == rec[0], "failed migration left json: %u writes", g_host_kv.writes);
+}
+
+int main(int argc, char *argv[])
+{
+    HOST_CHECK(OPRT_OK == ai_toy_wheel_init(), "wheel init");
+    HOST_CHECK(OPRT_OK == ai_toy_settings_init(__flush_cb), "settings init");
+
+    __first_boot();
+    __read_fail();
+    __erase();
+    __write_fail();
+    __records();
+
+    return host_test_result("settings");
+}
@@ -0,0 +1,129 @@
+/**
+ * ai_toy_text fuzz: feed mixed UTF-8 text split at every chunk size and
+ * check the lines rebuild the input without splitting a codepoint.
+ */
+#include "ai_toy_text.h"
+#include "host_test.h"
+#include <string.h>
+
+#define TEXT_OUT_MAX        4096
+
+typedef struct {
+    CHAR_T      out[TEXT_OUT_MAX];
+    UINT_T      len;
+    UINT_T      lines;
+    UINT_T      split;          ///< lines that start or end inside a codepoint
+    UINT_T      too_long;
+} text_sink_t;
+
+STATIC BOOL_T __is_cont(UCHAR_T c)
+{
+    return (c & 0xC0) == 0x80;
+}
+
+STATIC VOID __sink_line(CONST CHAR_T *line, UINT_T len, VOID *arg)
+{
+    text_sink_t *sk = (text_sink_t *)arg;
+
+    sk->lines++;
+    if (len >= AI_TOY_TEXT_LINE_SIZE || strlen(line) != len) {
+        sk->too_long++;
+    }
+    if (len && (__is_cont((UCHAR_T)line[0]) || ai_toy_utf8_complete_len(line, len) != len)) {
+        sk->split++;
+    }
+    if (sk->len + len <= sizeof(sk->out)) {
+        memcpy(sk->out + sk->len, line, len);
+    }
+    sk->len += len;
+}
+
+STATIC VOID __run(CONST CHAR_T *name, CONST CHAR_T *text, UINT_T chunk)
+{
+    STATIC AI_TOY_TEXT_STREAM_T st;
+    text_sink_t sk;
+    UINT_T len = strlen(text);
+
+    memset(&sk, 0, sizeof(sk));
+    ai_toy_text_stream_init(&st, __sink_line, &sk);
+    ai_toy_text_stream_start(&st);
+    for (UINT_T off = 0; off < len; off += chunk) {
+        ai_toy_text_stream_put(&st, (CONST UCHAR_T *)text + off, MIN(chunk, len - off));
+    }
+    ai_toy_text_stream_stop(&st);
+
+    HOST_CHECK(sk.len == len && 0 == memcmp(sk.out, text, len), "%s chunk %u: output differs (%u of %u bytes)", name, chunk, sk.len, len);
+    HOST_CHECK(0 == sk.split, "%s chunk %u: %u lines split a codepoint", name, chunk, sk.split);
+    HOST_CHECK(0 == sk.too_long, "%s chunk %u: %u lines overflow", name, chunk, sk.too_long);
+    // every line but the last holds at least a full buffer less a carried tail
+    HOST_CHECK(sk.lines <= len / (AI_TOY_TEXT_LINE_SIZE - 4) + 1, "%s chunk %u: %u lines", name, chunk, sk.lines);
+}
+
+STATIC VOID __utf8_len_cases(VOID)
+{
+    STATIC CONST struct {
+        CONST CHAR_T   *s;
+        UINT_T          want;
+    } c[] = {
+        { "",                   0 },
+        { "abc",                3 },
+        { "a\xC3",              1 },    // 2-byte lead only
+        { "a\xC3\xA9",          3 },
+        { "\xE4\xBD",           0 },    // 3-byte, 1 continuation missing
+        { "\xE4\xBD\xA0",       3 },
+        { "x\xF0\x9F\x98",      1 },    // 4-byte, 1 continuation missing
+        { "x\xF0\x9F\x98\x80",  5 },
+        { "\x80\x80\x80\x80",   4 },    // no lead byte, not UTF-8
+        { "\xFF",               1 },
+    };
+
+    for (UINT_T i = 0; i < sizeof(c) / sizeof(c[0]); i++) {
+        UINT_T got = ai_toy_utf8_complete_len(c[i].s, strlen(c[i].s));
+        HOST_CHECK(got == c[i].want, "case %u: got %u want %u", i, got, c[i].want);
+    }
+}
+
+int main(void)
+{
+    STATIC CHAR_T mixed[2048];
+    STATIC CHAR_T cjk[2048];
+    STATIC CHAR_T emoji[2048];
+    STATIC CONST CHAR_T *piece[] = {
+        "Hi ", "caf\xC3\xA9 ", "\xE4\xBD\xA0\xE5\xA5\xBD\xEF\xBC\x8C", "\xF0\x9F\x98\x80", "\xC2\xB5s ",
+        "\xE4\xB8\xAD\xE6\x96\x87", "ok.",
+    };
+    UINT_T n = 0;
+
+    __utf8_len_cases();
+
+    // mixed widths in a shifting pattern, so the line cut lands on every byte of every width
+    for (UINT_T i = 0; n < sizeof(mixed) - 16; i++) {
+        CONST CHAR_T *p = piece[(i * 5 + i / 7) % (sizeof(piece) / sizeof(piece[0]))];
+        memcpy(mixed + n, p, strlen(p));
+        n += strlen(p);
+    }
+    mixed[n] = '\0';
+
+    for (n = 0; n + 3 < sizeof(cjk) - 1; n += 3) {
+        memcpy(cjk + n, "\xE4\xB8\x80", 3);
+        cjk[n + 2] = (CHAR_T)(0x80 + n % 64);
+    }
+    cjk[n] = '\0';
+
+    // one ASCII byte up front so the 4-byte codepoints straddle the line end
+    emoji[0] = '>';
+    for (n = 1; n + 4 < sizeof(emoji) - 1; n += 4) {
+        memcpy(emoji + n, "\xF0\x9F\x98\x80", 4);
+    }
+    emoji[n] = '\0';
+
+    for (UINT_T chunk = 1; chunk <= 2 * AI_TOY_TEXT_LINE_SIZE + 1; chunk++) {
+        __run("mixed", mixed, chunk);
+        __run("cjk", cjk, chunk);
+        __run("emoji", emoji, chunk);
+    }
+    __run("short", "\xE4\xBD\xA0\xE5\xA5\xBD", 1);
+    __run("empty", "", 1);
+
+    return host_test_result("text");
+}
@@ -0,0 +1,276 @@
+/**
+ * ai_toy_wheel on the manual clock: fire order and times against a
+ * reference model over random arm/cancel/advance sequences, then slack
+ * coalescing, re-arm and cancel from callbacks, generations and the defer
+ * pool.
+ *
+ * usage: test_wheel [seed]
+ */
+#include "ai_toy_wheel.h"
+#include "host_test.h"
+#include <string.h>
+
+#define TIMERS                          256
+#define LOG_MAX                         4096
+#define TICK                            AI_TOY_WHEEL_TICK_MS
+
+typedef struct {
+    UINT16_T    id;
+    UINT32_T    ms;
+} fire_t;
+
+STATIC AI_TOY_WHEEL_TIMER_T s_timer[TIMERS];
+STATIC fire_t s_log[LOG_MAX];
+STATIC UINT_T s_log_n;
+
+// reference model: expire tick and arm sequence of every armed timer
+STATIC struct {
+    BOOL_T      armed;
+    UINT32_T    expire;
+    UINT32_T    seq;
+} s_ref[TIMERS];
+STATIC UINT32_T s_ref_seq;
+
+STATIC UINT32_T s_rand = 1;
+
+STATIC UINT32_T __rand(VOID)
+{
+    s_rand ^= s_rand << 13;
+    s_rand ^= s_rand >> 17;
+    s_rand ^= s_rand << 5;
+    return s_rand;
+}
+
+STATIC VOID __log_cb(VOID *arg)
+{
+    if (s_log_n < LOG_MAX) {
+        s_log[s_log_n].id = (UINT16_T)(uintptr_t)arg;
+        s_log[s_log_n].ms = ai_toy_wheel_manual_ms();
+        s_log_n++;
+    }
+}
+
+STATIC VOID __timers_init(AI_TOY_WHEEL_CB cb, UINT32_T slack_ms)
+{
+    for (UINT_T i = 0; i < TIMERS; i++) {
+        ai_toy_wheel_cancel(&s_timer[i]);
+        ai_toy_wheel_timer_init(&s_timer[i], cb, (VOID *)(uintptr_t)i, slack_ms);
+        ai_toy_wheel_timer_manual(&s_timer[i], TRUE);
+        s_ref[i].armed = FALSE;
+    }
+    s_log_n = 0;
+}
+
+STATIC VOID __ref_arm(UINT_T i, UINT32_T delay_ms)
+{
+    UINT32_T ticks = (delay_ms + TICK - 1) / TICK;
+
+    s_ref[i].armed = TRUE;
+    s_ref[i].expire = ai_toy_wheel_manual_ms() / TICK + (ticks ? ticks : 1);
+    s_ref[i].seq = s_ref_seq++;
+    ai_toy_wheel_arm(&s_timer[i], delay_ms);
+}
+
+/**
+ * advance both and compare: the model fires every timer due by the target,
+ * by expire then arm order, each at its own expire
+ */
+STATIC VOID __ref_advance(UINT32_T ms, UINT_T step)
+{
+    UINT32_T target = ai_toy_wheel_manual_ms() + ms;
+    UINT_T want = 0;
+
+    s_log_n = 0;
+    ai_toy_wheel_advance(ms);
+
+    for (;;) {
+        INT_T best = -1;
+        for (UINT_T i = 0; i < TIMERS; i++) {
+            if (!s_ref[i].armed || s_ref[i].expire * TICK > target) {
+                continue;
+            }
+            if (best < 0 || s_ref[i].expire < s_ref[best].expire ||
+                (s_ref[i].expire == s_ref[best].expire && s_ref[i].seq < s_ref[best].seq)) {
+                best = i;
+            }
+        }
+        if (best < 0) {
+            break;
+        }
+        s_ref[best].armed = FALSE;
+        HOST_CHECK(want < s_log_n && s_log[want].id == best && s_log[want].ms == s_ref[best].expire * TICK,
+                   "step %u: fire %u should be timer %d at %u ms, got %d at %u ms", step, want, best,
+                   s_ref[best].expire * TICK, want < s_log_n ? s_log[want].id : -1, want < s_log_n ? s_log[want].ms : 0);
+        want++;
+    }
+    HOST_CHECK(want == s_log_n, "step %u: %u fires, model has %u", step, s_log_n, want);
+    for (UINT_T i = 0; i < TIMERS; i++) {
+        HOST_CHECK(s_ref[i].armed == ai_toy_wheel_is_armed(&s_timer[i]), "step %u: timer %u armed %d", step, i, s_ref[i].armed);
+    }
+}
+
+STATIC VOID __random(UINT_T steps)
+{
+    STATIC CONST UINT32_T delay_max[] = { 20, 300, 2000, 60000 };
+
+    __timers_init(__log_cb, 0);
+    for (UINT_T step = 0; step < steps; step++) {
+        UINT32_T op = __rand() % 8;
+        UINT_T i = __rand() % TIMERS;
+
+        if (op < 5) {
+            __ref_arm(i, __rand() % delay_max[__rand() % 4]);
+        } else if (op < 7) {
+            s_ref[i].armed = FALSE;
+            ai_toy_wheel_cancel(&s_timer[i]);
+        } else {
+            __ref_advance(__rand() % ((__rand() & 7) ? 400 : 70000), step);
+        }
+    }
+    __ref_advance(70000, steps);
+}
+
+STATIC VOID __same_tick_and_turns(VOID)
+{
+    STATIC CONST UINT_T order[] = { 3, 1, 4, 0, 2 };
+
+    __timers_init(__log_cb, 0);
+    for (UINT_T k = 0; k < 5; k++) {
+        ai_toy_wheel_arm(&s_timer[order[k]], 10);
+    }
+    // one slot, three turns apart, armed latest first
+    ai_toy_wheel_arm(&s_timer[12], 100 + 2 * 64 * TICK);
+    ai_toy_wheel_arm(&s_timer[11], 100 + 64 * TICK);
+    ai_toy_wheel_arm(&s_timer[10], 100);
+    ai_toy_wheel_advance(5000);
+
+    HOST_CHECK(8 == s_log_n, "fired %u", s_log_n);
+    for (UINT_T k = 0; k < 5 && k < s_log_n; k++) {
+        HOST_CHECK(s_log[k].id == order[k], "same tick fire %u is %u, armed %u", k, s_log[k].id, order[k]);
+    }
+    for (UINT_T k = 5; k < 8 && k < s_log_n; k++) {
+        HOST_CHECK(s_log[k].id == 5 + k && s_log[k].ms == 100 + (k - 5) * 64 * TICK, "turn %u: timer %u at %u", k - 5,
+                   s_log[k].id, s_log[k].ms);
+    }
+}
+
+STATIC VOID __slack(VOID)
+{
+    AI_TOY_WHEEL_STAT_T st0, st1;
+
+    __timers_init(__log_cb, 0);
+    ai_toy_wheel_timer_init(&s_timer[0], __log_cb, (VOID *)0, 50);
+    ai_toy_wheel_timer_manual(&s_timer[0], TRUE);
+
+    // alone it may be 50 ms late
+    UINT32_T base = ai_toy_wheel_manual_ms();
+    ai_toy_wheel_arm(&s_timer[0], 10);
+    ai_toy_wheel_advance(1000);
+    HOST_CHECK(1 == s_log_n && base + 60 == s_log[0].ms, "slack alone: %u fires, at %u", s_log_n, s_log[0].ms - base);
+
+    // with a strict neighbour inside its slack it rides along, in expire order
+    s_log_n = 0;
+    ai_toy_wheel_stat_get(&st0);
+    base = ai_toy_wheel_manual_ms();
+    ai_toy_wheel_arm(&s_timer[0], 10);
+    ai_toy_wheel_arm(&s_timer[1], 40);
+    ai_toy_wheel_advance(1000);
+    ai_toy_wheel_stat_get(&st1);
+    HOST_CHECK(2 == s_log_n && 0 == s_log[0].id && 1 == s_log[1].id, "slack pair order");
+    HOST_CHECK(s_log[0].ms == base + 40 && s_log[1].ms == base + 40, "slack pair at %u/%u", s_log[0].ms - base, s_log[1].ms - base);
+    HOST_CHECK(st1.coalesced - st0.coalesced == 1 && st1.wakeups - st0.wakeups == 1, "coalesced %u, wakeups %u",
+               st1.coalesced - st0.coalesced, st1.wakeups - st0.wakeups);
+}
+
+STATIC UINT_T s_periodic;
+
+STATIC VOID __periodic_cb(VOID *arg)
+{
+    __log_cb(arg);
+    if (++s_periodic < 10) {
+        ai_toy_wheel_arm(&s_timer[0], 15);
+    }
+}
+
+STATIC VOID __cancel_cb(VOID *arg)
+{
+    __log_cb(arg);
+    ai_toy_wheel_cancel(&s_timer[2]);
+    ai_toy_wheel_arm(&s_timer[3], 0);
+}
+
+STATIC UINT32_T s_fired_gen;
+
+STATIC VOID __gen_cb(VOID *arg)
+{
+    s_fired_gen = ai_toy_wheel_fired_gen(&s_timer[0]);
+    HOST_CHECK(ai_toy_wheel_gen_current(&s_timer[0], s_fired_gen), "gen current inside the callback");
+}
+
+STATIC VOID __nop_cb(VOID *arg)
+{
+}
+
+STATIC VOID __callbacks(VOID)
+{
+    // re-arm from its own callback
+    __timers_init(__periodic_cb, 0);
+    UINT32_T base = ai_toy_wheel_manual_ms();
+    ai_toy_wheel_arm(&s_timer[0], 15);
+    ai_toy_wheel_advance(1000);
+    HOST_CHECK(10 == s_log_n, "periodic fired %u", s_log_n);
+    for (UINT_T k = 0; k < s_log_n; k++) {
+        HOST_CHECK(s_log[k].ms == base + 15 * (k + 1), "periodic %u at %u", k, s_log[k].ms - base);
+    }
+
+    // a callback cancels a timer due in the same wake-up and arms another
+    __timers_init(__log_cb, 0);
+    ai_toy_wheel_timer_init(&s_timer[1], __cancel_cb, (VOID *)1, 0);
+    ai_toy_wheel_timer_manual(&s_timer[1], TRUE);
+    ai_toy_wheel_arm(&s_timer[1], 20);
+    ai_toy_wheel_arm(&s_timer[2], 20);
+    ai_toy_wheel_advance(100);
+    HOST_CHECK(2 == s_log_n && 1 == s_log[0].id && 3 == s_log[1].id, "cancel in callback: %u fires", s_log_n);
+    HOST_CHECK(!ai_toy_wheel_is_armed(&s_timer[2]), "cancelled timer still armed");
+
+    // generations
+    __timers_init(__gen_cb, 0);
+    ai_toy_wheel_arm(&s_timer[0], 10);
+    ai_toy_wheel_advance(20);
+    HOST_CHECK(ai_toy_wheel_gen_current(&s_timer[0], s_fired_gen), "gen current after firing");
+    ai_toy_wheel_arm(&s_timer[0], 10);
+    HOST_CHECK(!ai_toy_wheel_gen_current(&s_timer[0], s_fired_gen), "re-arm keeps the old gen current");
+    UINT32_T gen = s_timer[0].gen;
+    ai_toy_wheel_cancel(&s_timer[0]);
+    HOST_CHECK(!ai_toy_wheel_gen_current(&s_timer[0], gen), "cancel keeps the gen current");
+
+    // defer pool runs on the real clock, only its bound is checked here
+    AI_TOY_WHEEL_STAT_T st0, st1;
+    ai_toy_wheel_stat_get(&st0);
+    UINT_T ok = 0;
+    for (UINT_T k = 0; k < AI_TOY_WHEEL_POOL + 1; k++) {
+        ok += (OPRT_OK == ai_toy_wheel_defer(60000, __nop_cb, NULL));
+    }
+    ai_toy_wheel_stat_get(&st1);
+    HOST_CHECK(AI_TOY_WHEEL_POOL == ok && 1 == st1.full - st0.full, "defer pool: %u accepted", ok);
+}
+
+int main(int argc, char *argv[])
+{
+    s_rand = (argc > 1) ? (UINT32_T)strtoul(argv[1], NULL, 0) : 0x5eed;
+    if (0 == s_rand) {
+        s_rand = 1;
+    }
+    HOST_CHECK(OPRT_OK == ai_toy_wheel_init(), "init");
+
+    __same_tick_and_turns();
+    __slack();
+    __callbacks();
+    __random(20000);
+
+    AI_TOY_WHEEL_STAT_T st;
+    ai_toy_wheel_stat_get(&st);
+    fprintf(stderr, "wheel: fired %u, wakeups %u, coalesced %u, max pending %u\n", st.fired, st.wakeups, st.coalesced,
+            st.max_pending);
+    return host_test_result("wheel");
+}